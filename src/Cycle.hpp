@@ -140,6 +140,19 @@ class Cycle {
 		return (*this)();
 	}
 
+	/**
+	 * Returns the time passed since the end of the current cycle.
+	 *
+	 * After an uninterrupted sleep this is the wakeup lateness,
+	 * it is negative while the cycle has not ended.
+	 *
+	 * @return
+	 *	The time since the end of the cycle in microseconds
+	 */
+	us late() const {
+		return std::chrono::duration_cast<us>(clock::now() - this->clk);
+	}
+
 };
 
 } /* namespace timing */
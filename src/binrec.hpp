@@ -0,0 +1,153 @@
+/**
+ * Implements the binary load recording format.
+ *
+ * A binary load recording starts with the same header as a text
+ * recording, i.e. a list of `name=value` lines. The header must
+ * set the BINARY bit in the `usr.app.powerdxx.loadrec.features`
+ * pseudo sysctl.
+ *
+ * The header is followed by a single text line introducing the
+ * binary frame data:
+ *
+ * \verbatim
+ * binrec <version> <cores>
+ * \endverbatim
+ *
+ * The `cores` field is the number of cores in `kern.cp_times`.
+ *
+ * The remainder of the file consists of frames, each frame contains
+ * the same columns as a line of a text recording:
+ *
+ * | Column           | Count              | Condition       |
+ * |------------------|--------------------|-----------------|
+ * | duration in [ms] | 1                  |                 |
+ * | frequency [MHz]  | cores              | FREQ_TRACKING   |
+ * | cp_times growth  | cores * CPUSTATES  |                 |
+ *
+ * Like in the text format the `kern.cp_times` columns are delta
+ * encoded, i.e. each frame contains the growth of the ticks since
+ * the previous frame. Only the first frame contains the absolute
+ * values.
+ *
+ * All values are encoded as unsigned LEB128 variable length integers,
+ * i.e. 7 bits of payload per byte, with the high bit set on all but
+ * the last byte. The typical tick count growth of a frame fits into
+ * a single byte.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_BINREC_HPP_
+#define _POWERDXX_BINREC_HPP_
+
+#include <cstdint>   /* uint8_t, uint64_t */
+#include <cstddef>   /* size_t */
+
+/**
+ * Binary load recording encoding and decoding.
+ */
+namespace binrec {
+
+/**
+ * The introduction of the binary frame data.
+ */
+char const * const MAGIC = "binrec";
+
+/**
+ * The binary format version.
+ */
+unsigned int const VERSION{1};
+
+/**
+ * The maximum number of bytes required to encode a 64 bit value.
+ */
+constexpr size_t const VARINT_MAX{10};
+
+/**
+ * Encode an unsigned integer.
+ *
+ * @param dst
+ *	The buffer to encode the value into
+ * @param value
+ *	The value to encode
+ * @return
+ *	The number of bytes used
+ */
+inline size_t encode(uint8_t (& dst)[VARINT_MAX], uint64_t value) {
+	size_t i = 0;
+	for (; value >= 0x80; value >>= 7) {
+		dst[i++] = static_cast<uint8_t>(value | 0x80);
+	}
+	dst[i++] = static_cast<uint8_t>(value);
+	return i;
+}
+
+/**
+ * A functor for reading values from a buffer of encoded values.
+ *
+ * The interface mirrors utility::FromChars, so text and binary
+ * input can be consumed by the same code.
+ *
+ * The functor does not own the buffer, it is intended to be used
+ * on memory mapped files without copying the data.
+ */
+struct Reader {
+	/**
+	 * The next byte to read.
+	 */
+	uint8_t const * it;
+
+	/**
+	 * The end of the buffer.
+	 */
+	uint8_t const * end;
+
+	/**
+	 * Retrieve an integral value from the buffer.
+	 *
+	 * The operation fails if the buffer ends before the value
+	 * is complete or if the value exceeds 64 bits.
+	 *
+	 * @tparam T
+	 *	The value type to retrieve
+	 * @param dst
+	 *	The lvalue to assign to
+	 * @retval true
+	 *	The value was successfully read from the buffer
+	 * @retval false
+	 *	The value could not be read from the buffer
+	 */
+	template <typename T>
+	[[nodiscard]] bool operator ()(T & dst) {
+		uint64_t value{0};
+		for (auto p = this->it; p != this->end; ++p) {
+			auto const shift = 7 * (p - this->it);
+			if (shift > 63) {
+				return false;
+			}
+			value |= static_cast<uint64_t>(*p & 0x7f) << shift;
+			if (!(*p & 0x80)) {
+				dst = static_cast<T>(value);
+				this->it = p + 1;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Check if unread bytes remain.
+	 *
+	 * @retval false
+	 *	All bytes have been read
+	 * @retval true
+	 *	Bytes remain to be read
+	 */
+	operator bool() const {
+		return this->it && this->it != this->end;
+	}
+};
+
+} /* namespace binrec */
+
+#endif /* _POWERDXX_BINREC_HPP_ */
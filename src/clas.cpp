@@ -259,6 +259,28 @@ size_t clas::samples(char const * const str) {
 	return value;
 }
 
+types::coreid_t clas::threads(char const * const str) {
+	if (!str || !*str) {
+		errors::fail(errors::Exit::ETHREADS, 0,
+		             "thread count value missing");
+	}
+
+	auto value = Value{str};
+	if (value != Unit::SCALAR) {
+		errors::fail(errors::Exit::ETHREADS, 0,
+		             "thread count must be a scalar integer");
+	}
+	if (value != static_cast<types::coreid_t>(value)) {
+		errors::fail(errors::Exit::EOUTOFRANGE, 0,
+		             "thread count must be an integer");
+	}
+	if (value < 1 || value > 256) {
+		errors::fail(errors::Exit::EOUTOFRANGE, 0,
+		             "thread count must be in the range [1, 256]");
+	}
+	return value;
+}
+
 types::decikelvin_t clas::temperature(char const * const str) {
 	if (!str || !*str) {
 		errors::fail(errors::Exit::ETEMPERATURE, 0,
@@ -288,6 +310,41 @@ types::decikelvin_t clas::temperature(char const * const str) {
 	return value *= 10;
 }
 
+unsigned int clas::gain(char const * const str) {
+	if (!str || !*str) {
+		errors::fail(errors::Exit::EGAIN, 0, "gain value missing");
+	}
+
+	auto value = Value{str};
+	if (value != Unit::SCALAR) {
+		errors::fail(errors::Exit::EGAIN, 0,
+		             "gain must be a scalar: "s + str);
+	}
+	if (value < 0 || value > 64.) {
+		errors::fail(errors::Exit::EOUTOFRANGE, 0,
+		             "gain must be in the range [0.0, 64.0]");
+	}
+	return value * 1024 + .5;
+}
+
+types::epp_t clas::epp(char const * const str) {
+	if (!str || !*str) {
+		errors::fail(errors::Exit::EEPP, 0,
+		             "energy/performance preference value missing");
+	}
+
+	auto value = Value{str};
+	if (value != Unit::SCALAR && value != Unit::PERCENT) {
+		errors::fail(errors::Exit::EEPP, 0,
+		             "energy/performance preference not recognised: "s + str);
+	}
+	if (value < 0 || value > 100.) {
+		errors::fail(errors::Exit::EOUTOFRANGE, 0,
+		             "energy/performance preference must be in the range [0, 100]");
+	}
+	return value + .5;
+}
+
 char const * clas::sysctlname(char const * const str) {
 	using namespace utility::literals;
 	using utility::highlight;
@@ -92,6 +92,18 @@ types::ms ival(char const * const str);
  */
 size_t samples(char const * const str);
 
+/**
+ * A string encoded number of threads.
+ *
+ * The string is expected to contain a scalar integer.
+ *
+ * @param str
+ *	The string containing the number of threads
+ * @return
+ *	The number of threads
+ */
+types::coreid_t threads(char const * const str);
+
 /**
  * Convert string to temperature in dK.
  *
@@ -110,6 +122,43 @@ size_t samples(char const * const str);
  */
 types::decikelvin_t temperature(char const * const str);
 
+/**
+ * Convert string to a controller gain in 1/1024 units.
+ *
+ * The given string must have the following format:
+ *
+ * \verbatim
+ * gain = <float>;
+ * \endverbatim
+ *
+ * The gain must be in the range [0.0, 64.0].
+ *
+ * @param str
+ *	A string encoded gain
+ * @return
+ *	The gain given by str multiplied by 1024
+ */
+unsigned int gain(char const * const str);
+
+/**
+ * Convert string to an energy/performance preference.
+ *
+ * The given string must have the following format:
+ *
+ * \verbatim
+ * epp = <float>, [ "%" ];
+ * \endverbatim
+ *
+ * The preference must be in the range [0, 100], 0 prefers
+ * performance, 100 prefers energy saving.
+ *
+ * @param str
+ *	A string encoded energy/performance preference
+ * @return
+ *	The preference given by str
+ */
+types::epp_t epp(char const * const str);
+
 /**
  * Converts dK into °C for display purposes.
  *
@@ -23,6 +23,11 @@ namespace constants {
  */
 char const * const CP_TIMES = "kern.cp_times";
 
+/**
+ * The MIB name for the CPU topology.
+ */
+char const * const TOPOLOGY = "kern.sched.topology_spec";
+
 /**
  * The MIB name for the AC line state.
  */
@@ -63,6 +68,26 @@ char const * const FREQ_DRIVER_BLACKLIST[]{
 	"hwpstate_"
 };
 
+/**
+ * The MIB name for the energy/performance preference of a hardware
+ * P-state driver.
+ *
+ * The device name and unit are taken from the frequency driver,
+ * e.g. hwpstate_intel0 controls dev.hwpstate_intel.0.epp.
+ */
+char const * const EPP = "dev.%s.%d.epp";
+
+/**
+ * A list of driver prefixes, that are known to provide an
+ * energy/performance preference.
+ *
+ * This is used to emulate the preference when replaying load records
+ * that do not contain it.
+ */
+char const * const EPP_DRIVERS[]{
+	"hwpstate_intel"
+};
+
 /*
  * Default values.
  */
@@ -82,6 +107,34 @@ types::mhz_t const FREQ_DEFAULT_MIN{0};
  */
 types::mhz_t const FREQ_UNSET{1000001};
 
+/**
+ * Default energy/performance preference for the highest clock
+ * frequency.
+ */
+types::epp_t const EPP_DEFAULT_MIN{0};
+
+/**
+ * Default energy/performance preference for the lowest clock
+ * frequency.
+ */
+types::epp_t const EPP_DEFAULT_MAX{100};
+
+/**
+ * The energy/performance preference assumed for load records that do
+ * not contain it.
+ */
+types::epp_t const EPP_BALANCED{50};
+
+/**
+ * Energy/performance preference representing an uninitialised value.
+ */
+types::epp_t const EPP_UNSET{~0u};
+
+/**
+ * Controller gain representing an uninitialised value.
+ */
+unsigned int const GAIN_UNSET{~0u};
+
 /**
  * The default pidfile name of powerd.
  */
@@ -102,6 +155,24 @@ types::cptime_t const HADP{384};
  */
 types::decikelvin_t const HITEMP_OFFSET{100};
 
+/**
+ * The load change that shrinks the adaptive polling interval, equals 25%
+ * of the core group clock.
+ */
+types::cptime_t const POLL_SHRINK_LOAD{256};
+
+/**
+ * The load change below which the adaptive polling interval is stretched,
+ * equals 6.25% of the core group clock.
+ */
+types::cptime_t const POLL_STRETCH_LOAD{64};
+
+/**
+ * Core groups with a maximum clock frequency below this fraction of the
+ * highest maximum clock frequency are efficiency cores, equals 87.5%.
+ */
+types::cptime_t const EFFICIENCY_FREQ{896};
+
 } /* namespace constants */
 
 #endif /* _POWERDXX_CONSTANTS_HPP_ */
@@ -44,6 +44,14 @@ enum class Exit : int {
 	EDRIVER,      /**< Frequency driver does not allow manual control */
 	ESYSCTLNAME,  /**< User provided sysctl contains invalid characters */
 	EFORMATFIELD, /**< Formatting string contains unexpected field */
+	EROPEN,       /**< Could not open file for reading */
+	ERECORD,      /**< The load recording cannot be interpreted */
+	EFILTER,      /**< The provided value is not a valid load filter */
+	EGAIN,        /**< The provided value is not a valid controller gain */
+	ETHREADS,     /**< The provided value is not a valid thread count */
+	ESHM,         /**< A shared memory object could not be created or opened */
+	ESTATS,       /**< The shared memory statistics cannot be interpreted */
+	EEPP,         /**< The provided value is not a valid energy/performance preference */
 	LENGTH        /**< Enum length */
 };
 
@@ -54,7 +62,9 @@ const char * const ExitStr[]{
 	"OK", "ECLARG", "EOUTOFRANGE", "ELOAD", "EFREQ", "EMODE", "EIVAL",
 	"ESAMPLES", "ESYSCTL", "ENOFREQ", "ECONFLICT", "EPID", "EFORBIDDEN",
 	"EDAEMON", "EWOPEN", "ESIGNAL", "ERANGEFMT", "ETEMPERATURE",
-	"EEXCEPT", "EFILE", "EEXEC", "EDRIVER", "ESYSCTLNAME", "EFORMATFIELD"
+	"EEXCEPT", "EFILE", "EEXEC", "EDRIVER", "ESYSCTLNAME", "EFORMATFIELD",
+	"EROPEN", "ERECORD", "EFILTER", "EGAIN", "ETHREADS", "ESHM",
+	"ESTATS", "EEPP"
 };
 
 static_assert(size_t{utility::to_value(Exit::LENGTH)} == utility::countof(ExitStr),
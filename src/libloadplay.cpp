@@ -7,10 +7,11 @@
  *
  * The following environment variables affect the operation of loadplay:
  *
- * | Variable     | Description             |
- * |--------------|-------------------------|
- * | LOADPLAY_IN  | Alternative input file  |
- * | LOADPLAY_OUT | Alternative output file |
+ * | Variable          | Description                  |
+ * |-------------------|------------------------------|
+ * | LOADPLAY_IN       | Alternative input file       |
+ * | LOADPLAY_OUT      | Alternative output file      |
+ * | LOADPLAY_TIMEWARP | Replay on a virtual clock    |
  *
  * @file
  */
@@ -18,32 +19,44 @@
 #include "utility.hpp"
 #include "constants.hpp"
 #include "version.hpp"
+#include "binrec.hpp"
+#include "platform/formats.hpp"
+#include "platform/emulate.hpp"
 #include "sys/env.hpp"
 #include "sys/io.hpp"
 
 #include <unordered_map>
+#include <functional> /* std::function */
 #include <map>
+#include <set>
 #include <string>
-#include <regex>
 #include <memory>    /* std::unique_ptr */
 #include <thread>
 #include <exception>
 #include <mutex>
+#include <condition_variable>
 #include <chrono>    /* std::chrono::steady_clock::now() */
 #include <vector>
-#include <algorithm> /* std::min() */
+#include <variant>
+#include <type_traits> /* std::is_same_v, std::decay_t */
+#include <algorithm> /* std::min(), std::max(), std::copy(), std::nth_element() */
+#include <cmath>     /* std::ceil(), std::fma(), std::floor() */
+#include <charconv>  /* std::to_chars() */
 
-#include <cstring>   /* strncmp() */
+#include <cstring>   /* strncmp(), strchr() */
 #include <cassert>   /* assert() */
 #include <csignal>   /* raise() */
+#include <ctime>     /* clock_gettime(), nanosleep() */
 
 #include <sys/types.h>
 #include <sys/sysctl.h>
 #include <sys/resource.h>  /* CPUSTATES */
+#include <sys/mman.h>      /* mmap(), munmap() */
+#include <sys/stat.h>      /* fstat() */
 #include <libutil.h>       /* struct pidfh */
 
 #include <dlfcn.h>         /* dlfung() */
-#include <unistd.h>        /* getpid() */
+#include <unistd.h>        /* getpid(), usleep() */
 
 /**
  * File local scope.
@@ -57,6 +70,10 @@ using constants::FREQ_LEVELS;
 using constants::FREQ_DRIVER;
 using constants::TEMPERATURE;
 using constants::TJMAX_SOURCES;
+using constants::TOPOLOGY;
+using constants::EPP;
+using constants::EPP_DRIVERS;
+using constants::EPP_BALANCED;
 
 using utility::sprintf_safe;
 using namespace utility::literals;
@@ -66,14 +83,18 @@ using utility::FromChars;
 using types::ms;
 using types::cptime_t;
 using types::mhz_t;
+using types::epp_t;
+using types::mw_t;
 using types::coreid_t;
-using cycles_t = uint64_t;  /**< Clock cycle counting type. */
+using platform::emulate::cycles_t;
+using platform::emulate::CP_PRIORITY;
 
 using version::LOADREC_FEATURES;
 using version::flag_t;
 using namespace version::literals;
 
 namespace io = sys::io;
+namespace emulate = platform::emulate;
 
 /**
  * Output file type alias.
@@ -97,7 +118,8 @@ template <auto Ownership> using ifile = io::file<Ownership, io::read>;
  * This value is used to ensure correct input data interpretation.
  */
 constexpr flag_t const FEATURES{
-	1_FREQ_TRACKING
+	1_FREQ_TRACKING |
+	1_BINARY
 };
 
 /**
@@ -118,18 +140,6 @@ inline int strcmp(char const * const s1, char const (&s2)[Size]) {
 	return strncmp(s1, s2, Size);
 }
 
-/**
- * User defined literal for regular expressions.
- *
- * @param str,len
- *	The literal string and its length
- * @return
- *	A regular expression
- */
-inline std::regex operator "" _r(char const * const str, size_t const len) {
-	return {str, len, std::regex::ECMAScript};
-}
-
 /**
  * Calls io::ferr.printf(...) if built with -DEBUG.
  *
@@ -330,13 +340,23 @@ class SysctlValue {
 	 */
 	unsigned int type;
 
+	/**
+	 * The storage type for sysctl values.
+	 *
+	 * Strings for CTLTYPE_STRING, arrays of the native type for
+	 * numerical CTLTYPEs.
+	 */
+	using value_t = std::variant<std::string, std::vector<int>,
+	                             std::vector<long>, std::vector<uint64_t>>;
+
 	/**
 	 * The value of the sysctl.
 	 *
-	 * This is stored as a string and converted to the appropriate
-	 * type by the set() and get() methods.
+	 * Numerical values are stored as arrays of their native type,
+	 * so get() and set() calls do not have to parse or format
+	 * strings. A string representation is only created on demand.
 	 */
-	std::string value;
+	value_t value;
 
 	/**
 	 * Callback function handle.
@@ -349,21 +369,68 @@ class SysctlValue {
 	typedef decltype(onSet)::function_t callback_function;
 
 	/**
-	 * Provide the size of this value represented as a string of Ts.
+	 * Provide empty storage for the given CTLTYPE.
 	 *
-	 * @tparam T
-	 *	The type this value is supposed to be a array of
+	 * @param type
+	 *	The CTLTYPE
 	 * @return
-	 *	The size of the whole string of Ts
+	 *	A value of the native storage type
 	 */
-	template <typename T>
-	size_t size() const {
-		std::scoped_lock const lock{this->mtx};
-		size_t count = 0;
-		T value;
-		for (auto fetch = FromChars{this->value};
-		     fetch(value); ++count);
-		return count * sizeof(T);
+	static value_t storage(unsigned int const type) {
+		switch (type) {
+		case CTLTYPE_INT:
+			return std::vector<int>{};
+		case CTLTYPE_LONG:
+			return std::vector<long>{};
+		case CTLTYPE_U64:
+			return std::vector<uint64_t>{};
+		default:
+			return std::string{};
+		}
+	}
+
+	/**
+	 * Parse a string representation of the value into the
+	 * native storage.
+	 *
+	 * @param str
+	 *	The string representation of the value
+	 */
+	void parse(std::string const & str) {
+		std::visit([&str](auto & dst) {
+			using StorageT = std::decay_t<decltype(dst)>;
+			if constexpr (std::is_same_v<StorageT, std::string>) {
+				dst = str;
+			} else {
+				dst.clear();
+				typename StorageT::value_type value{};
+				for (auto fetch = FromChars{str}; fetch(value);) {
+					dst.push_back(value);
+				}
+			}
+		}, this->value);
+	}
+
+	/**
+	 * Create a string representation of the value.
+	 *
+	 * @return
+	 *	The value string, array members are space separated
+	 */
+	std::string str() const {
+		return std::visit([](auto const & src) {
+			using StorageT = std::decay_t<decltype(src)>;
+			if constexpr (std::is_same_v<StorageT, std::string>) {
+				return src;
+			} else {
+				std::string result;
+				for (size_t i = 0; i < src.size(); ++i) {
+					result += (i ? " " : "") +
+					          std::to_string(src[i]);
+				}
+				return result;
+			}
+		}, this->value);
 	}
 
 	public:
@@ -408,7 +475,9 @@ class SysctlValue {
 	 */
 	SysctlValue(unsigned int type, std::string const & value,
 	            callback_function const callback = nullptr) :
-	    type{type}, value{value}, onSet{callback} {}
+	    type{type}, value{storage(type)}, onSet{callback} {
+		this->parse(value);
+	}
 
 	/**
 	 * Copy assignment operator.
@@ -455,13 +524,14 @@ class SysctlValue {
 
 		switch (this->type) {
 		case CTLTYPE_STRING:
-			return this->value.size() + 1;
 		case CTLTYPE_INT:
-			return size<int>();
 		case CTLTYPE_LONG:
-			return size<long>();
 		case CTLTYPE_U64:
-			return size<uint64_t>();
+			return std::visit([](auto const & src) {
+				return (src.size() + std::is_same_v<
+				        std::decay_t<decltype(src)>, std::string>) *
+				       sizeof(src[0]);
+			}, this->value);
 		default:
 			throw -1;
 		}
@@ -483,12 +553,23 @@ class SysctlValue {
 	template <typename T>
 	int get(T * dst, size_t & size) const {
 		std::scoped_lock const lock{this->mtx};
-		size /= sizeof(T);
-		size_t i = 0;
-		auto fetch = FromChars{this->value};
-		for (; i < size && fetch(dst[i]); ++i);
-		size = i * sizeof(T);
-		return errno = fetch * ENOMEM, -fetch;
+		return std::visit([dst, &size](auto const & src) {
+			using StorageT = std::decay_t<decltype(src)>;
+			auto const count = size / sizeof(T);
+			if constexpr (std::is_same_v<StorageT, std::string>) {
+				size_t i = 0;
+				auto fetch = FromChars{src};
+				for (; i < count && fetch(dst[i]); ++i);
+				size = i * sizeof(T);
+				return errno = fetch * ENOMEM, -fetch;
+			} else {
+				auto const copied = std::min(count, src.size());
+				std::copy(src.begin(), src.begin() + copied, dst);
+				size = copied * sizeof(T);
+				bool const truncated = copied < src.size();
+				return errno = truncated * ENOMEM, -truncated;
+			}
+		}, this->value);
 	}
 
 	/**
@@ -504,7 +585,8 @@ class SysctlValue {
 	 */
 	int get(char * dst, size_t & size) const {
 		std::scoped_lock const lock{this->mtx};
-		auto const strsize = this->value.size();
+		auto const value = this->str();
+		auto const strsize = value.size();
 		size = std::min(strsize, size - 1);
 		for (size_t i = 0; i < size; ++i) { dst[i] = value[i]; }
 		dst[size] = 0;
@@ -524,12 +606,23 @@ class SysctlValue {
 	template <typename T>
 	T get() const {
 		std::scoped_lock const lock{this->mtx};
-		T result{};
-		auto fetch = FromChars{this->value};
-		if (!fetch(result)) {
-			return errno = EINVAL, result;
-		}
-		return errno = fetch * ENOMEM, result;
+		return std::visit([](auto const & src) {
+			using StorageT = std::decay_t<decltype(src)>;
+			T result{};
+			if constexpr (std::is_same_v<StorageT, std::string>) {
+				auto fetch = FromChars{src};
+				if (!fetch(result)) {
+					return errno = EINVAL, result;
+				}
+				return errno = fetch * ENOMEM, result;
+			} else {
+				if (src.empty()) {
+					return errno = EINVAL, result;
+				}
+				result = static_cast<T>(src[0]);
+				return errno = (src.size() > 1) * ENOMEM, result;
+			}
+		}, this->value);
 	}
 
 	/**
@@ -570,11 +663,21 @@ class SysctlValue {
 	 */
 	template <typename T>
 	void set(T const * const newp, size_t newlen) {
-		std::string value;
-		for (size_t i = 0; i < newlen / sizeof(T); ++i) {
-			value += (i ? " " : "") + std::to_string(newp[i]);
-		}
-		set(std::move(value));
+		std::scoped_lock const lock{this->mtx};
+		auto const count = newlen / sizeof(T);
+		std::visit([newp, count](auto & dst) {
+			using StorageT = std::decay_t<decltype(dst)>;
+			if constexpr (std::is_same_v<StorageT, std::string>) {
+				dst.clear();
+				for (size_t i = 0; i < count; ++i) {
+					dst += (i ? " " : "") +
+					       std::to_string(newp[i]);
+				}
+			} else {
+				dst.assign(newp, newp + count);
+			}
+		}, this->value);
+		this->onSet(*this);
 	}
 
 	/**
@@ -615,7 +718,11 @@ class SysctlValue {
 	 */
 	void set(std::string && value) {
 		std::scoped_lock const lock{this->mtx};
-		this->value = std::move(value);
+		if (auto str = std::get_if<std::string>(&this->value)) {
+			*str = std::move(value);
+		} else {
+			this->parse(value);
+		}
 		this->onSet(*this);
 	}
 
@@ -627,7 +734,7 @@ class SysctlValue {
 	 */
 	void set(std::string const & value) {
 		std::scoped_lock const lock{this->mtx};
-		this->value = value;
+		this->parse(value);
 		this->onSet(*this);
 	}
 
@@ -641,7 +748,7 @@ class SysctlValue {
 	 */
 	template <typename T>
 	void set(T const & value) {
-		this->set(std::to_string(value));
+		this->set(&value, sizeof(T));
 	}
 
 	/**
@@ -676,7 +783,7 @@ class SysctlValue {
 template <>
 std::string SysctlValue::get<std::string>() const {
 	std::scoped_lock const lock{this->mtx};
-	return this->value;
+	return this->str();
 }
 
 /**
@@ -776,7 +883,8 @@ class Sysctls {
 		{LOADREC_FEATURES, {1004}},
 		{FREQ_DRIVER,      {1005, -1}},
 		{TEMPERATURE,      {1006, -1}},
-		{TJMAX_SOURCES[0], {1007, -1}}
+		{TJMAX_SOURCES[0], {1007, -1}},
+		{TOPOLOGY,         {1008}}
 	};
 
 	/**
@@ -794,9 +902,68 @@ class Sysctls {
 		{{1005, -1},           {CTLTYPE_STRING, ""}},
 		{{1006, -1},           {CTLTYPE_INT,    "-1"}},
 		{{1007, -1},           {CTLTYPE_INT,    "-1"}},
+		{{1008},               {CTLTYPE_STRING, ""}},
 	};
 
+	/**
+	 * Split a sysctl name into a base name and a number.
+	 *
+	 * The first purely numerical component of the name is replaced
+	 * with `%d` in a single pass, e.g. "dev.cpu.0.freq" is split
+	 * into "dev.cpu.%d.freq" and 0.
+	 *
+	 * @param name
+	 *	The MIB name
+	 * @param base
+	 *	Set to the base name
+	 * @param number
+	 *	Set to the numerical component
+	 * @retval true
+	 *	The name contains a numerical component
+	 * @retval false
+	 *	The name does not contain a numerical component, base
+	 *	and number are not updated
+	 */
+	static bool splitName(char const * const name, std::string & base,
+	                      int & number) {
+		for (auto it = name; (it = std::strchr(it, '.')); ) {
+			auto const first = ++it;
+			for (; *it >= '0' && *it <= '9'; ++it);
+			if (it == first || *it != '.') {
+				continue;
+			}
+			if (std::from_chars(first, it, number).ptr != it) {
+				return false;
+			}
+			base.assign(name, first);
+			base += "%d";
+			base += it;
+			return true;
+		}
+		return false;
+	}
+
 	public:
+	/**
+	 * Register the energy/performance preference sysctl of each
+	 * driver in constants::EPP_DRIVERS.
+	 */
+	Sysctls() {
+		int ctl = 1009;
+		for (auto const driver : EPP_DRIVERS) {
+			char name[64];
+			sprintf_safe(name, EPP, driver, 0);
+			std::string base;
+			int number{0};
+			if (!splitName(name, base, number)) {
+				continue;
+			}
+			this->mibs[base] = {ctl, -1};
+			this->sysctls[{ctl, -1}] = {CTLTYPE_INT, "-1"};
+			++ctl;
+		}
+	}
+
 	/**
 	 * Add a value to the sysctls map.
 	 *
@@ -819,30 +986,30 @@ class Sysctls {
 	 *	The value to store
 	 */
 	void addValue(std::string const & name, std::string const & value) {
-		try {
-			std::scoped_lock const lock{this->mtx};
-			this->sysctls[this->mibs.at(name)].set(value);
-		} catch (std::out_of_range &) {
-			/* get the base mib */
-			mib_t mib{}, baseMib{};
-			try {
-				mib = baseMib = getBaseMib(name.c_str());
-			} catch (std::out_of_range &) {
-				warn("unsupported sysctl: %s\n", name.c_str());
-				return;
-			}
-			/* get mib numbers */
-			std::smatch match;
-			auto const expr = "\\.([0-9]+)\\."_r;
-			if (std::regex_search(name, match, expr) &&
-			    FromChars{match[1]}(mib[1])) {
-				std::scoped_lock const lock{this->mtx};
-				/* map name → mib */
-				this->mibs[name] = mib;
-				/* inherit type from base */
-				(this->sysctls[mib] = this->sysctls[baseMib]).set(value);
-			}
+		std::scoped_lock const lock{this->mtx};
+		if (auto const it = this->mibs.find(name);
+		    it != this->mibs.end()) {
+			this->sysctls[it->second].set(value);
+			return;
 		}
+
+		/* get the base mib and mib number */
+		std::string base;
+		int number{0};
+		auto const it = splitName(name.c_str(), base, number) ?
+		                this->mibs.find(base) : this->mibs.end();
+		if (it == this->mibs.end()) {
+			warn("unsupported sysctl: %s\n", name.c_str());
+			return;
+		}
+		auto const & baseMib = it->second;
+		mib_t mib = baseMib;
+		mib[1] = number;
+
+		/* map name → mib */
+		this->mibs[name] = mib;
+		/* inherit type from base */
+		(this->sysctls[mib] = this->sysctls[baseMib]).set(value);
 	}
 
 	/**
@@ -871,9 +1038,12 @@ class Sysctls {
 	 */
 	mib_t const & getBaseMib(char const * const name) const {
 		std::scoped_lock const lock{this->mtx};
-		auto const expr = "\\.([0-9]+)\\."_r;
-		auto const baseName = std::regex_replace(name, expr, ".%d.");
-		return this->mibs.at(baseName);
+		std::string base;
+		int number{0};
+		if (!splitName(name, base, number)) {
+			throw std::out_of_range{name};
+		}
+		return this->mibs.at(base);
 	}
 
 	/**
@@ -903,208 +1073,942 @@ class Sysctls {
 } sysctls{}; /**< Sole instance of \ref Sysctls. */
 
 /**
- * The reported state of a single CPU pipeline.
+ * Singleton class providing a virtual monotonic clock.
+ *
+ * In time warp mode the intercepted clock_gettime(), usleep() and
+ * nanosleep() functions use this clock instead of the system clock.
+ * The clock only advances when the Emulator finished a frame and
+ * all participating threads of the host process are sleeping, so
+ * frames are played as fast as the host process consumes them.
+ *
+ * A thread of the host process becomes a participant when it calls
+ * an intercepted sleep function for the first time. The main thread
+ * is enrolled during startup. Participants leave when they exit,
+ * see VclockParticipant.
+ *
+ * Instances are thread safe.
  */
-struct CoreReport {
+class VirtualClock {
+	public:
 	/**
-	 * The core clock frequency in [MHz].
+	 * The clock resolution.
 	 */
-	mhz_t freq;
+	using ns = std::chrono::nanoseconds;
 
+	private:
 	/**
-	 * The core load as a fraction.
+	 * A simple mutex.
 	 */
-	double load;
-};
+	std::mutex mutable mtx;
 
-/**
- * The report frame information for a single CPU pipeline.
- */
-struct CoreFrameReport {
 	/**
-	 * The recorded core state.
+	 * Signals changes of the clock state.
 	 */
-	CoreReport rec;
+	std::condition_variable wakeup;
 
 	/**
-	 * The running core state.
+	 * Set if time warp mode is active.
 	 */
-	CoreReport run;
-};
-
-/**
- * Print recorded and running clock frequency and load for a frame.
- *
- * The clock frequency is printed at 1 MHz resolution, the load at
- * 0.1 MHz.
- *
- * @param fout
- *	The stream to print to
- * @param frame
- *	The frame information to print
- * @return
- *	A reference to the out stream
- */
-ofile<io::link>
-operator <<(ofile<io::link> fout, CoreFrameReport const & frame) {
-	return fout.printf(" %d %.1f %d %.1f",
-	                   frame.rec.freq, frame.rec.load * frame.rec.freq,
-	                   frame.run.freq, frame.run.load * frame.run.freq);
-}
+	bool active{false};
 
-/**
- * Provides a mechanism to provide frame wise per core load information.
- */
-class Report {
-	private:
 	/**
-	 * The output stream to report to.
+	 * Set when the emulation is over.
 	 */
-	ofile<io::link> fout;
+	bool stopped{false};
 
 	/**
-	 * The number of cpu cores to provide reports for.
+	 * The current time.
 	 */
-	coreid_t const ncpu;
+	ns time{0};
 
 	/**
-	 * The time passed in [ms].
+	 * The number of participating threads not sleeping.
 	 */
-	Sum<uint64_t> time;
+	size_t awake{0};
 
 	/**
-	 * Per frame per core data.
+	 * The wakeup times of all sleeping threads.
 	 */
-	std::unique_ptr<CoreFrameReport[]> cores;
+	std::multiset<ns> deadlines;
 
 	public:
 	/**
-	 * Construct a report.
+	 * Turn on time warp mode.
 	 *
-	 * @param fout
-	 *	The stream to output to
-	 * @param ncpu
-	 *	The number of CPU cores to report
+	 * @param start
+	 *	The initial time of the clock
 	 */
-	Report(ofile<io::link> fout, coreid_t const ncpu) :
-	    fout{fout}, ncpu{ncpu}, time{}, cores{new CoreFrameReport[ncpu]{}} {
-		fout.print("time[s]");
-		for (coreid_t i = 0; i < ncpu; ++i) {
-			fout.printf(" cpu.%d.rec.freq[MHz] cpu.%d.rec.load[MHz]"
-			            " cpu.%d.run.freq[MHz] cpu.%d.run.load[MHz]",
-			            i, i, i, i);
-		}
-		fout.putc('\n').flush();
+	void activate(ns const start) {
+		std::scoped_lock const lock{this->mtx};
+		this->active = true;
+		this->time = start;
 	}
 
 	/**
-	 * Represents a frame of the report.
-	 *
-	 * It provides access to each CoreFrameReport via the subscript
-	 * operator [].
+	 * Add an awake participating thread.
+	 */
+	void enrol() {
+		std::scoped_lock const lock{this->mtx};
+		++this->awake;
+	}
+
+	/**
+	 * Remove an awake participating thread.
+	 */
+	void leave() {
+		std::scoped_lock const lock{this->mtx};
+		--this->awake;
+		this->wakeup.notify_all();
+	}
+
+	/**
+	 * Returns whether time warp mode is active.
 	 *
-	 * The frame data is output when the frame goes out of scope.
+	 * @return
+	 *	Whether the virtual clock replaces the system clock
 	 */
-	class Frame {
-		private:
-		/**
-		 * The report this frame belongs to.
-		 */
-		Report & report;
+	explicit operator bool() const {
+		std::scoped_lock const lock{this->mtx};
+		return this->active;
+	}
 
-		public:
-		/**
-		 * Construct a report frame.
-		 *
-		 * @param report
-		 *	The report this frame belongs to
-		 * @param duration
-		 *	The frame duration
-		 */
-		Frame(Report & report, uint64_t const duration) :
-		    report{report} {
-			report.time += duration;
-		}
+	/**
+	 * Returns the current time.
+	 *
+	 * @return
+	 *	The time of the virtual clock
+	 */
+	ns now() const {
+		std::scoped_lock const lock{this->mtx};
+		return this->time;
+	}
 
-		/**
-		 * Subscript operator for per core frame report data.
-		 *
-		 * @param i
-		 *	The core index
-		 * @return
-		 *	A reference to the core frame data
-		 */
-		CoreFrameReport & operator [](coreid_t const i) {
-			assert(i < this->report.ncpu && "out of bounds access");
-			return this->report.cores[i];
+	/**
+	 * Sleep the calling thread for the given duration.
+	 *
+	 * The calling thread must be an enrolled participant.
+	 *
+	 * @param duration
+	 *	The virtual time to sleep
+	 * @param remaining
+	 *	Set to the remaining sleeping time
+	 * @retval true
+	 *	The sleep completed
+	 * @retval false
+	 *	The sleep was interrupted, because the emulation ended
+	 */
+	bool sleep(ns const duration, ns & remaining) {
+		std::unique_lock lock{this->mtx};
+		auto const deadline = this->time + duration;
+		remaining = duration;
+		if (this->stopped) {
+			return false;
 		}
+		this->deadlines.insert(deadline);
+		--this->awake;
+		this->wakeup.notify_all();
+		/* advance() takes the deadline and wakes the thread */
+		this->wakeup.wait(lock, [this, deadline]() {
+			return this->stopped || this->time >= deadline;
+		});
+		remaining = std::max(deadline - this->time, ns{0});
+		return this->time >= deadline;
+	}
 
-		/**
-		 * Subscript operator for per core frame report data.
-		 *
-		 * @param i
-		 *	The core index
-		 * @return
-		 *	A const reference to the core frame data
-		 */
-		CoreFrameReport const & operator [](coreid_t const i) const {
-			assert(i < this->report.ncpu && "out of bounds access");
-			return this->report.cores[i];
-		}
+	/**
+	 * Wait for all participating threads to go to sleep.
+	 *
+	 * @retval true
+	 *	All participating threads are sleeping
+	 * @retval false
+	 *	The clock was stopped
+	 */
+	bool sync() {
+		std::unique_lock lock{this->mtx};
+		this->wakeup.wait(lock, [this]() {
+			return this->stopped || !this->awake;
+		});
+		return !this->stopped;
+	}
 
-		/**
-		 * Finalises the frame by outputting it.
-		 */
-		~Frame() {
-			auto fout = this->report.fout;
-			fout.printf("%d.%03d", this->report.time / 1000,
-			            this->report.time % 1000);
-			for (coreid_t i = 0; i < this->report.ncpu; ++i) {
-				fout << (*this)[i];
+	/**
+	 * Advance the clock by the given duration.
+	 *
+	 * The clock is advanced step by step, from one wakeup time
+	 * to the next. Each step waits for all participating threads
+	 * to go back to sleep.
+	 *
+	 * @param duration
+	 *	The time to advance the clock by
+	 * @retval true
+	 *	The clock was advanced
+	 * @retval false
+	 *	The clock was stopped
+	 */
+	bool advance(ns const duration) {
+		std::unique_lock lock{this->mtx};
+		auto const end = this->time + duration;
+		while (true) {
+			this->wakeup.wait(lock, [this]() {
+				return this->stopped || !this->awake;
+			});
+			if (this->stopped) {
+				return false;
+			}
+			auto it = this->deadlines.begin();
+			if (it == this->deadlines.end() || *it > end) {
+				break;
 			}
-			fout.putc('\n').flush();
+			/* wake up all threads due at the next deadline */
+			this->time = *it;
+			for (; it != this->deadlines.end() && *it <= this->time;
+			     it = this->deadlines.erase(it)) {
+				++this->awake;
+			}
+			this->wakeup.notify_all();
 		}
-	};
+		this->time = end;
+		return true;
+	}
 
 	/**
-	 * Constructs a frame for this report.
+	 * Stop the clock.
 	 *
-	 * @tparam ArgTs
-	 *	The constructor argument types
-	 * @param args
-	 *	The constructor arguments
+	 * All sleeping threads are interrupted, successive sleeps
+	 * fail immediately.
 	 */
-	template <typename ... ArgTs>
-	Frame frame(ArgTs && ... args) {
-		return {*this, std::forward<ArgTs>(args) ...};
+	void stop() {
+		std::scoped_lock const lock{this->mtx};
+		this->stopped = true;
+		this->wakeup.notify_all();
 	}
-};
+} vclock{}; /**< Sole instance of \ref VirtualClock. */
 
 /**
- * Instances of this class represent an emulator session.
+ * The participation of a thread of the host process in the virtual
+ * clock synchronisation.
  *
- * This should be run in its own thread and expects the sysctl table
- * to be complete.
+ * A thread that exits leaves the synchronisation, so it cannot
+ * stall the clock.
  */
-class Emulator {
+class VclockParticipant {
 	private:
 	/**
-	 * The input data source.
+	 * Set if the thread is a participant.
 	 */
-	ifile<io::link> fin;
+	bool enrolled{false};
 
+	public:
 	/**
-	 * The output data sink.
+	 * Enrol the thread, unless it already is a participant.
 	 */
-	ofile<io::link> fout;
+	void enrol() {
+		if (!this->enrolled) {
+			this->enrolled = true;
+			vclock.enrol();
+		}
+	}
 
 	/**
-	 * A reference to a bool that tells the emulator to die.
+	 * Leave the synchronisation.
 	 */
-	bool const & die;
+	~VclockParticipant() {
+		if (this->enrolled) {
+			vclock.leave();
+		}
+	}
+};
 
-	/**
-	 * The size of the kern.cp_times buffer.
+/**
+ * The virtual clock participation of the current thread.
+ */
+thread_local VclockParticipant vclock_participant{};
+
+/**
+ * The reported state of a single CPU pipeline.
+ */
+struct CoreReport {
+	/**
+	 * The core clock frequency in [MHz].
+	 */
+	mhz_t freq;
+
+	/**
+	 * The core load as a fraction.
+	 */
+	double load;
+
+	/**
+	 * The estimated energy consumed during the frame in [mJ].
+	 */
+	double energy;
+};
+
+/**
+ * The report frame information for a single CPU pipeline.
+ */
+struct CoreFrameReport {
+	/**
+	 * The recorded core state.
+	 */
+	CoreReport rec;
+
+	/**
+	 * The running core state.
+	 */
+	CoreReport run;
+
+	/**
+	 * The cycles carried over to the next frame for each CPU state
+	 * in [cycles].
+	 */
+	cycles_t carry[CPUSTATES];
+};
+
+/**
+ * The CPU state names.
+ */
+constexpr char const * const CP_NAMES[CPUSTATES]{
+	"user", "nice", "sys", "intr", "idle"
+};
+static_assert(CP_USER == 0 && CP_NICE == 1 && CP_SYS == 2 &&
+              CP_INTR == 3 && CP_IDLE == 4,
+              "CP_NAMES must match the CPU state order");
+
+/**
+ * Collects backlog delay samples and provides statistics.
+ *
+ * Only non-zero samples are stored, because the backlog is empty
+ * most of the time.
+ */
+class DelayStats {
+	private:
+	/**
+	 * The non-zero samples in [ms].
+	 */
+	std::vector<double> samples{};
+
+	/**
+	 * The number of samples including zero samples.
+	 */
+	size_t count{0};
+
+	/**
+	 * The sum of all samples in [ms].
+	 */
+	double sum{0};
+
+	public:
+	/**
+	 * Add a sample.
+	 *
+	 * @param delay
+	 *	The backlog delay in [ms]
+	 */
+	void add(double const delay) {
+		++this->count;
+		if (delay > 0) {
+			this->samples.push_back(delay);
+			this->sum += delay;
+		}
+	}
+
+	/**
+	 * Returns the mean delay.
+	 *
+	 * @return
+	 *	The mean of all samples in [ms]
+	 */
+	double mean() const {
+		return this->count ? this->sum / this->count : 0;
+	}
+
+	/**
+	 * Returns a quantile of the delay.
+	 *
+	 * This reorders the stored samples.
+	 *
+	 * @param q
+	 *	The quantile in the range [0, 1]
+	 * @return
+	 *	The smallest sample not exceeded by the given fraction
+	 *	of samples in [ms]
+	 */
+	double quantile(double const q) {
+		auto const rank = static_cast<size_t>(std::ceil(q * this->count));
+		auto const zeros = this->count - this->samples.size();
+		if (rank <= zeros) {
+			return 0;
+		}
+		auto const it = this->samples.begin() + (rank - zeros - 1);
+		std::nth_element(this->samples.begin(), it, this->samples.end());
+		return *it;
+	}
+
+	/**
+	 * Returns the maximum delay.
+	 *
+	 * @return
+	 *	The greatest sample in [ms]
+	 */
+	double max() const {
+		return this->samples.empty() ?
+		       0 : *std::max_element(this->samples.begin(),
+		                             this->samples.end());
+	}
+};
+
+/**
+ * A preallocated output buffer with allocation free number formatting.
+ *
+ * The buffer is written to the output stream when it runs out of
+ * space for another line, or at the end of a line if the last write
+ * lies back more than the flush interval.
+ */
+class OutputBuffer {
+	private:
+	/**
+	 * The maximum time between writes.
+	 */
+	static constexpr ms const INTERVAL{1000};
+
+	/**
+	 * The output stream to write to.
+	 */
+	ofile<io::link> fout;
+
+	/**
+	 * The buffer size.
+	 */
+	size_t const size;
+
+	/**
+	 * The buffer.
+	 */
+	std::unique_ptr<char[]> const buf;
+
+	/**
+	 * The next character to write to.
+	 */
+	char * pos;
+
+	/**
+	 * The time of the last write to the output stream.
+	 */
+	std::chrono::steady_clock::time_point written;
+
+	public:
+	/**
+	 * Construct an output buffer.
+	 *
+	 * @param fout
+	 *	The output stream to write to
+	 * @param size
+	 *	The buffer size
+	 */
+	OutputBuffer(ofile<io::link> fout, size_t const size) :
+	    fout{fout}, size{size}, buf{new char[size]}, pos{buf.get()},
+	    written{std::chrono::steady_clock::now()} {}
+
+	/**
+	 * Write the remaining buffer contents.
+	 */
+	~OutputBuffer() {
+		this->flush();
+	}
+
+	/**
+	 * Write the buffer contents to the output stream.
+	 */
+	void flush() {
+		this->fout.write(this->buf.get(),
+		                 static_cast<size_t>(this->pos - this->buf.get()));
+		this->fout.flush();
+		this->pos = this->buf.get();
+		this->written = std::chrono::steady_clock::now();
+	}
+
+	/**
+	 * Ensure space for a line of output.
+	 *
+	 * @param len
+	 *	The maximum length of the line
+	 */
+	void reserve(size_t const len) {
+		assert(len <= this->size && "line exceeds buffer size");
+		if (this->buf.get() + this->size - this->pos <
+		    static_cast<ptrdiff_t>(len)) {
+			this->flush();
+		}
+	}
+
+	/**
+	 * Conclude a line of output.
+	 */
+	void endl() {
+		*this << '\n';
+		if (std::chrono::steady_clock::now() - this->written >= INTERVAL) {
+			this->flush();
+		}
+	}
+
+	/**
+	 * Append a character.
+	 *
+	 * @param ch
+	 *	The character to append
+	 * @return
+	 *	A self reference
+	 */
+	OutputBuffer & operator <<(char const ch) {
+		*this->pos++ = ch;
+		return *this;
+	}
+
+	/**
+	 * Append an integer.
+	 *
+	 * @tparam T
+	 *	The integral type
+	 * @param value
+	 *	The value to append
+	 * @return
+	 *	A self reference
+	 */
+	template <typename T,
+	          std::enable_if_t<std::is_integral_v<T>, int> = 0>
+	OutputBuffer & operator <<(T const value) {
+		this->pos = std::to_chars(this->pos, this->buf.get() + this->size,
+		                          value).ptr;
+		return *this;
+	}
+
+	/**
+	 * Append a fixed point representation of a floating point value.
+	 *
+	 * @tparam Decimals
+	 *	The number of decimal places
+	 * @param value
+	 *	The value to append
+	 * @return
+	 *	A self reference
+	 */
+	template <unsigned Decimals>
+	OutputBuffer & fixed(double const value) {
+		constexpr auto const SCALE = [] {
+			uint64_t scale{1};
+			for (auto i = Decimals; i; --i) {
+				scale *= 10;
+			}
+			return scale;
+		}();
+		if (std::signbit(value)) {
+			*this << '-';
+		}
+		/*
+		 * Round like printf(3), i.e. round the exact binary value,
+		 * the rounding error of the multiplication breaks ties.
+		 */
+		auto const scaled = std::fabs(value) * SCALE;
+		auto const error = std::fma(std::fabs(value), SCALE, -scaled);
+		auto rounded = std::floor(scaled);
+		auto const rem = scaled - rounded;
+		if (rem > .5 || (rem == .5 &&
+		                 (error > 0 ||
+		                  (error == 0 && std::fmod(rounded, 2) != 0)))) {
+			rounded += 1;
+		}
+		auto const abs = static_cast<uint64_t>(rounded);
+		*this << abs / SCALE;
+		if constexpr (Decimals > 0) {
+			*this << '.';
+			auto frac = abs % SCALE;
+			for (auto i = Decimals; i; --i) {
+				this->pos[i - 1] = static_cast<char>('0' + frac % 10);
+				frac /= 10;
+			}
+			this->pos += Decimals;
+		}
+		return *this;
+	}
+};
+
+/**
+ * Append recorded and running clock frequency, load and energy and
+ * the work backlog for a frame.
+ *
+ * The clock frequency is printed at 1 MHz resolution, the load at
+ * 0.1 MHz, the energy at 1 µJ, the backlog at 1 kcycle and the
+ * backlog delay at 1 µs.
+ *
+ * @param out
+ *	The buffer to append to
+ * @param frame
+ *	The frame information to append
+ * @return
+ *	A reference to the buffer
+ */
+OutputBuffer & operator <<(OutputBuffer & out, CoreFrameReport const & frame) {
+	cycles_t carry{0};
+	for (auto const cycles : frame.carry) {
+		carry += cycles;
+	}
+	out << ' ' << frame.rec.freq << ' ';
+	out.fixed<1>(frame.rec.load * frame.rec.freq) << ' ';
+	out.fixed<3>(frame.rec.energy) << ' ' << frame.run.freq << ' ';
+	out.fixed<1>(frame.run.load * frame.run.freq) << ' ';
+	out.fixed<3>(frame.run.energy) << ' ';
+	out.fixed<3>(carry / 1000000.) << ' ';
+	return out.fixed<3>(frame.run.freq ?
+	                    carry / (frame.run.freq * 1000.) : 0.);
+}
+
+/**
+ * Provides a mechanism to provide frame wise per core load information.
+ */
+class Report {
+	private:
+	/**
+	 * The maximum number of characters per core in a line.
+	 */
+	static constexpr size_t const CORE_CHARS{8 * 24};
+
+	/**
+	 * The maximum number of characters of the per line columns.
+	 */
+	static constexpr size_t const LINE_CHARS{3 * 24 + 1};
+
+	/**
+	 * The number of cpu cores to provide reports for.
+	 */
+	coreid_t const ncpu;
+
+	/**
+	 * The maximum length of a line.
+	 */
+	size_t const lineMax;
+
+	/**
+	 * The buffer for the report output.
+	 */
+	OutputBuffer out;
+
+	/**
+	 * The time passed in [ms].
+	 */
+	Sum<uint64_t> time;
+
+	/**
+	 * The estimated energy consumed by all cores according to the
+	 * recording in [mJ].
+	 */
+	Sum<double> recEnergy;
+
+	/**
+	 * The estimated energy consumed by all cores during the
+	 * simulation in [mJ].
+	 */
+	Sum<double> runEnergy;
+
+	/**
+	 * The backlog delay statistics for each CPU state.
+	 */
+	DelayStats delays[CPUSTATES];
+
+	/**
+	 * Per frame per core data.
+	 */
+	std::unique_ptr<CoreFrameReport[]> cores;
+
+	public:
+	/**
+	 * Construct a report.
+	 *
+	 * @param fout
+	 *	The stream to output to
+	 * @param ncpu
+	 *	The number of CPU cores to report
+	 */
+	Report(ofile<io::link> fout, coreid_t const ncpu) :
+	    ncpu{ncpu}, lineMax{LINE_CHARS + CORE_CHARS * ncpu},
+	    out{fout, std::max(size_t{64} * 1024, 4 * lineMax)},
+	    time{}, recEnergy{}, runEnergy{},
+	    cores{new CoreFrameReport[ncpu]{}} {
+		fout.print("time[s]");
+		for (coreid_t i = 0; i < ncpu; ++i) {
+			fout.printf(" cpu.%d.rec.freq[MHz] cpu.%d.rec.load[MHz]"
+			            " cpu.%d.rec.energy[mJ]"
+			            " cpu.%d.run.freq[MHz] cpu.%d.run.load[MHz]"
+			            " cpu.%d.run.energy[mJ]"
+			            " cpu.%d.run.backlog[Mcycles]"
+			            " cpu.%d.run.delay[ms]",
+			            i, i, i, i, i, i, i, i);
+		}
+		fout.print(" rec.energy[J] run.energy[J]");
+		fout.putc('\n').flush();
+	}
+
+	/**
+	 * Print the backlog delay statistics on stderr.
+	 *
+	 * The delay of a CPU state is the time it takes to process
+	 * the backlog of the state and all states of higher priority
+	 * at the current clock frequency.
+	 */
+	~Report() {
+		this->out.flush();
+		if (!this->time) {
+			return;
+		}
+		io::ferr.printf("libloadplay: %-16s  %10s  %10s  %10s\n",
+		                "backlog delay", "mean[ms]", "p95[ms]",
+		                "max[ms]");
+		for (auto const state : CP_PRIORITY) {
+			auto & delays = this->delays[state];
+			io::ferr.printf("libloadplay: %-16s  %10.3f  %10.3f  %10.3f\n",
+			                CP_NAMES[state], delays.mean(),
+			                delays.quantile(.95), delays.max());
+		}
+	}
+
+	/**
+	 * Represents a frame of the report.
+	 *
+	 * It provides access to each CoreFrameReport via the subscript
+	 * operator [].
+	 *
+	 * The frame data is output when the frame goes out of scope.
+	 */
+	class Frame {
+		private:
+		/**
+		 * The report this frame belongs to.
+		 */
+		Report & report;
+
+		public:
+		/**
+		 * Construct a report frame.
+		 *
+		 * @param report
+		 *	The report this frame belongs to
+		 * @param duration
+		 *	The frame duration
+		 */
+		Frame(Report & report, uint64_t const duration) :
+		    report{report} {
+			report.time += duration;
+		}
+
+		/**
+		 * Subscript operator for per core frame report data.
+		 *
+		 * @param i
+		 *	The core index
+		 * @return
+		 *	A reference to the core frame data
+		 */
+		CoreFrameReport & operator [](coreid_t const i) {
+			assert(i < this->report.ncpu && "out of bounds access");
+			return this->report.cores[i];
+		}
+
+		/**
+		 * Subscript operator for per core frame report data.
+		 *
+		 * @param i
+		 *	The core index
+		 * @return
+		 *	A const reference to the core frame data
+		 */
+		CoreFrameReport const & operator [](coreid_t const i) const {
+			assert(i < this->report.ncpu && "out of bounds access");
+			return this->report.cores[i];
+		}
+
+		/**
+		 * Finalises the frame by outputting it.
+		 *
+		 * The frame is concluded by the energy consumed by all
+		 * cores since the beginning of the report.
+		 */
+		~Frame() {
+			auto & report = this->report;
+			auto & out = report.out;
+			out.reserve(report.lineMax);
+			out.fixed<3>(report.time / 1000.);
+			for (coreid_t i = 0; i < report.ncpu; ++i) {
+				auto const & core = (*this)[i];
+				report.recEnergy += core.rec.energy;
+				report.runEnergy += core.run.energy;
+				cycles_t carry{0};
+				for (auto const state : CP_PRIORITY) {
+					carry += core.carry[state];
+					report.delays[state].add(core.run.freq ?
+					    carry / (core.run.freq * 1000.) : 0.);
+				}
+				out << core;
+			}
+			out << ' ';
+			out.fixed<3>(report.recEnergy / 1000) << ' ';
+			out.fixed<3>(report.runEnergy / 1000);
+			out.endl();
+		}
+	};
+
+	/**
+	 * Constructs a frame for this report.
+	 *
+	 * @tparam ArgTs
+	 *	The constructor argument types
+	 * @param args
+	 *	The constructor arguments
+	 */
+	template <typename ... ArgTs>
+	Frame frame(ArgTs && ... args) {
+		return {*this, std::forward<ArgTs>(args) ...};
+	}
+};
+
+/**
+ * A functor for reading values from a text load recording.
+ *
+ * Provides the same interface as binrec::Reader, so the Emulator
+ * can consume both formats.
+ */
+struct TextReader {
+	/**
+	 * The input data source.
+	 */
+	ifile<io::link> fin;
+
+	/**
+	 * Retrieve the next whitespace separated integral value.
+	 *
+	 * @tparam T
+	 *	The value type to retrieve
+	 * @param dst
+	 *	The lvalue to assign to
+	 * @retval true
+	 *	The value was successfully read
+	 * @retval false
+	 *	The value could not be read
+	 */
+	template <typename T>
+	[[nodiscard]] bool operator ()(T & dst) {
+		uintmax_t value{0};
+		if (1 != this->fin.scanf("%ju", value)) {
+			return false;
+		}
+		dst = static_cast<T>(value);
+		return true;
+	}
+};
+
+/**
+ * Provides access to the remainder of an input file without
+ * copying it.
+ *
+ * Regular files are memory mapped, other inputs (e.g. pipes) are
+ * read into a buffer as a fallback.
+ */
+class InputMap {
+	private:
+	/**
+	 * The memory mapping of the input file.
+	 */
+	void * map{MAP_FAILED};
+
+	/**
+	 * The size of the memory mapping.
+	 */
+	size_t mapsize{0};
+
+	/**
+	 * The fallback buffer for inputs that cannot be mapped.
+	 */
+	std::vector<uint8_t> buf{};
+
+	public:
+	/**
+	 * Unmap the input file.
+	 */
+	~InputMap() {
+		if (this->map != MAP_FAILED) {
+			munmap(this->map, this->mapsize);
+		}
+	}
+
+	/**
+	 * Provide the unread remainder of the given file.
+	 *
+	 * @param fin
+	 *	The file to access, the file position is not updated
+	 *	if the file can be mapped
+	 * @return
+	 *	A binary reader for the remainder of the file
+	 */
+	binrec::Reader open(ifile<io::link> fin) {
+		auto const fd = fileno(fin.get());
+		auto const offset = ftell(fin.get());
+		struct stat sb{};
+		if (offset >= 0 && 0 == fstat(fd, &sb) &&
+		    S_ISREG(sb.st_mode) && sb.st_size > offset) {
+			auto const size = static_cast<size_t>(sb.st_size);
+			auto const map = mmap(nullptr, size, PROT_READ,
+			                      MAP_PRIVATE, fd, 0);
+			if (map != MAP_FAILED) {
+				this->map = map;
+				this->mapsize = size;
+				madvise(map, size, MADV_SEQUENTIAL);
+				auto const begin = static_cast<uint8_t const *>(map);
+				debug("mapped %zu bytes of binary frames\n",
+				      size - offset);
+				return {begin + offset, begin + size};
+			}
+		}
+
+		/* fall back to reading the remaining input */
+		uint8_t chunk[16384];
+		for (size_t count; (count = fin.read(chunk, sizeof(chunk)));) {
+			this->buf.insert(this->buf.end(), chunk, chunk + count);
+		}
+		return {this->buf.data(), this->buf.data() + this->buf.size()};
+	}
+};
+
+/**
+ * Instances of this class represent an emulator session.
+ *
+ * This should be run in its own thread and expects the sysctl table
+ * to be complete.
+ */
+class Emulator {
+	private:
+	/**
+	 * The text input data source.
+	 */
+	ifile<io::link> fin;
+
+	/**
+	 * The binary input data source.
+	 *
+	 * Only used if the BINARY feature flag is set.
+	 */
+	binrec::Reader frames;
+
+	/**
+	 * The output data sink.
+	 */
+	ofile<io::link> fout;
+
+	/**
+	 * A reference to a bool that tells the emulator to die.
+	 */
+	bool const & die;
+
+	/**
+	 * The size of the kern.cp_times buffer.
 	 */
 	size_t const size = sysctls[CP_TIMES].size();
 
@@ -1114,6 +2018,48 @@ class Emulator {
 	 */
 	int const ncpu = this->size / sizeof(cptime_t[CPUSTATES]);
 
+	/**
+	 * A clock frequency level.
+	 */
+	struct Level {
+		/**
+		 * The clock frequency in [MHz].
+		 */
+		mhz_t freq;
+
+		/**
+		 * The power consumption at full load in [mW].
+		 */
+		mw_t power;
+
+		/**
+		 * Returns the clock frequency level closest to the
+		 * given frequency.
+		 *
+		 * @param levels
+		 *	The available clock frequency levels
+		 * @param freq
+		 *	The clock frequency in [MHz]
+		 * @return
+		 *	The closest level, or the given frequency with
+		 *	unknown power if there are no levels
+		 */
+		static Level nearest(std::vector<Level> const & levels,
+		                     mhz_t const freq) {
+			Level result{freq, -1};
+			auto diff = freq + 1000000;
+			for (auto const & lvl : levels) {
+				auto const lvldiff = (lvl.freq > freq ?
+				                      lvl.freq - freq : freq - lvl.freq);
+				if (lvldiff < diff) {
+					diff = lvldiff;
+					result = lvl;
+				}
+			}
+			return result;
+		}
+	};
+
 	/**
 	 * Per core information.
 	 */
@@ -1125,6 +2071,26 @@ class Emulator {
 		 */
 		SysctlValue * freqCtl{nullptr};
 
+		/**
+		 * The available clock frequency levels.
+		 */
+		std::vector<Level> levels{};
+
+		/**
+		 * The energy/performance preference handler of hardware
+		 * P-state drivers.
+		 *
+		 * If set the clock frequency is selected by the emulated
+		 * hardware at the beginning of each frame.
+		 */
+		SysctlValue * eppCtl{nullptr};
+
+		/**
+		 * The highest clock frequency the emulated hardware
+		 * selects.
+		 */
+		mhz_t maxFreq{0};
+
 		/**
 		 * The clock frequency the simulation is running at.
 		 *
@@ -1142,6 +2108,14 @@ class Emulator {
 		 */
 		mhz_t recFreq{0};
 
+		/**
+		 * The recorded ticks for each CPU state.
+		 *
+		 * Updated during the preliminary stage and used at
+		 * the beginning of frame stage.
+		 */
+		cptime_t recTicks[CPUSTATES]{};
+
 		/**
 		 * The load cycles simulated for this frame in [cycles].
 		 *
@@ -1158,6 +2132,40 @@ class Emulator {
 		 * beginning of the next frame.
 		 */
 		cycles_t carryCycles[CPUSTATES]{};
+
+		/**
+		 * The energy consumed by the simulation in this frame
+		 * in [µJ].
+		 *
+		 * This is determined at the beginning of frame and
+		 * reported at the end of frame.
+		 */
+		double runEnergy{0};
+
+		/**
+		 * Estimates the energy consumed by running a number of
+		 * cycles at the given clock frequency.
+		 *
+		 * The power consumption of the clock frequency level
+		 * is assumed for the time spent running the cycles,
+		 * idle time is assumed to consume no energy. Levels
+		 * with unknown power consumption consume no energy.
+		 *
+		 * @param freq
+		 *	The clock frequency in [MHz]
+		 * @param cycles
+		 *	The number of cycles run
+		 * @return
+		 *	The energy in [µJ]
+		 */
+		double energy(mhz_t const freq, cycles_t const cycles) const {
+			auto const power = Level::nearest(this->levels, freq).power;
+			if (power <= 0 || !freq) {
+				return 0;
+			}
+			/* [mW] * [cycles] / [kHz] = [mW] * [ms] = [µJ] */
+			return static_cast<double>(power) * cycles / (freq * 1000);
+		}
 	};
 
 	/**
@@ -1186,14 +2194,16 @@ class Emulator {
 	 *	In case one of the required sysctls is missing
 	 * @param fin,fout
 	 *	The character input and output streams
+	 * @param frames
+	 *	The binary input data source
 	 * @param die
 	 *	If the referenced bool is true, emulation is terminated
 	 *	prematurely
 	 */
-	Emulator(ifile<io::link> fin, ofile<io::link> fout, bool const & die) :
-	    fin{fin}, fout{fout}, die{die} {
+	Emulator(ifile<io::link> fin, binrec::Reader const & frames,
+	         ofile<io::link> fout, bool const & die) :
+	    fin{fin}, frames{frames}, fout{fout}, die{die} {
 		/* get freq and freq_levels sysctls */
-		std::vector<mhz_t> freqLevels{};
 		for (coreid_t i = 0; i < this->ncpu; ++i) {
 			auto & core = this->cores[i];
 
@@ -1210,6 +2220,8 @@ class Emulator {
 				}
 				/* fall back to data from the previous core */
 				core = this->cores[i - 1];
+				/* the hardware is emulated by the owner */
+				core.eppCtl = nullptr;
 				continue;
 			}
 
@@ -1220,37 +2232,61 @@ class Emulator {
 			/* get freq_levels */
 			sprintf_safe(name, FREQ_LEVELS, i);
 			try {
-				auto levels = sysctls[name]
-				              .get<std::string>();
-				levels = std::regex_replace(levels, "/[-+]?[0-9]*"_r, "");
-				auto fetch = FromChars{levels};
-				freqLevels.clear();
+				auto const levels = sysctls[name]
+				                    .get<std::string>();
+				auto it = levels.c_str();
+				auto const end = it + levels.size();
 
+				/* parse "freq/power" pairs */
 				auto msg = debug("emulate core %d clock frequencies:", i);
-				for (unsigned long level{0}; fetch(level);) {
-					freqLevels.push_back(level);
-					msg.printf(" %d", level);
+				for (Level level{0, -1}; it != end;) {
+					auto const [p, ec] = std::from_chars(it, end, level.freq);
+					if (p == it) {
+						break;
+					}
+					it = p;
+					level.power = -1;
+					if (it != end && *it == '/') {
+						auto const [pp, pec] =
+						    std::from_chars(it + 1, end, level.power);
+						it = pp;
+					}
+					core.levels.push_back(level);
+					msg.printf(" %d/%d", level.freq, level.power);
+					for (; it != end && !std::isspace(*it); ++it);
+					for (; it != end && std::isspace(*it); ++it);
 				}
 				msg.putc('\n');
 			} catch (std::out_of_range &) {
 				if (i == 0) {
 					/* warning handled in Main::main() */
+				} else {
+					/* fall back to the previous core */
+					core.levels = this->cores[i - 1].levels;
 				}
 			}
 
-			core.freqCtl->registerOnSet([freqLevels](SysctlValue & ctl) {
-				auto const freq = ctl.get<mhz_t>();
-				auto result = freq;
-				auto diff = freq + 1000000;
-				for (auto lvl : freqLevels) {
-					auto lvldiff = (lvl > freq ? lvl - freq : freq - lvl);
-					if (lvldiff < diff) {
-						diff = lvldiff;
-						result = lvl;
-					}
-				}
-				ctl.set(result);
-			});
+			/* get the energy/performance preference */
+			sprintf_safe(name, FREQ_DRIVER, i);
+			try {
+				auto const driver = sysctls[name].get<std::string>();
+				core.eppCtl = &sysctls[platform::formats::device(
+				    EPP, driver.c_str()).c_str()];
+			} catch (std::out_of_range &) {
+				/* the clock frequency can be set */
+				core.freqCtl->registerOnSet([levels = core.levels](SysctlValue & ctl) {
+					ctl.set(Level::nearest(levels, ctl.get<mhz_t>()).freq);
+				});
+				continue;
+			}
+
+			/* the hardware selects the clock frequency */
+			core.maxFreq = core.runFreq;
+			for (auto const & level : core.levels) {
+				core.maxFreq = std::max(core.maxFreq, level.freq);
+			}
+			debug("emulate core %d energy/performance preference up to %d MHz\n",
+			      i, core.maxFreq);
 		}
 
 		/* initialise kern.cp_times buffer */
@@ -1261,35 +2297,49 @@ class Emulator {
 	/**
 	 * Performs load emulation and prints statistics on io::fout.
 	 *
-	 * Reads fin to pull in load changes and updates the
-	 * kern.cp_times sysctl to represent the current state.
+	 * Pulls in load changes and updates the kern.cp_times sysctl
+	 * to represent the current state.
 	 *
-	 * When it runs out of load changes it terminates emulation
-	 * and sends a SIGINT to the process.
+	 * When it runs out of load changes it terminates emulation.
+	 *
+	 * @tparam FetchT
+	 *	The type of the functor providing recorded values
+	 * @param fetch
+	 *	The functor providing recorded values
 	 */
-	void operator ()() try {
+	template <class FetchT>
+	void play(FetchT fetch) {
 		auto const features = sysctls[LOADREC_FEATURES].get<flag_t>();
 		Report report(this->fout, this->ncpu);
 
 		auto time = std::chrono::steady_clock::now();
-		for (uint64_t duration;
-		     !this->die && (1 == this->fin.scanf("%ju", duration));) {
-			/* setup new output frame */
-			auto frame = report.frame(duration);
-
+		for (uint64_t duration; !this->die && fetch(duration);) {
 			/*
 			 * preliminary
 			 */
 
-			/* get recorded core clocks */
-			for (coreid_t i = 0; i < this->ncpu; ++i) {
+			/* get recorded core clocks and ticks */
+			bool complete{true};
+			for (coreid_t i = 0; complete && i < this->ncpu; ++i) {
 				auto & core = this->cores[i];
 
 				/* update recorded clock frequency */
 				if (features & 1_FREQ_TRACKING) {
-					this->fin.scanf("%u", core.recFreq);
+					complete = fetch(core.recFreq);
+				}
+			}
+			for (coreid_t i = 0; complete && i < this->ncpu; ++i) {
+				for (auto & ticks : this->cores[i].recTicks) {
+					complete = complete && fetch(ticks);
 				}
 			}
+			/* drop truncated frames */
+			if (!complete) {
+				break;
+			}
+
+			/* setup new output frame */
+			auto frame = report.frame(duration);
 
 			/*
 			 * beginning of frame
@@ -1300,75 +2350,64 @@ class Emulator {
 				auto & core = this->cores[i];
 
 				/* get recorded ticks */
-				cptime_t recTicks[CPUSTATES]{};
+				auto const & recTicks = core.recTicks;
 				cptime_t sumRecTicks{0};
-				for (auto & ticks : recTicks) {
-					this->fin.scanf("%lu", ticks);
+				for (auto const ticks : recTicks) {
 					sumRecTicks += ticks;
 				}
 				double const recLoadTicks =
 				    sumRecTicks - recTicks[CP_IDLE];
 				/* must be non-zero */
 				sumRecTicks += !sumRecTicks;
+
 				/* update report with recorded data */
+				cycles_t const recCycles = duration * core.recFreq * 1000;
+				auto const recLoadCycles = static_cast<cycles_t>(
+				    recLoadTicks * recCycles / sumRecTicks);
 				frame[i].rec =
-				    {core.recFreq, recLoadTicks / sumRecTicks};
-
-				/* get recorded cycles in [cycles] */
-				cycles_t cycles[CPUSTATES]{};
-				cycles_t const runCycles = duration * core.recFreq * 1000;
-				for (size_t state = 0; state < CPUSTATES; ++state) {
-					cycles[state] = runCycles * recTicks[state] / sumRecTicks;
-				}
-
-				/* add the carry to the recorded cycles */
-				for (size_t state = 0; state < CPUSTATES; ++state) {
-					cycles[state] += core.carryCycles[state];
-					core.carryCycles[state] = 0;
+				    {core.recFreq, recLoadTicks / sumRecTicks,
+				     core.energy(core.recFreq, recLoadCycles) / 1000};
+
+				/* select the hardware P-state */
+				if (core.eppCtl) {
+					core.runFreq = emulate::select(
+					    core.eppCtl->get<epp_t>(),
+					    core.recFreq, core.maxFreq);
+					core.freqCtl->set(core.runFreq);
 				}
 
 				/* determine simulation cycles at current freq */
-				cycles_t availableCycles = duration * core.runFreq * 1000;
-				core.runLoadCycles = 0;
-				/* assign cycles in order of priority */
-				static_assert(CPUSTATES == 5, "All CPUSTATES must be implemented");
-				for (auto state : {CP_INTR, CP_SYS, CP_USER, CP_NICE}) {
-					if (availableCycles >= cycles[state]) {
-						availableCycles -= cycles[state];
-						core.carryCycles[state] = 0;
-					} else {
-						core.carryCycles[state] =
-						    cycles[state] - availableCycles;
-						cycles[state] = availableCycles;
-						availableCycles = 0;
-					}
-					core.runLoadCycles += cycles[state];
-				}
-				/* assign leftovers to the idle state */
-				cycles[CP_IDLE] = availableCycles;
+				cycles_t cycles[CPUSTATES]{};
+				core.runLoadCycles =
+				    emulate::frame(duration, core.recFreq, recTicks,
+				                   core.runFreq, core.carryCycles,
+				                   cycles);
+
+				/* estimate the energy consumed */
+				core.runEnergy = core.energy(core.runFreq,
+				                             core.runLoadCycles);
 
 				/* set load for this core */
 				for (size_t state = 0; state < CPUSTATES; ++state) {
-					/*
-					 * Use kcycles instead of cycles to
-					 * prevent creating more than one
-					 * wraparound per sample at reasonable
-					 * powerd sample rates.
-					 *
-					 * The formula * for the max powerd
-					 * sampling cycle is:
-					 * `max_cycle = 2^32 / max_clk / 1000`
-					 */
 					this->sum[i * CPUSTATES + state] +=
-					    (cycles[state] + 500) / 1000;
+					    emulate::ticks(cycles[state]);
 				}
 			}
 
+			/* wait for the host process to settle */
+			if (vclock && !vclock.sync()) {
+				break;
+			}
+
 			/* commit changes */
 			cp_times.set(&sum[0], this->size);
 
 			/* sleep */
-			std::this_thread::sleep_until(time += ms{duration});
+			if (!vclock) {
+				std::this_thread::sleep_until(time += ms{duration});
+			} else if (!vclock.advance(ms{duration})) {
+				break;
+			}
 
 			/*
 			 * end of frame
@@ -1385,16 +2424,40 @@ class Emulator {
 				     runCycles
 				     ? static_cast<double>(core.runLoadCycles) /
 				       runCycles
-				     : 0};
+				     : 0,
+				     core.runEnergy / 1000};
+				std::copy(std::begin(core.carryCycles),
+				          std::end(core.carryCycles),
+				          std::begin(frame[i].carry));
 			}
 		}
+	}
+
+	/**
+	 * Performs load emulation and prints statistics on io::fout.
+	 *
+	 * Dispatches to play() with the input reader matching the
+	 * recording format.
+	 *
+	 * When it runs out of load changes it terminates emulation
+	 * and sends a SIGINT to the process.
+	 */
+	void operator ()() try {
+		if (sysctls[LOADREC_FEATURES].get<flag_t>() & 1_BINARY) {
+			this->play(this->frames);
+		} else {
+			this->play(TextReader{this->fin});
+		}
 
 		/* tell process to die */
 		if (!this->die) {
 			raise(SIGINT);
 		}
+		/* interrupt sleeping threads */
+		vclock.stop();
 	} catch (std::out_of_range &) {
 		fail("incomplete emulation setup, please check your load record for complete initialisation\n");
+		vclock.stop();
 	}
 };
 
@@ -1425,6 +2488,11 @@ class Main {
 	 */
 	ofile<io::own> fout;
 
+	/**
+	 * Provides the binary frames of the input.
+	 */
+	InputMap inmap;
+
 	/**
 	 * Used to request premature death from the emulation thread.
 	 */
@@ -1450,18 +2518,19 @@ class Main {
 		}
 
 		char inbuf[16384]{};
-		std::cmatch match;
 
-		/* get static sysctls */
-		auto const expr = "([^=]*)=(.*)\n"_r;
+		/* get static sysctls, i.e. "name=value\n" lines */
 		if (!fin.gets(inbuf)) {
 			fail("cannot read from input\n");
 			return;
 		}
-		while (std::regex_match(inbuf, match, expr)) {
-			sysctls.addValue(match[1].str(), match[2].str());
-			debug("sysctl %s = %s\n",
-			      match[1].str().c_str(), match[2].str().c_str());
+		for (char const * sep{nullptr}, * eol{nullptr};
+		     (sep = std::strchr(inbuf, '=')) &&
+		     (eol = std::strchr(sep, '\n'));) {
+			std::string const name(inbuf, sep - inbuf);
+			std::string const value(sep + 1, eol - sep - 1);
+			sysctls.addValue(name, value);
+			debug("sysctl %s = %s\n", name.c_str(), value.c_str());
 			if (!fin.gets(inbuf)) {
 				fail("unexpected end of input behind: %s", inbuf);
 				return;
@@ -1508,37 +2577,120 @@ class Main {
 			warn("%s is not set, please check your load record", ACLINE);
 		}
 
-		/* skip frame time */
-		auto fetch = FromChars{inbuf};
-		if (uint64_t time{1}; !fetch(time) || time != 0) {
-			fail("first frame time must be 0: %.8s\n", inbuf);
-			return;
+		/* assume an energy/performance preference for EPP_DRIVERS */
+		for (int i = 0; i < sysctls[{CTL_HW, HW_NCPU}].get<int>(); ++i) {
+			sprintf_safe(name, FREQ_DRIVER, i);
+			std::string driver;
+			try {
+				driver = sysctls[name].get<std::string>();
+			} catch (std::out_of_range &) {
+				continue;
+			}
+			auto const epp = platform::formats::device(EPP, driver.c_str());
+			for (auto const prefix : EPP_DRIVERS) {
+				if (epp.empty() || 0 != driver.compare(
+				    0, std::strlen(prefix), prefix)) {
+					continue;
+				}
+				try {
+					sysctls.getMib(epp.c_str());
+				} catch (std::out_of_range &) {
+					sysctls.addValue(epp, std::to_string(EPP_BALANCED));
+				}
+			}
 		}
 
-		/* determine the number of cores */
-		size_t columns = 0;
-		auto seek = fetch;
-		for (cptime_t val{0}; seek(val); ++columns);
-		coreid_t const cores = columns / (CPUSTATES + !!(features & 1_FREQ_TRACKING));
-
-		/* check reference frequencies */
-		for (coreid_t i = 0;
-		     features & 1_FREQ_TRACKING && i < cores; ++i) {
-			mhz_t freq{0};
-			if (!fetch(freq)) {
-				fail("unable to parse core frequency from record at: %.8s ...\n", fetch.it);
+		/* parse the first frame */
+		std::string cp_times{};
+		binrec::Reader frames{nullptr, nullptr};
+		if (features & 1_BINARY) {
+			/* check binary frames introduction */
+			auto const magiclen = std::strlen(binrec::MAGIC);
+			if (0 != std::strncmp(inbuf, binrec::MAGIC, magiclen)) {
+				fail("binary frames introduction expected: %.8s\n", inbuf);
+				return;
+			}
+			auto fetch = FromChars{inbuf + magiclen,
+			                       inbuf + sizeof(inbuf)};
+			if (unsigned int version{0};
+			    !fetch(version) || version != binrec::VERSION) {
+				fail("unsupported binary load record version: %u\n",
+				     version);
+				return;
+			}
+			coreid_t cores{0};
+			if (!fetch(cores) || cores < 1) {
+				fail("binary load record must contain at least one core\n");
+				return;
+			}
+
+			/* skip frame time */
+			frames = this->inmap.open(fin);
+			if (uint64_t time{1}; !frames(time) || time != 0) {
+				fail("first frame time must be 0\n");
 				return;
 			}
-			if (freq <= 0) {
-				fail("recorded clock frequencies must be > 0\n");
+
+			/* check reference frequencies */
+			for (coreid_t i = 0;
+			     features & 1_FREQ_TRACKING && i < cores; ++i) {
+				mhz_t freq{0};
+				if (!frames(freq)) {
+					fail("unable to decode core frequency from record\n");
+					return;
+				}
+				if (freq <= 0) {
+					fail("recorded clock frequencies must be > 0\n");
+					return;
+				}
+			}
+
+			/* collect kern.cp_times */
+			for (coreid_t i = 0; i < cores * CPUSTATES; ++i) {
+				cptime_t ticks{0};
+				if (!frames(ticks)) {
+					fail("unable to decode cp_times from record\n");
+					return;
+				}
+				cp_times += std::to_string(ticks) + ' ';
+			}
+			cp_times.back() = '\n';
+		} else {
+			/* skip frame time */
+			auto fetch = FromChars{inbuf};
+			if (uint64_t time{1}; !fetch(time) || time != 0) {
+				fail("first frame time must be 0: %.8s\n", inbuf);
 				return;
 			}
+
+			/* determine the number of cores */
+			size_t columns = 0;
+			auto seek = fetch;
+			for (cptime_t val{0}; seek(val); ++columns);
+			coreid_t const cores = columns / (CPUSTATES + !!(features & 1_FREQ_TRACKING));
+
+			/* check reference frequencies */
+			for (coreid_t i = 0;
+			     features & 1_FREQ_TRACKING && i < cores; ++i) {
+				mhz_t freq{0};
+				if (!fetch(freq)) {
+					fail("unable to parse core frequency from record at: %.8s ...\n", fetch.it);
+					return;
+				}
+				if (freq <= 0) {
+					fail("recorded clock frequencies must be > 0\n");
+					return;
+				}
+			}
+
+			/* collect kern.cp_times */
+			cp_times = fetch.it;
 		}
 
 		/* initialise kern.cp_times */
 		try {
-			sysctls.addValue(std::string{CP_TIMES}, fetch.it);
-			debug("sysctl %s = %s", CP_TIMES, fetch.it);
+			sysctls.addValue(std::string{CP_TIMES}, cp_times);
+			debug("sysctl %s = %s", CP_TIMES, cp_times.c_str());
 		} catch (std::out_of_range &) {
 			fail("kern.cp_times cannot be set, please check your load record\n");
 			return;
@@ -1553,10 +2705,17 @@ class Main {
 			return;
 		}
 
+		/* check for time warp mode */
+		if (env["LOADPLAY_TIMEWARP"]) {
+			vclock.activate(std::chrono::steady_clock::now()
+			                .time_since_epoch());
+			vclock_participant.enrol();
+		}
+
 		/* start background thread */
 		try {
 			this->bgthread =
-			    std::thread{Emulator{fin, fout, this->die}};
+			    std::thread{Emulator{fin, frames, fout, this->die}};
 			sysctl_startup = false;
 		} catch (std::out_of_range &) {
 			fail("failed to start emulator thread\n");
@@ -1569,6 +2728,7 @@ class Main {
 	 */
 	~Main() {
 		this->die = true;
+		vclock.stop();
 		if (this->bgthread.joinable()) {
 			this->bgthread.join();
 		}
@@ -1791,4 +2951,114 @@ int pidfile_remove(pidfh *) { return sys_results; }
  */
 int pidfile_fileno(pidfh const *) { return sys_results; }
 
+/**
+ * Intercept calls to clock_gettime().
+ *
+ * Provides the \ref anonymous_namespace{libloadplay.cpp}::vclock
+ * time for monotonic clocks in time warp mode.
+ *
+ * @param clock_id,tp
+ *	Please refer to clock_gettime(2)
+ * @retval 0
+ *	The call succeeded
+ * @retval -1
+ *	The call failed
+ */
+int clock_gettime(clockid_t clock_id, struct timespec * tp) {
+	static auto const orig =
+	    (decltype(&clock_gettime))dlfunc(RTLD_NEXT, "clock_gettime");
+
+	switch (clock_id) {
+	case CLOCK_MONOTONIC:
+#ifdef CLOCK_MONOTONIC_PRECISE
+	case CLOCK_MONOTONIC_PRECISE:
+#endif
+#ifdef CLOCK_MONOTONIC_FAST
+	case CLOCK_MONOTONIC_FAST:
+#endif
+#ifdef CLOCK_UPTIME
+	case CLOCK_UPTIME:
+#endif
+#ifdef CLOCK_UPTIME_PRECISE
+	case CLOCK_UPTIME_PRECISE:
+#endif
+#ifdef CLOCK_UPTIME_FAST
+	case CLOCK_UPTIME_FAST:
+#endif
+		if (!sysctl_startup && vclock) {
+			auto const time = vclock.now().count();
+			tp->tv_sec = time / 1000000000;
+			tp->tv_nsec = time % 1000000000;
+			return 0;
+		}
+		break;
+	}
+	return orig(clock_id, tp);
+}
+
+/**
+ * Intercept calls to nanosleep().
+ *
+ * Sleeps on the \ref anonymous_namespace{libloadplay.cpp}::vclock
+ * in time warp mode.
+ *
+ * @param rqtp,rmtp
+ *	Please refer to nanosleep(2)
+ * @retval 0
+ *	The call succeeded
+ * @retval -1
+ *	The call was interrupted (errno == EINTR) or failed
+ */
+int nanosleep(struct timespec const * rqtp, struct timespec * rmtp) {
+	static auto const orig =
+	    (decltype(&nanosleep))dlfunc(RTLD_NEXT, "nanosleep");
+
+	if (sysctl_startup || !vclock) {
+		return orig(rqtp, rmtp);
+	}
+
+	using ns = VirtualClock::ns;
+	auto remaining = ns{0};
+	vclock_participant.enrol();
+	if (vclock.sleep(ns{rqtp->tv_sec * 1000000000LL + rqtp->tv_nsec},
+	                 remaining)) {
+		return 0;
+	}
+	if (rmtp) {
+		rmtp->tv_sec = remaining.count() / 1000000000;
+		rmtp->tv_nsec = remaining.count() % 1000000000;
+	}
+	return errno = EINTR, -1;
+}
+
+/**
+ * Intercept calls to usleep().
+ *
+ * Sleeps on the \ref anonymous_namespace{libloadplay.cpp}::vclock
+ * in time warp mode.
+ *
+ * @param microseconds
+ *	Please refer to usleep(3)
+ * @retval 0
+ *	The call succeeded
+ * @retval -1
+ *	The call was interrupted (errno == EINTR)
+ */
+int usleep(useconds_t microseconds) {
+	static auto const orig =
+	    (decltype(&usleep))dlfunc(RTLD_NEXT, "usleep");
+
+	if (sysctl_startup || !vclock) {
+		return orig(microseconds);
+	}
+
+	auto remaining = VirtualClock::ns{0};
+	vclock_participant.enrol();
+	if (vclock.sleep(std::chrono::microseconds{microseconds},
+	                 remaining)) {
+		return 0;
+	}
+	return errno = EINTR, -1;
+}
+
 } /* extern "C" */
@@ -0,0 +1,413 @@
+/**
+ * Implements a converter between the text and binary load recording
+ * formats.
+ *
+ * @file
+ */
+
+#include "Options.hpp"
+
+#include "types.hpp"
+#include "errors.hpp"
+#include "utility.hpp"
+#include "version.hpp"
+#include "binrec.hpp"
+
+#include "sys/io.hpp"
+
+#include <vector>
+
+#include <cstring>   /* strlen(), strncmp() */
+
+#include <sys/resource.h>  /* CPUSTATES */
+
+/**
+ * File local scope.
+ */
+namespace {
+
+using nih::Parameter;
+using nih::Options;
+
+using types::coreid_t;
+
+using errors::Exit;
+using errors::Exception;
+using errors::fail;
+
+using utility::to_value;
+using utility::FromChars;
+using namespace utility::literals;
+using namespace std::literals::string_literals;
+
+namespace io = sys::io;
+
+/**
+ * Output file type alias.
+ *
+ * @tparam Ownership
+ *	The io::ownership type of the file
+ */
+template <auto Ownership> using ofile = io::file<Ownership, io::write>;
+
+/**
+ * Input file type alias.
+ *
+ * @tparam Ownership
+ *	The io::ownership type of the file
+ */
+template <auto Ownership> using ifile = io::file<Ownership, io::read>;
+
+using version::LOADREC_FEATURES;
+using version::flag_t;
+using namespace version::literals;
+
+/**
+ * The global state.
+ */
+struct {
+	bool binary{false};   /**< Binary output flag. */
+
+	/**
+	 * The input stream either io::fin (stdin) or a file.
+	 */
+	ifile<io::link> fin = io::fin;
+
+	/**
+	 * The output stream either io::fout (stdout) or a file.
+	 */
+	ofile<io::link> fout = io::fout;
+
+	/**
+	 * The user provided input file name.
+	 */
+	char const * infilename{nullptr};
+
+	/**
+	 * The user provided output file name.
+	 */
+	char const * outfilename{nullptr};
+} g;
+
+/**
+ * An enum for command line parsing.
+ */
+enum class OE {
+	USAGE,           /**< Print help */
+	FLAG_BINARY,     /**< Binary frame output */
+	FILE_INPUT,      /**< Set input file */
+	FILE_OUTPUT,     /**< Set output file */
+	OPT_UNKNOWN,     /**< Obligatory */
+	OPT_NOOPT,       /**< Obligatory */
+	OPT_DASH,        /**< Obligatory */
+	OPT_LDASH,       /**< Obligatory */
+	OPT_DONE         /**< Obligatory */
+};
+
+/**
+ * The short usage string.
+ */
+char const * const USAGE = "[-hb] [-i file] [-o file]";
+
+/**
+ * Definitions of command line parameters.
+ */
+Parameter<OE> const PARAMETERS[]{
+	{OE::USAGE,       'h', "help",   "",     "Show usage and exit"},
+	{OE::FLAG_BINARY, 'b', "binary", "",     "Output the binary format"},
+	{OE::FILE_INPUT,  'i', "input",  "file", "Input file (load recording)"},
+	{OE::FILE_OUTPUT, 'o', "output", "file", "Output file (load recording)"},
+};
+
+/**
+ * Set up input and output to the given files.
+ */
+void init() {
+	if (g.infilename) {
+		static ifile<io::own> infile{g.infilename, "rb"};
+		if (!infile) {
+			fail(Exit::EROPEN, errno,
+			     "could not open file for reading: "s + g.infilename);
+		}
+		g.fin = infile;
+	}
+	if (g.outfilename) {
+		static ofile<io::own> outfile{g.outfilename, "wb"};
+		if (!outfile) {
+			fail(Exit::EWOPEN, errno,
+			     "could not open file for writing: "s + g.outfilename);
+		}
+		g.fout = outfile;
+	}
+}
+
+/**
+ * Parse command line arguments.
+ *
+ * @param argc,argv
+ *	The command line arguments
+ */
+void read_args(int const argc, char const * const argv[]) {
+	auto getopt = Options{argc, argv, USAGE, PARAMETERS};
+
+	try {
+		while (true) switch (getopt()) {
+		case OE::USAGE:
+			io::ferr.printf("%s", getopt.usage().c_str());
+			throw Exception{Exit::OK, 0, ""};
+		case OE::FLAG_BINARY:
+			g.binary = true;
+			break;
+		case OE::FILE_INPUT:
+			g.infilename = getopt[1];
+			break;
+		case OE::FILE_OUTPUT:
+			g.outfilename = getopt[1];
+			break;
+		case OE::OPT_UNKNOWN:
+		case OE::OPT_NOOPT:
+		case OE::OPT_DASH:
+		case OE::OPT_LDASH:
+			fail(Exit::ECLARG, 0,
+			     "unexpected command line argument: "s + getopt[0]);
+		case OE::OPT_DONE:
+			return;
+		}
+	} catch (Exception & e) {
+		switch (getopt) {
+		case OE::USAGE:
+			break;
+		case OE::FLAG_BINARY:
+			e.msg += "\n\n";
+			e.msg += getopt.show(0);
+			break;
+		case OE::FILE_INPUT:
+		case OE::FILE_OUTPUT:
+			e.msg += "\n\n";
+			e.msg += getopt.show(1);
+			break;
+		case OE::OPT_UNKNOWN:
+		case OE::OPT_NOOPT:
+		case OE::OPT_DASH:
+		case OE::OPT_LDASH:
+			e.msg += "\n\n";
+			e.msg += getopt.show(0);
+			break;
+		case OE::OPT_DONE:
+			return;
+		}
+		throw;
+	}
+}
+
+/**
+ * A functor for reading values from a text load recording.
+ *
+ * Provides the same interface as binrec::Reader.
+ */
+struct TextReader {
+	/**
+	 * The input data source.
+	 */
+	ifile<io::link> fin;
+
+	/**
+	 * Retrieve the next whitespace separated integral value.
+	 *
+	 * @tparam T
+	 *	The value type to retrieve
+	 * @param dst
+	 *	The lvalue to assign to
+	 * @retval true
+	 *	The value was successfully read
+	 * @retval false
+	 *	The value could not be read
+	 */
+	template <typename T>
+	[[nodiscard]] bool operator ()(T & dst) {
+		uintmax_t value{0};
+		if (1 != this->fin.scanf("%ju", value)) {
+			return false;
+		}
+		dst = static_cast<T>(value);
+		return true;
+	}
+};
+
+/**
+ * Output a single frame value.
+ *
+ * @param value
+ *	The value to output
+ * @param column
+ *	The column of the value within the frame
+ */
+void put(uint64_t const value, size_t const column) {
+	if (g.binary) {
+		uint8_t buf[binrec::VARINT_MAX];
+		g.fout.write(buf, binrec::encode(buf, value));
+		return;
+	}
+	if (column) {
+		g.fout.putc(' ');
+	}
+	g.fout.printf("%ju", uintmax_t{value});
+}
+
+/**
+ * Copy frames from the input to the output.
+ *
+ * @tparam FetchT
+ *	The type of the functor providing recorded values
+ * @param fetch
+ *	The functor providing recorded values
+ * @param columns
+ *	The number of values per frame
+ * @param frames
+ *	The maximum number of frames to copy
+ */
+template <class FetchT>
+void convert(FetchT && fetch, size_t const columns,
+             size_t frames = static_cast<size_t>(-1)) {
+	for (uint64_t value{0}; frames && fetch(value); --frames) {
+		put(value, 0);
+		for (size_t column = 1; column < columns; ++column) {
+			if (!fetch(value)) {
+				fail(Exit::ERECORD, 0, "truncated frame in load recording");
+			}
+			put(value, column);
+		}
+		if (!g.binary) {
+			g.fout.putc('\n');
+		}
+	}
+}
+
+/**
+ * Convert the load recording.
+ *
+ * The header is copied, except for the feature flags, which are
+ * updated to reflect the output format.
+ */
+void run() {
+	char inbuf[16384]{};
+
+	/* copy the header */
+	flag_t features{0};
+	bool hasFeatures{false};
+	while (g.fin.gets(inbuf)) {
+		auto const sep = std::strchr(inbuf, '=');
+		if (!sep) {
+			break;
+		}
+		auto const namelen = static_cast<size_t>(sep - inbuf);
+		if (namelen != std::strlen(LOADREC_FEATURES) ||
+		    0 != std::strncmp(inbuf, LOADREC_FEATURES, namelen)) {
+			g.fout.printf("%s", inbuf);
+			continue;
+		}
+		hasFeatures = true;
+		if (!FromChars{sep + 1, sep + std::strlen(sep)}(features)) {
+			fail(Exit::ERECORD, 0,
+			     "invalid feature flags: "s + inbuf);
+		}
+		auto const outfeatures = g.binary ?
+		                         features | 1_BINARY :
+		                         features & ~1_BINARY;
+		g.fout.printf("%s=%ju\n", LOADREC_FEATURES, uintmax_t{outfeatures});
+	}
+	if (g.fin.error()) {
+		fail(Exit::ERECORD, errno, "failed to read load recording");
+	}
+	auto const unknown = features & ~(1_FREQ_TRACKING | 1_BINARY);
+	if (unknown) {
+		fail(Exit::ERECORD, 0,
+		     "%s contains unsupported feature flags: %#jx"_fmt(
+		         LOADREC_FEATURES, uintmax_t{unknown}));
+	}
+	auto const freqs = !!(features & 1_FREQ_TRACKING);
+
+	/* get the number of cores */
+	coreid_t cores{0};
+	if (features & 1_BINARY) {
+		auto const magiclen = std::strlen(binrec::MAGIC);
+		auto fetch = FromChars{inbuf + magiclen, inbuf + sizeof(inbuf)};
+		unsigned int version{0};
+		if (0 != std::strncmp(inbuf, binrec::MAGIC, magiclen) ||
+		    !fetch(version) || !fetch(cores)) {
+			fail(Exit::ERECORD, 0,
+			     "binary frames introduction expected: "s + inbuf);
+		}
+		if (version != binrec::VERSION) {
+			fail(Exit::ERECORD, 0,
+			     "unsupported binary load record version: %u"_fmt(version));
+		}
+	} else {
+		size_t columns = 0;
+		auto fetch = FromChars{inbuf};
+		for (uint64_t val{0}; fetch(val); ++columns);
+		cores = columns ? (columns - 1) / (CPUSTATES + freqs) : 0;
+		if (columns != 1 + static_cast<size_t>(cores) * (CPUSTATES + freqs)) {
+			fail(Exit::ERECORD, 0,
+			     "unexpected number of columns in first frame: "s + inbuf);
+		}
+	}
+	if (cores < 1) {
+		fail(Exit::ERECORD, 0,
+		     "load recording must contain at least one core");
+	}
+	size_t const columns = 1 + static_cast<size_t>(cores) * (CPUSTATES + freqs);
+
+	/* recordings without feature flags predate the binary format */
+	if (g.binary && !hasFeatures) {
+		g.fout.printf("%s=%ju\n", LOADREC_FEATURES,
+		              uintmax_t{1_BINARY});
+	}
+
+	/* introduce binary frames */
+	if (g.binary) {
+		g.fout.printf("%s %u %d\n",
+		              binrec::MAGIC, binrec::VERSION, cores);
+	}
+
+	/* copy frames */
+	if (features & 1_BINARY) {
+		std::vector<uint8_t> buf{};
+		uint8_t chunk[16384];
+		for (size_t count; (count = g.fin.read(chunk, sizeof(chunk)));) {
+			buf.insert(buf.end(), chunk, chunk + count);
+		}
+		convert(binrec::Reader{buf.data(), buf.data() + buf.size()},
+		        columns);
+	} else {
+		convert(FromChars{inbuf}, columns, 1);
+		convert(TextReader{g.fin}, columns);
+	}
+	g.fout.flush();
+}
+
+} /* namespace */
+
+/**
+ * Main routine, convert the load recording, print errors.
+ *
+ * @param argc,argv
+ *	The command line arguments
+ * @return
+ *	An exit code
+ * @see Exit
+ */
+int main(int argc, char * argv[]) try {
+	read_args(argc, argv);
+	init();
+	run();
+	return to_value(Exit::OK);
+} catch (Exception & e) {
+	if (e.msg != "") {
+		io::ferr.printf("loadconv: %s\n", e.msg.c_str());
+	}
+	return to_value(e.exitcode);
+} catch (...) {
+	io::ferr.print("loadconv: untreated failure\n");
+	return to_value(Exit::EEXCEPT);
+}
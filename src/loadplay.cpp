@@ -12,7 +12,16 @@
 #include "sys/env.hpp"
 #include "sys/io.hpp"
 
-#include <unistd.h>  /* execvp() */
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <thread>      /* std::thread::hardware_concurrency() */
+
+#include <cstdlib>     /* strtod() */
+#include <cstring>     /* strcmp() */
+
+#include <unistd.h>    /* execvp(), fork(), _exit() */
+#include <sys/wait.h>  /* waitpid() */
 
 /**
  * File local scope.
@@ -40,6 +49,8 @@ enum class OE {
 	USAGE,            /**< Print help */
 	FILE_IN,          /**< Set input file instead of stdin */
 	FILE_OUT,         /**< Set output file instead of stdout */
+	FLAG_TIMEWARP,    /**< Replay on a virtual clock */
+	CNT_JOBS,         /**< Set number of concurrent replays */
 	CMD,              /**< The command to execute */
 	OPT_NOOPT = CMD,  /**< Obligatory */
 	OPT_UNKNOWN,      /**< Obligatory */
@@ -51,16 +62,18 @@ enum class OE {
 /**
  * The short usage string.
  */
-char const * const USAGE = "[-h] [-i file] [-o file] command [...]";
+char const * const USAGE = "[-ht] [-j cnt] [-i file] [-o file] command [...] [\\; command [...]] ...";
 
 /**
  * Definitions of command line parameters.
  */
 Parameter<OE> const PARAMETERS[]{
-	{OE::USAGE,    'h', "help",   "",              "Show usage and exit"},
-	{OE::FILE_IN,  'i', "input",  "file",          "Input file (load recording)"},
-	{OE::FILE_OUT, 'o', "output", "file",          "Output file (replay stats)"},
-	{OE::CMD,       0 , "",       "command,[...]", "The command to execute"},
+	{OE::USAGE,         'h', "help",     "",              "Show usage and exit"},
+	{OE::FLAG_TIMEWARP, 't', "timewarp", "",              "Replay on a virtual clock"},
+	{OE::CNT_JOBS,      'j', "jobs",     "cnt",           "Replay up to cnt commands concurrently"},
+	{OE::FILE_IN,       'i', "input",    "file",          "Input file (load recording)"},
+	{OE::FILE_OUT,      'o', "output",   "file",          "Output file (replay stats)"},
+	{OE::CMD,            0 , "",         "command,[...]", "The command to execute"},
 };
 
 /**
@@ -84,6 +97,24 @@ char const * filename(char const * const path) {
 	return path;
 }
 
+/**
+ * Performs very rudimentary job count argument checks.
+ *
+ * @param str
+ *	The job count argument
+ * @return
+ *	The number of concurrent jobs
+ */
+size_t jobs(char const * const str) {
+	size_t value{0};
+	if (!str || !utility::FromChars{str, str + strlen(str)}(value) ||
+	    value < 1 || value > 1024) {
+		fail(Exit::EOUTOFRANGE, 0,
+		     "job count must be an integer in the range [1, 1024]");
+	}
+	return value;
+}
+
 /**
  * Executes the given command, substituting this process.
  *
@@ -133,6 +164,266 @@ void set_library_path(int const argc, char * const argv[]) {
 	}
 }
 
+/**
+ * A single replay of a parameter sweep.
+ */
+struct Job {
+	/**
+	 * The command line, terminated by a nullptr.
+	 */
+	char * const * argv;
+
+	/**
+	 * The output file name.
+	 */
+	std::string outfile;
+
+	/**
+	 * The process ID of the replay.
+	 */
+	pid_t pid{0};
+
+	/**
+	 * Set if the replay did not exit successfully.
+	 */
+	bool failed{false};
+};
+
+/**
+ * The statistics output of a replay.
+ */
+struct Play {
+	/**
+	 * The column headings.
+	 */
+	std::vector<std::string> columns;
+
+	/**
+	 * The frames.
+	 */
+	std::vector<std::vector<double>> rows;
+};
+
+/**
+ * Read the statistics output of a replay.
+ *
+ * @param filename
+ *	The file to read
+ * @return
+ *	The column headings and frames
+ */
+Play read_play(char const * const filename) {
+	io::file<io::own, io::read> fin{filename, "rb"};
+	if (!fin) {
+		fail(Exit::EROPEN, errno,
+		     "could not open file for reading: "s + filename);
+	}
+	std::string text;
+	char chunk[16384];
+	for (size_t count; (count = fin.read(chunk, sizeof(chunk)));) {
+		text.append(chunk, count);
+	}
+
+	Play play;
+	size_t pos = 0;
+	for (size_t eol; (eol = text.find('\n', pos)) != std::string::npos;
+	     pos = eol + 1) {
+		auto const line = text.c_str() + pos;
+		auto const end = text.c_str() + eol;
+		if (play.columns.empty()) {
+			/* column headings */
+			for (auto it = line; it < end;) {
+				auto sep = it;
+				for (; sep != end && *sep != ' '; ++sep);
+				play.columns.emplace_back(it, sep);
+				it = sep + 1;
+			}
+			continue;
+		}
+		/* frame */
+		std::vector<double> row;
+		for (char * it = const_cast<char *>(line); it < end;) {
+			char * next{nullptr};
+			auto const value = strtod(it, &next);
+			if (next == it || next > end) {
+				break;
+			}
+			row.push_back(value);
+			it = next;
+		}
+		play.rows.push_back(std::move(row));
+	}
+	return play;
+}
+
+/**
+ * Print the deviations of a replay from a reference replay.
+ *
+ * The output matches the metrics of the tools/playdiff script:
+ *
+ * | Metric | Description                            |
+ * |--------|----------------------------------------|
+ * | ID     | Integral over Deviations               |
+ * | MD     | Mean Deviation                         |
+ * | IAD    | Integral over Absolute Deviations      |
+ * | MAD    | Mean Absolute Deviation                |
+ *
+ * @param ref,orig
+ *	The reference job and its output
+ * @param job,play
+ *	The job to compare and its output
+ */
+void print_diff(Job const & ref, Play const & orig,
+                Job const & job, Play const & play) {
+	io::fout.printf("--- %s\n+++ %s\n",
+	                ref.outfile.c_str(), job.outfile.c_str());
+	if (orig.rows.empty() || orig.rows.size() != play.rows.size()) {
+		io::fout.print("frame count mismatch, skip to next file\n");
+		return;
+	}
+
+	auto const columns = orig.columns.size();
+	std::vector<double> sumdev(columns), sumabsdev(columns);
+	double last{0};
+	for (size_t row = 0; row < orig.rows.size(); ++row) {
+		auto const & origRow = orig.rows[row];
+		auto const & playRow = play.rows[row];
+		if (origRow.size() != columns || playRow.size() != columns ||
+		    origRow[0] != playRow[0]) {
+			io::fout.print("time reference mismatch, skip to next file\n");
+			return;
+		}
+		auto const dt = origRow[0] - last;
+		last = origRow[0];
+		for (size_t i = 1; i < columns; ++i) {
+			auto const dev = dt * (playRow[i] - origRow[i]);
+			sumdev[i] += dev;
+			sumabsdev[i] += dev < 0 ? -dev : dev;
+		}
+	}
+
+	io::fout.printf("%-20.20s  %12.12s  %12.12s  %12.12s  %12.12s\n",
+	                "", "ID", "MD", "IAD", "MAD");
+	for (size_t i = 0; i < columns; ++i) {
+		io::fout.printf("%-20.20s  %12.1f  %12.1f  %12.1f  %12.1f\n",
+		                orig.columns[i].c_str(),
+		                sumdev[i], sumdev[i] / last,
+		                sumabsdev[i], sumabsdev[i] / last);
+	}
+}
+
+/**
+ * Replay the recording with each command concurrently.
+ *
+ * Each replay runs in its own process, and thus with its own
+ * emulated sysctl table. After all replays completed, a summary
+ * of the deviations of each replay from the first one is printed.
+ * Failed replays are left out of the summary.
+ *
+ * @param argv
+ *	The command lines, separated by ";" arguments
+ * @param workers
+ *	The maximum number of concurrent replays
+ * @return
+ *	Exit::EEXEC if a replay failed, Exit::OK otherwise
+ */
+Exit sweep(char * argv[], size_t const workers) {
+	auto & env = sys::env::vars;
+	if (!env["LOADPLAY_IN"]) {
+		fail(Exit::ECLARG, 0,
+		     "concurrent replays require an input file");
+	}
+	if (!env["LOADPLAY_OUT"]) {
+		fail(Exit::ECLARG, 0,
+		     "concurrent replays require an output file");
+	}
+	std::string const outprefix = env["LOADPLAY_OUT"].c_str();
+
+	/* split command lines */
+	std::vector<Job> jobs;
+	for (auto it = argv; *it;) {
+		if (!strcmp(*it, ";")) {
+			fail(Exit::ECLARG, 0, "empty command in command matrix");
+		}
+		jobs.push_back({it, outprefix + "." +
+		                    std::to_string(jobs.size())});
+		for (; *it && strcmp(*it, ";"); ++it);
+		if (*it) {
+			*it++ = nullptr;
+		}
+	}
+
+	/* run replays */
+	size_t running = 0;
+	auto const wait = [&jobs, &running]() {
+		int status{0};
+		auto const pid = waitpid(-1, &status, 0);
+		if (pid == -1) {
+			fail(Exit::EEXEC, errno,
+			     "failed to wait for replay: "s + strerror(errno));
+		}
+		--running;
+		for (auto & job : jobs) {
+			if (job.pid == pid &&
+			    (!WIFEXITED(status) || WEXITSTATUS(status))) {
+				job.failed = true;
+				io::ferr.printf("loadplay: replay %s failed: %s\n",
+				                job.outfile.c_str(), job.argv[0]);
+			}
+		}
+	};
+	for (auto & job : jobs) {
+		while (running >= workers) {
+			wait();
+		}
+		io::fout.flush();
+		io::ferr.flush();
+		job.pid = fork();
+		if (job.pid == -1) {
+			fail(Exit::EEXEC, errno,
+			     "failed to fork: "s + strerror(errno));
+		}
+		if (!job.pid) try {
+			env["LOADPLAY_OUT"] = job.outfile.c_str();
+			execute(job.argv[0], job.argv);
+		} catch (Exception & e) {
+			io::ferr.printf("loadplay: %s\n", e.msg.c_str());
+			_exit(to_value(e.exitcode));
+		}
+		++running;
+	}
+	while (running) {
+		wait();
+	}
+
+	/* print summary */
+	bool failed{false};
+	for (auto const & job : jobs) {
+		io::fout.printf("%s:", job.outfile.c_str());
+		for (auto it = job.argv; *it; ++it) {
+			io::fout.printf(" %s", *it);
+		}
+		if (job.failed) {
+			io::fout.print(" (failed)");
+		}
+		io::fout.putc('\n');
+		failed |= job.failed;
+	}
+	if (jobs[0].failed) {
+		io::fout.print("reference replay failed, no deviations\n");
+		return Exit::EEXEC;
+	}
+	auto const orig = read_play(jobs[0].outfile.c_str());
+	for (size_t i = 1; i < jobs.size(); ++i) {
+		if (jobs[i].failed) {
+			continue;
+		}
+		print_diff(jobs[0], orig,
+		           jobs[i], read_play(jobs[i].outfile.c_str()));
+	}
+	return failed ? Exit::EEXEC : Exit::OK;
+}
+
 } /* namespace */
 
 /**
@@ -146,6 +437,7 @@ void set_library_path(int const argc, char * const argv[]) {
  */
 int main(int argc, char * argv[]) try {
 	auto & env = sys::env::vars;
+	size_t workers{0};
 
 	auto getopt = Options{argc, argv, USAGE, PARAMETERS};
 
@@ -160,11 +452,30 @@ int main(int argc, char * argv[]) try {
 		case OE::FILE_OUT:
 			env["LOADPLAY_OUT"] = filename(getopt[1]);
 			break;
+		case OE::FLAG_TIMEWARP:
+			env["LOADPLAY_TIMEWARP"] = "1";
+			break;
+		case OE::CNT_JOBS:
+			workers = jobs(getopt[1]);
+			break;
 		case OE::CMD:
 			env["LD_PRELOAD"] = "libloadplay.so";
 			assert(getopt.offset() < argc &&
 			       "only OPT_DONE may violate this constraint");
 			set_library_path(argc, argv);
+			/* run a parameter sweep */
+			if (workers || std::find_if(argv + getopt.offset(),
+			                            argv + argc,
+			                            [](char const * const arg) {
+				return !strcmp(arg, ";");
+			    }) != argv + argc) {
+				if (!workers) {
+					workers = std::max(
+					    std::thread::hardware_concurrency(), 1u);
+				}
+				return to_value(sweep(argv + getopt.offset(),
+				                      workers));
+			}
 			/* forward the remainder of the arguments */
 			execute(getopt[0], argv + getopt.offset());
 			break;
@@ -181,9 +492,11 @@ int main(int argc, char * argv[]) try {
 	} catch (Exception & e) {
 		switch (getopt) {
 		case OE::USAGE:
+		case OE::FLAG_TIMEWARP:
 			break;
 		case OE::FILE_IN:
 		case OE::FILE_OUT:
+		case OE::CNT_JOBS:
 			e.msg += "\n\n"s += getopt.show(1);
 			break;
 		case OE::CMD:
@@ -13,6 +13,8 @@
 #include "utility.hpp"
 #include "clas.hpp"
 #include "version.hpp"
+#include "binrec.hpp"
+#include "platform/formats.hpp"
 
 #include "sys/io.hpp"
 #include "sys/sysctl.hpp"
@@ -20,6 +22,7 @@
 #include <chrono>    /* std::chrono::steady_clock::now() */
 #include <thread>    /* std::this_thread::sleep_until() */
 #include <memory>    /* std::unique_ptr */
+#include <string>    /* std::string */
 
 #include <sys/resource.h>  /* CPUSTATES */
 
@@ -36,11 +39,14 @@ using constants::FREQ;
 using constants::FREQ_LEVELS;
 using constants::FREQ_DRIVER;
 using constants::CP_TIMES;
+using constants::TOPOLOGY;
+using constants::EPP;
 
 using types::ms;
 using types::coreid_t;
 using types::cptime_t;
 using types::mhz_t;
+using types::epp_t;
 
 using errors::Exit;
 using errors::Exception;
@@ -86,6 +92,7 @@ constexpr flag_t const FEATURES{
  */
 struct {
 	bool verbose{false};  /**< Verbosity flag. */
+	bool binary{false};   /**< Binary output flag. */
 	ms duration{30000};   /**< Recording duration in ms. */
 	ms interval{25};      /**< Recording sample interval in ms. */
 
@@ -115,6 +122,7 @@ enum class OE {
 	FILE_OUTPUT,     /**< Set output file */
 	FILE_PID,        /**< Set PID file */
 	FLAG_VERBOSE,    /**< Verbose output on stderr */
+	FLAG_BINARY,     /**< Binary frame output */
 	OPT_UNKNOWN,     /**< Obligatory */
 	OPT_NOOPT,       /**< Obligatory */
 	OPT_DASH,        /**< Obligatory */
@@ -125,7 +133,7 @@ enum class OE {
 /**
  * The short usage string.
  */
-char const * const USAGE = "[-hv] [-d ival] [-p ival] [-o file]";
+char const * const USAGE = "[-hvb] [-d ival] [-p ival] [-o file]";
 
 /**
  * Definitions of command line parameters.
@@ -133,6 +141,7 @@ char const * const USAGE = "[-hv] [-d ival] [-p ival] [-o file]";
 Parameter<OE> const PARAMETERS[]{
 	{OE::USAGE,         'h', "help",     "",     "Show usage and exit"},
 	{OE::FLAG_VERBOSE,  'v', "verbose",  "",     "Be verbose"},
+	{OE::FLAG_BINARY,   'b', "binary",   "",     "Use the binary format"},
 	{OE::IVAL_DURATION, 'd', "duration", "ival", "The duration of the recording"},
 	{OE::IVAL_POLL,     'p', "poll",     "ival", "The polling interval"},
 	{OE::FILE_OUTPUT,   'o', "output",   "file", "Output to file"},
@@ -186,6 +195,9 @@ void read_args(int const argc, char const * const argv[]) {
 		case OE::FLAG_VERBOSE:
 			g.verbose = true;
 			break;
+		case OE::FLAG_BINARY:
+			g.binary = true;
+			break;
 		case OE::IVAL_DURATION:
 			g.duration = ival(getopt[1]);
 			break;
@@ -211,6 +223,7 @@ void read_args(int const argc, char const * const argv[]) {
 		case OE::USAGE:
 			break;
 		case OE::FLAG_VERBOSE:
+		case OE::FLAG_BINARY:
 			e.msg += "\n\n";
 			e.msg += getopt.show(0);
 			break;
@@ -250,12 +263,30 @@ void print_sysctls() {
 	              "hw.model=%s\n"
 	              "hw.ncpu=%d\n"
 	              "%s=%d\n",
-	              LOADREC_FEATURES, FEATURES,
+	              LOADREC_FEATURES,
+	              FEATURES | (g.binary ? 1_BINARY : 0),
 	              Sysctl{CTL_HW, HW_MACHINE}.get<char>().get(),
 	              Sysctl{CTL_HW, HW_MODEL}.get<char>().get(),
 	              g.ncpu,
 	              ACLINE, Once{1U, hw_acpi_acline});
 
+	try {
+		auto spec = Sysctl{TOPOLOGY}.get<char>();
+		/* strip line breaks and indention to fit a single line */
+		auto out = spec.get();
+		for (auto in = spec.get(); *in; ++in) {
+			if (*in == '\n') {
+				for (; in[1] == ' ' || in[1] == '\t'; ++in);
+				continue;
+			}
+			*out++ = *in;
+		}
+		*out = 0;
+		g.fout.printf("%s=%s\n", TOPOLOGY, spec.get());
+	} catch (sys::sc_error<sys::ctl::error>) {
+		verbose("cannot access sysctl: %s\n", TOPOLOGY);
+	}
+
 	for (coreid_t i = 0; i < g.ncpu; ++i) {
 		char mibname[40];
 		sprintf_safe(mibname, FREQ, i);
@@ -279,14 +310,44 @@ void print_sysctls() {
 				verbose("cannot access sysctl: %s\n", mibname);
 			}
 		}
+		/* energy/performance preference of hardware P-states */
+		sprintf_safe(mibname, FREQ_DRIVER, i);
+		std::string epp;
+		try {
+			epp = platform::formats::device(
+			    EPP, Sysctl{mibname}.get<char>().get());
+			if (!epp.empty()) {
+				epp_t value{0};
+				Sysctl{epp.c_str()}.get(value);
+				g.fout.printf("%s=%u\n", epp.c_str(), value);
+			}
+		} catch (sys::sc_error<sys::ctl::error>) {
+			if (!epp.empty()) {
+				verbose("cannot access sysctl: %s\n", epp.c_str());
+			}
+		}
 	}
 }
 
+/**
+ * Output a value using the binary frame encoding.
+ *
+ * @param value
+ *	The value to output
+ */
+void put(uint64_t const value) {
+	uint8_t buf[binrec::VARINT_MAX];
+	g.fout.write(buf, binrec::encode(buf, value));
+}
+
 /**
  * Report the load frames.
  *
  * This prints the time in ms since the last frame and the cp_times
  * growth as a space separated list.
+ *
+ * If g.binary is set the same values are output in the binary
+ * frame encoding.
  */
 void run() try {
 	/*
@@ -320,6 +381,14 @@ void run() try {
 		}
 	}
 
+	/*
+	 * Introduce binary frames.
+	 */
+	if (g.binary) {
+		g.fout.printf("%s %u %d\n",
+		              binrec::MAGIC, binrec::VERSION, cores);
+	}
+
 	/*
 	 * Record freq and cptimes.
 	 */
@@ -332,6 +401,17 @@ void run() try {
 	auto const takeAndPrintSample = [&]() {
 		cp_times_ctl.get(&cp_times[sample * columns],
 		                 sizeof(cptime_t) * columns);
+		if (g.binary) {
+			put(std::chrono::duration_cast<ms>(time - last).count());
+			for (coreid_t i = 0; i < cores; ++i) {
+				put(static_cast<mhz_t>(corefreqs[i]));
+			}
+			for (size_t i = 0; i < columns; ++i) {
+				put(cp_times[sample * columns + i] -
+				    cp_times[((sample + 1) % 2) * columns + i]);
+			}
+			return;
+		}
 		g.fout.printf("%lld", std::chrono::duration_cast<ms>(time - last).count());
 		for (coreid_t i = 0; i < cores; ++i) {
 			g.fout.printf(" %u", static_cast<mhz_t>(corefreqs[i]));
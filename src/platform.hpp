@@ -0,0 +1,18 @@
+/**
+ * Selects the platform of powerd++ at compile time.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_PLATFORM_HPP_
+#define _POWERDXX_PLATFORM_HPP_
+
+#if defined(PLATFORM_MOCK)
+#include "platform/mock.hpp"
+#elif defined(__linux__)
+#include "platform/linux.hpp"
+#else
+#include "platform/freebsd.hpp"
+#endif
+
+#endif /* _POWERDXX_PLATFORM_HPP_ */
@@ -0,0 +1,163 @@
+/**
+ * Implements the load emulation model shared by libloadplay and the
+ * mock platform of powerd++.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_PLATFORM_EMULATE_HPP_
+#define _POWERDXX_PLATFORM_EMULATE_HPP_
+
+#include "../types.hpp"
+#include "../constants.hpp"
+
+#include "formats.hpp"     /* CPUSTATES */
+
+#include <algorithm>       /* std::max(), std::min() */
+
+#include <cstdint>         /* uint64_t */
+
+namespace platform {
+
+/**
+ * The per core emulation of a recorded frame.
+ *
+ * Both libloadplay and the mock platform replay load records with
+ * this model, so both produce the same loads for the same record
+ * and clock frequencies.
+ */
+namespace emulate {
+
+using types::cptime_t;
+using types::mhz_t;
+using types::epp_t;
+
+using constants::EPP_BALANCED;
+
+/**
+ * The type to count clock cycles in.
+ */
+using cycles_t = uint64_t;
+
+/**
+ * The order in which the emulator assigns cycles to CPU states.
+ *
+ * The backlog of a state is delayed by the backlog of all states
+ * preceding it.
+ */
+constexpr size_t const CP_PRIORITY[]{CP_INTR, CP_SYS, CP_USER, CP_NICE};
+
+/**
+ * Emulates the clock frequency selection of hardware P-state drivers.
+ *
+ * The recorded clock frequency is taken to be the choice of the
+ * hardware at a balanced preference of 50. Lower preferences move
+ * the clock frequency towards the highest frequency, higher
+ * preferences reduce it down to half the recorded frequency at 100.
+ *
+ * @param epp
+ *	The energy/performance preference
+ * @param recFreq
+ *	The recorded clock frequency in [MHz]
+ * @param maxFreq
+ *	The highest clock frequency the hardware selects in [MHz]
+ * @return
+ *	The clock frequency in [MHz]
+ */
+inline mhz_t select(epp_t const epp, mhz_t const recFreq,
+                    mhz_t const maxFreq) {
+	auto const max = std::max(maxFreq, recFreq);
+	if (epp < EPP_BALANCED) {
+		return recFreq + (max - recFreq) * (EPP_BALANCED - epp) /
+		                 EPP_BALANCED;
+	}
+	return recFreq - recFreq * (std::min<epp_t>(epp, 100) -
+	                            EPP_BALANCED) / 100;
+}
+
+/**
+ * Emulates the cycles of a core during a frame.
+ *
+ * The recorded cycles and the cycles carried over from the previous
+ * frame are assigned at the emulated clock frequency in the order
+ * of CP_PRIORITY. Cycles that cannot be provided are carried over
+ * into the next frame, leftover cycles are assigned to the idle
+ * state.
+ *
+ * @param duration
+ *	The frame duration in [ms]
+ * @param recFreq
+ *	The recorded clock frequency in [MHz]
+ * @param recTicks
+ *	The recorded ticks for each CPU state
+ * @param runFreq
+ *	The emulated clock frequency in [MHz]
+ * @param carry
+ *	The cycles carried over, updated for the next frame
+ * @param cycles
+ *	Set to the emulated cycles for each CPU state
+ * @return
+ *	The emulated load cycles, i.e. all but the idle cycles
+ */
+inline cycles_t frame(uint64_t const duration, mhz_t const recFreq,
+                      cptime_t const (& recTicks)[CPUSTATES],
+                      mhz_t const runFreq,
+                      cycles_t (& carry)[CPUSTATES],
+                      cycles_t (& cycles)[CPUSTATES]) {
+	static_assert(CPUSTATES == 5, "All CPUSTATES must be implemented");
+
+	/* get recorded cycles */
+	cptime_t sumRecTicks{0};
+	for (auto const ticks : recTicks) {
+		sumRecTicks += ticks;
+	}
+	/* must be non-zero */
+	sumRecTicks += !sumRecTicks;
+	cycles_t const recCycles = duration * recFreq * 1000;
+	for (size_t state = 0; state < CPUSTATES; ++state) {
+		cycles[state] = recCycles * recTicks[state] / sumRecTicks +
+		                carry[state];
+		carry[state] = 0;
+	}
+
+	/* assign cycles in order of priority */
+	cycles_t available = duration * runFreq * 1000;
+	cycles_t load{0};
+	for (auto const state : CP_PRIORITY) {
+		if (available >= cycles[state]) {
+			available -= cycles[state];
+		} else {
+			carry[state] = cycles[state] - available;
+			cycles[state] = available;
+			available = 0;
+		}
+		load += cycles[state];
+	}
+	/* assign leftovers to the idle state */
+	cycles[CP_IDLE] = available;
+	return load;
+}
+
+/**
+ * Converts emulated cycles to tick counter increments.
+ *
+ * Use kcycles instead of cycles to prevent creating more than one
+ * wraparound per sample at reasonable powerd sample rates.
+ *
+ * The formula for the max powerd sampling cycle is:
+ * `max_cycle = 2^32 / max_clk / 1000`
+ *
+ * @param cycles
+ *	The number of cycles
+ * @return
+ *	The rounded number of kcycles
+ */
+constexpr cptime_t ticks(cycles_t const cycles) {
+	return (cycles + 500) / 1000;
+}
+
+} /* namespace emulate */
+
+} /* namespace platform */
+
+#endif /* _POWERDXX_PLATFORM_EMULATE_HPP_ */
@@ -0,0 +1,168 @@
+/**
+ * Implements parsers for the FreeBSD sysctl formats shared by the
+ * platforms of powerd++.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_PLATFORM_FORMATS_HPP_
+#define _POWERDXX_PLATFORM_FORMATS_HPP_
+
+#include "../types.hpp"
+#include "../utility.hpp"
+
+#include <vector>          /* std::vector */
+#include <string>          /* std::string */
+
+#include <cstdlib>         /* strtol() */
+#include <cstring>         /* std::strchr(), std::strncmp(), std::strlen() */
+
+#include <sys/resource.h>  /* CPUSTATES */
+
+#ifndef CPUSTATES
+/**
+ * The per core tick counters, in the order of FreeBSD's kern.cp_times.
+ */
+enum : size_t {
+	CP_USER,  /**< User time */
+	CP_NICE,  /**< User time of nice processes */
+	CP_SYS,   /**< System time */
+	CP_INTR,  /**< Interrupt and stolen time */
+	CP_IDLE,  /**< Idle time */
+	CPUSTATES /**< The number of tick counters */
+};
+#endif
+
+namespace platform {
+
+/**
+ * Parsers for the FreeBSD sysctl formats.
+ *
+ * These are used to interpret live sysctls as well as the sysctls
+ * stored in load records.
+ */
+namespace formats {
+
+using types::mhz_t;
+using types::coreid_t;
+
+using utility::Min;
+using utility::Max;
+
+/**
+ * Parse the CPU topology from the kern.sched.topology_spec format.
+ *
+ * @tparam GroupT
+ *	The topology group type, must be constructible from a core
+ *	membership vector and an SMT flag
+ * @param spec
+ *	The topology specification
+ * @param ncpu
+ *	The number of cores
+ * @param groups
+ *	The topology groups to fill
+ * @return
+ *	Whether the topology could be parsed, groups are left empty
+ *	otherwise
+ */
+template <class GroupT>
+bool topology(char const * const spec, coreid_t const ncpu,
+              std::vector<GroupT> & groups) {
+	std::vector<size_t> open;
+	for (auto pch = spec; (pch = std::strchr(pch, '<')); ++pch) {
+		if (0 == std::strncmp(pch, "<group ", 7)) {
+			groups.push_back({std::vector<bool>(ncpu), false});
+			open.push_back(groups.size() - 1);
+			continue;
+		}
+		if (0 == std::strncmp(pch, "</group>", 8)) {
+			if (open.empty()) { break; }
+			open.pop_back();
+			continue;
+		}
+		if (open.empty()) { continue; }
+		auto & group = groups[open.back()];
+		if (0 == std::strncmp(pch, "<cpu ", 5)) {
+			/* comma separated list of cores */
+			if (!(pch = std::strchr(pch, '>'))) { break; }
+			for (char * end{nullptr};; pch = end) {
+				auto const core = strtol(pch + 1, &end, 10);
+				if (end == pch + 1) { break; }
+				if (core >= 0 && core < ncpu) {
+					group.cores[core] = true;
+				}
+				if (*end != ',') { break; }
+			}
+			continue;
+		}
+		if (0 == std::strncmp(pch, "<flag name=\"", 12)) {
+			for (auto const flag : {"SMT\"", "THREAD\"", "HTT\""}) {
+				if (0 == std::strncmp(pch + 12, flag,
+				                      std::strlen(flag))) {
+					group.smt = true;
+				}
+			}
+		}
+	}
+	if (!open.empty()) {
+		groups.clear();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Parse the available clock frequencies from the
+ * dev.cpu.%d.freq_levels format.
+ *
+ * @param str
+ *	The space separated list of frequency/power pairs
+ * @param levels
+ *	Filled with the available frequencies
+ * @param min,max
+ *	Updated with the frequency levels
+ */
+inline void levels(char const * str, std::vector<mhz_t> & levels,
+                   Min<mhz_t> & min, Max<mhz_t> & max) {
+	for (char * pch{nullptr}; *str; str = pch + 1) {
+		mhz_t freq = strtol(str, &pch, 10);
+		if (pch[0] != '/') { break; }
+		max = freq;
+		min = freq;
+		levels.push_back(freq);
+		strtol(pch + 1, &pch, 10);
+		/* no idea what that value means */
+		if (pch[0] != ' ') { break; }
+	}
+}
+
+/**
+ * Format the sysctl name of a device from the device name and unit,
+ * e.g. the dev.cpufreq.%d.freq_driver value.
+ *
+ * @param fmt
+ *	The sysctl name format, taking the device name and unit,
+ *	e.g. `dev.%s.%d.epp`
+ * @param str
+ *	The device name followed by the unit, e.g. `hwpstate_intel0`
+ * @return
+ *	The sysctl name, e.g. `dev.hwpstate_intel.0.epp`, empty if
+ *	the device name does not end with a unit
+ */
+inline std::string device(char const * const fmt, char const * const str) {
+	auto const end = str + std::strlen(str);
+	auto unit = end;
+	for (; unit != str && unit[-1] >= '0' && unit[-1] <= '9'; --unit);
+	if (unit == str || unit == end) {
+		return {};
+	}
+	std::string const name(str, unit - str);
+	int const number = strtol(unit, nullptr, 10);
+	return utility::Formatter<128>{fmt}(name.c_str(), number);
+}
+
+} /* namespace formats */
+
+} /* namespace platform */
+
+#endif /* _POWERDXX_PLATFORM_FORMATS_HPP_ */
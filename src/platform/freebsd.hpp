@@ -0,0 +1,379 @@
+/**
+ * Implements the FreeBSD sysctl platform of powerd++.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_PLATFORM_FREEBSD_HPP_
+#define _POWERDXX_PLATFORM_FREEBSD_HPP_
+
+#ifndef __linux__
+
+#include "../types.hpp"
+#include "../constants.hpp"
+#include "../utility.hpp"
+#include "../clas.hpp"
+#include "../Cycle.hpp"
+
+#include "../sys/sysctl.hpp"
+
+#include "formats.hpp"
+
+#include <memory>          /* std::unique_ptr */
+#include <vector>          /* std::vector */
+
+#include <sys/cpuset.h>    /* cpuset_t, CPU_SET() */
+#include <pthread_np.h>    /* pthread_setaffinity_np() */
+
+/**
+ * The platform specific access to CPU loads, clock frequencies,
+ * temperatures and the AC line state.
+ *
+ * On FreeBSD everything is provided by sysctl(3).
+ */
+namespace platform {
+
+using types::cptime_t;
+using types::mhz_t;
+using types::coreid_t;
+using types::decikelvin_t;
+using types::epp_t;
+
+using utility::sprintf_safe;
+using utility::Min;
+using utility::Max;
+
+using sys::ctl::Sysctl;
+using sys::ctl::SysctlSync;
+using sys::ctl::SysctlOnce;
+
+/**
+ * The domain error type.
+ */
+using sys::ctl::error;
+
+/**
+ * The kind of source the platform reads from, used in messages.
+ */
+char const * const SOURCE = "sysctl";
+
+using constants::TOPOLOGY;
+using constants::ACLINE;
+using constants::FREQ;
+using constants::FREQ_LEVELS;
+using constants::FREQ_DRIVER;
+using constants::FREQ_DRIVER_BLACKLIST;
+using constants::EPP;
+using constants::TEMPERATURE;
+using constants::CP_TIMES;
+
+/**
+ * A core clock frequency handle.
+ *
+ * Reads and writes the clock frequency in MHz.
+ */
+using Freq = SysctlSync<mhz_t>;
+
+/**
+ * An energy/performance preference handle.
+ *
+ * Reads and writes the preference in [0, 100].
+ */
+using Epp = SysctlSync<epp_t>;
+
+/**
+ * A core temperature handle.
+ *
+ * Reads the temperature in dK.
+ */
+using Temp = SysctlSync<decikelvin_t>;
+
+/**
+ * Returns the number of CPU cores or threads.
+ *
+ * @return
+ *	The value of hw.ncpu, 1 if it cannot be read
+ */
+inline coreid_t ncpu() {
+	return SysctlOnce<coreid_t, 2>{1, {CTL_HW, HW_NCPU}};
+}
+
+/**
+ * Set the file system root of the platform.
+ *
+ * @return
+ *	Always false, sysctls do not live in a file system
+ */
+inline bool root(char const *) {
+	return false;
+}
+
+/**
+ * Validate a user provided temperature source name.
+ *
+ * @param str
+ *	A sysctl name, may contain a `%d`
+ * @return
+ *	The given name
+ */
+inline char const * sourcename(char const * const str) {
+	return clas::sysctlname(str);
+}
+
+/**
+ * Read the CPU topology from kern.sched.topology_spec.
+ *
+ * @tparam GroupT
+ *	The topology group type, must be constructible from a core
+ *	membership vector and an SMT flag
+ * @param ncpu
+ *	The number of cores
+ * @param groups
+ *	The topology groups to fill
+ * @return
+ *	Whether the topology could be parsed, groups are left empty
+ *	otherwise
+ * @throws sys::sc_error<error>
+ *	Throws if the topology cannot be read
+ */
+template <class GroupT>
+bool topology(coreid_t const ncpu, std::vector<GroupT> & groups) {
+	auto const spec = Sysctl{TOPOLOGY}.get<char>();
+	return formats::topology(spec.get(), ncpu, groups);
+}
+
+/**
+ * Returns the clock frequency handle of a core.
+ *
+ * @param core
+ *	The core number
+ * @return
+ *	The dev.cpu.%d.freq handle
+ * @throws sys::sc_error<error>
+ *	Throws ENOENT if the core does not control its clock frequency
+ */
+inline Freq freq(coreid_t const core) {
+	char name[40];
+	sprintf_safe(name, FREQ, core);
+	return {Sysctl{name}};
+}
+
+/**
+ * Read the available clock frequencies of a core.
+ *
+ * @param core
+ *	The core number
+ * @param levels
+ *	Filled with the available frequencies from dev.cpu.%d.freq_levels
+ * @param min,max
+ *	Updated with the frequency levels
+ * @throws sys::sc_error<error>
+ *	Throws if the frequency levels cannot be read
+ */
+inline void levels(coreid_t const core, std::vector<mhz_t> & levels,
+                   Min<mhz_t> & min, Max<mhz_t> & max) {
+	char name[40];
+	sprintf_safe(name, FREQ_LEVELS, core);
+	auto const str = Sysctl{name}.get<char>();
+	formats::levels(str.get(), levels, min, max);
+}
+
+/**
+ * Returns the name of the clock frequency driver of a core.
+ *
+ * @param core
+ *	The core number
+ * @return
+ *	The value of dev.cpufreq.%d.freq_driver
+ * @throws sys::sc_error<error>
+ *	Throws if there is no driver
+ */
+inline std::unique_ptr<char[]> driver(coreid_t const core) {
+	char name[40];
+	sprintf_safe(name, FREQ_DRIVER, core);
+	return Sysctl{name}.get<char>();
+}
+
+/**
+ * Returns the energy/performance preference handle of a core.
+ *
+ * @param core
+ *	The core number
+ * @return
+ *	The dev.%s.%d.epp handle of the frequency driver, e.g.
+ *	dev.hwpstate_intel.0.epp
+ * @throws sys::sc_error<error>
+ *	Throws if the driver does not provide a preference
+ */
+inline Epp epp(coreid_t const core) {
+	auto const name = formats::device(EPP, driver(core).get());
+	if (name.empty()) {
+		throw sys::sc_error<error>{ENOENT};
+	}
+	return {Sysctl{name.c_str()}};
+}
+
+/**
+ * Returns the temperature handle for the given sysctl.
+ *
+ * @param name
+ *	The sysctl name
+ * @return
+ *	The temperature handle
+ * @throws sys::sc_error<error>
+ *	Throws if the sysctl does not exist
+ */
+inline Temp temp(char const * const name) {
+	return {Sysctl{name}};
+}
+
+/**
+ * Returns the critical temperature of a core.
+ *
+ * @param core
+ *	The core number
+ * @return
+ *	The first readable temperature from constants::TJMAX_SOURCES
+ * @throws sys::sc_error<error>
+ *	Throws ENOENT if no source is available
+ */
+inline decikelvin_t tjmax(coreid_t const core) {
+	for (auto const source : constants::TJMAX_SOURCES) {
+		char name[40];
+		sprintf_safe(name, source, core);
+		try {
+			decikelvin_t value;
+			Sysctl{name}.get(value);
+			return value;
+		} catch (sys::sc_error<error>) {
+			/* do nada */
+		}
+	}
+	throw sys::sc_error<error>{ENOENT};
+}
+
+/**
+ * The AC line state handle.
+ *
+ * A default constructed instance is unavailable.
+ */
+class AcLine final {
+	private:
+	/**
+	 * The hw.acpi.acline sysctl.
+	 */
+	Sysctl<0> acline;
+
+	public:
+	/**
+	 * Construct an unavailable handle.
+	 */
+	AcLine() {}
+
+	/**
+	 * Open the AC line state sysctl.
+	 *
+	 * @param name
+	 *	The sysctl name
+	 * @throws sys::sc_error<error>
+	 *	Throws if the sysctl does not exist
+	 */
+	explicit AcLine(char const * const name) : acline{name} {}
+
+	/**
+	 * Returns the AC line state.
+	 *
+	 * @tparam T
+	 *	The state type
+	 * @param fallback
+	 *	The value to return if the state cannot be read
+	 * @return
+	 *	The state, 0 on battery, 1 online
+	 */
+	template <typename T>
+	T get(T const & fallback) const noexcept {
+		return sys::ctl::Once{fallback, this->acline};
+	}
+};
+
+/**
+ * The per core tick counters handle.
+ *
+ * A default constructed instance is unavailable.
+ */
+class Times final {
+	private:
+	/**
+	 * The kern.cp_times sysctl.
+	 */
+	Sysctl<0> cp_times;
+
+	public:
+	/**
+	 * Construct an unavailable handle.
+	 */
+	Times() {}
+
+	/**
+	 * Open kern.cp_times.
+	 *
+	 * @param ncpu
+	 *	The number of cores
+	 * @throws sys::sc_error<error>
+	 *	Throws if the sysctl does not exist
+	 */
+	explicit Times(coreid_t const) : cp_times{CP_TIMES} {}
+
+	/**
+	 * Read the tick counters of all cores.
+	 *
+	 * @param buf
+	 *	The buffer for ncpu cores
+	 * @param ncpu
+	 *	The number of cores
+	 * @throws sys::sc_error<error>
+	 *	Throws if the sysctl cannot be read
+	 */
+	void get(cptime_t (* const buf)[CPUSTATES], coreid_t const ncpu) {
+		try {
+			this->cp_times.get(buf, ncpu * sizeof(buf[0]));
+		} catch (sys::sc_error<error> e) {
+			/*
+			 * If HT is disabled kern.cp_times reports more cores
+			 * than hw.ncpu does. It's fine to ignore, because
+			 * these excess cores never report any load.
+			 */
+			if (e != ENOMEM) {
+				throw;
+			}
+		}
+	}
+};
+
+/**
+ * The sleep cycle of the control loop.
+ */
+using Cycle = timing::Cycle;
+
+/**
+ * Pins a thread to a single core.
+ *
+ * @param thread
+ *	The native thread handle
+ * @param core
+ *	The core to pin the thread to
+ * @return
+ *	An errno value, 0 on success
+ */
+inline int pin(pthread_t const thread, coreid_t const core) {
+	cpuset_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core, &set);
+	return pthread_setaffinity_np(thread, sizeof(set), &set);
+}
+
+} /* namespace platform */
+
+#endif /* !__linux__ */
+
+#endif /* _POWERDXX_PLATFORM_FREEBSD_HPP_ */
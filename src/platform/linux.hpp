@@ -0,0 +1,806 @@
+/**
+ * Implements the Linux cpufreq platform of powerd++.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_PLATFORM_LINUX_HPP_
+#define _POWERDXX_PLATFORM_LINUX_HPP_
+
+#ifdef __linux__
+
+#include "../types.hpp"
+#include "../utility.hpp"
+#include "../errors.hpp"
+#include "../Cycle.hpp"
+
+#include "../sys/sysfs.hpp"
+
+#include "formats.hpp"
+
+#include <memory>          /* std::unique_ptr */
+#include <vector>          /* std::vector */
+#include <string>          /* std::string */
+#include <algorithm>       /* std::find_if() */
+
+#include <cstdlib>         /* strtol(), strtoull() */
+#include <cstring>         /* std::strncmp(), std::strcspn() */
+
+#include <pthread.h>       /* pthread_setaffinity_np() */
+#include <sched.h>         /* cpu_set_t, CPU_SET() */
+#include <dirent.h>        /* opendir(), readdir() */
+#include <unistd.h>        /* sysconf() */
+
+/**
+ * The platform specific access to CPU loads, clock frequencies,
+ * temperatures and the AC line state.
+ *
+ * On Linux the cpufreq subsystem is accessed through sysfs, the load
+ * is read from procfs.
+ */
+namespace platform {
+
+using types::cptime_t;
+using types::mhz_t;
+using types::coreid_t;
+using types::decikelvin_t;
+using types::epp_t;
+
+using utility::Min;
+using utility::Max;
+using namespace utility::literals;
+
+using sys::sysfs::File;
+
+/**
+ * The domain error type.
+ */
+using sys::sysfs::error;
+
+/**
+ * The kind of source the platform reads from, used in messages.
+ */
+char const * const SOURCE = "file";
+
+/**
+ * The file system root, sysfs is expected in `sys/` and procfs
+ * in `proc/` relative to it.
+ */
+inline std::string prefix{"/"};
+
+/**
+ * The set of possible CPU cores.
+ */
+char const * const POSSIBLE = "sys/devices/system/cpu/possible";
+
+/**
+ * The CPU topology, the package and the SMT siblings of each core.
+ */
+char const * const TOPOLOGY = "sys/devices/system/cpu/cpu%d/topology";
+
+/**
+ * The cpufreq policy of a core.
+ */
+char const * const FREQ = "sys/devices/system/cpu/cpu%d/cpufreq";
+
+/**
+ * The frequency levels of a cpufreq policy.
+ */
+char const * const FREQ_LEVELS = "sys/devices/system/cpu/cpu%d/cpufreq/scaling_available_frequencies";
+
+/**
+ * The driver of a cpufreq policy.
+ */
+char const * const FREQ_DRIVER = "sys/devices/system/cpu/cpu%d/cpufreq/scaling_driver";
+
+/**
+ * A list of driver prefixes, that are known not to allow manual
+ * frequency control.
+ */
+char const * const FREQ_DRIVER_BLACKLIST[]{
+	"intel_pstate", "amd-pstate-epp"
+};
+
+/**
+ * The energy/performance preference of a cpufreq policy.
+ */
+char const * const EPP = "sys/devices/system/cpu/cpu%d/cpufreq/energy_performance_preference";
+
+/**
+ * The power supplies.
+ */
+char const * const ACLINE = "sys/class/power_supply";
+
+/**
+ * The default temperature source.
+ */
+char const * const TEMPERATURE = "sys/class/thermal/thermal_zone0/temp";
+
+/**
+ * The per core tick counters.
+ */
+char const * const CP_TIMES = "proc/stat";
+
+/**
+ * Returns a path relative to the file system root.
+ *
+ * @param name
+ *	The path relative to the root, may be a printf style format
+ * @param args
+ *	The format arguments
+ * @return
+ *	The path
+ */
+template <typename... ArgTs>
+std::string path(char const * const name, ArgTs const... args) {
+	return prefix + utility::Formatter<1024>{name}(args...);
+}
+
+/**
+ * Parse a list of cores.
+ *
+ * Supports the comma separated range format of `thread_siblings_list`,
+ * e.g. `0-3,8-11`, as well as the space separated format of
+ * `related_cpus`.
+ *
+ * @param str
+ *	The list of cores
+ * @param cores
+ *	The core membership vector to update
+ * @return
+ *	The first core in the list, -1 if there is none
+ */
+inline long cores(char const * str, std::vector<bool> & cores) {
+	long first = -1;
+	for (char * end{nullptr};; str = end + 1) {
+		auto const from = strtol(str, &end, 10);
+		if (end == str) { break; }
+		auto to = from;
+		if (*end == '-') {
+			str = end + 1;
+			to = strtol(str, &end, 10);
+			if (end == str) { break; }
+		}
+		for (auto core = from; core >= 0 && core <= to &&
+		     core < static_cast<long>(cores.size()); ++core) {
+			cores[core] = true;
+		}
+		first = first < 0 ? from : std::min(first, from);
+		if (*end != ',' && *end != ' ') { break; }
+	}
+	return first;
+}
+
+/**
+ * A core clock frequency handle.
+ *
+ * Reads `scaling_cur_freq` and writes `scaling_setspeed` of the
+ * cpufreq policy. The cpufreq interface uses kHz, the handle MHz.
+ */
+class Freq final {
+	private:
+	/**
+	 * The current clock frequency.
+	 */
+	File cur;
+
+	/**
+	 * The clock frequency to set.
+	 */
+	File set;
+
+	/**
+	 * The error opening the set file, reported on write.
+	 */
+	int seterr{0};
+
+	public:
+	/**
+	 * Construct an unopened handle.
+	 */
+	Freq() {}
+
+	/**
+	 * Open the cpufreq policy of a core.
+	 *
+	 * Only the first core of a policy owns the handle, like
+	 * dev.cpu.%d.freq only exists for the first core of a clock
+	 * domain on FreeBSD.
+	 *
+	 * @param core
+	 *	The core number
+	 * Policies that do not use the userspace governor cannot be
+	 * written, hardware P-state drivers may still be controlled
+	 * through the Epp handle.
+	 *
+	 * @throws sys::sc_error<error>
+	 *	Throws ENOENT if the core does not own a cpufreq policy
+	 */
+	explicit Freq(coreid_t const core) :
+	    cur{path("%s/scaling_cur_freq"_fmt(FREQ).c_str(), core).c_str()} {
+		std::vector<bool> related(core + 1);
+		auto const first = cores(File{path(
+		    "%s/related_cpus"_fmt(FREQ).c_str(), core).c_str()}.get().get(),
+		    related);
+		if (first != core) {
+			throw sys::sc_error<error>{ENOENT};
+		}
+		auto const governor = File{path(
+		    "%s/scaling_governor"_fmt(FREQ).c_str(), core).c_str()}.get();
+		if (0 != std::strncmp(governor.get(), "userspace", 9)) {
+			this->seterr = EOPNOTSUPP;
+			return;
+		}
+		auto const setspeed =
+		    path("%s/scaling_setspeed"_fmt(FREQ).c_str(), core);
+		try {
+			this->set = File{setspeed.c_str(), O_WRONLY | O_TRUNC};
+		} catch (sys::sc_error<error> e) {
+			if (e != EACCES) {
+				throw;
+			}
+			/* report like sysctl(3) on write */
+			this->seterr = EPERM;
+		}
+	}
+
+	/**
+	 * Set the clock frequency.
+	 *
+	 * @param value
+	 *	The clock frequency in MHz
+	 * @return
+	 *	A self reference
+	 * @throws sys::sc_error<error>
+	 *	Throws EPERM with insufficient privileges, EOPNOTSUPP
+	 *	if the policy does not use the userspace governor
+	 */
+	Freq & operator =(mhz_t const value) {
+		if (this->seterr) {
+			throw sys::sc_error<error>{this->seterr};
+		}
+		char buf[16];
+		utility::sprintf_safe(buf, "%u", value * 1000);
+		this->set.set(buf);
+		return *this;
+	}
+
+	/**
+	 * Returns the current clock frequency.
+	 *
+	 * @return
+	 *	The clock frequency in MHz
+	 */
+	operator mhz_t() const {
+		return this->cur.get<unsigned long>() / 1000;
+	}
+};
+
+/**
+ * An energy/performance preference handle.
+ *
+ * Reads and writes `energy_performance_preference` of the cpufreq
+ * policy. The interface uses the range [0, 255] or the names of
+ * `energy_performance_available_preferences`, the handle the
+ * range [0, 100].
+ */
+class Epp final {
+	private:
+	/**
+	 * The preference file.
+	 */
+	File file;
+
+	public:
+	/**
+	 * Construct an unopened handle.
+	 */
+	Epp() {}
+
+	/**
+	 * Open the preference of a cpufreq policy.
+	 *
+	 * @param core
+	 *	The core owning the policy
+	 * @throws sys::sc_error<error>
+	 *	Throws if the policy does not provide a preference
+	 */
+	explicit Epp(coreid_t const core) :
+	    file{path(EPP, core).c_str(), O_RDWR} {}
+
+	/**
+	 * Set the preference.
+	 *
+	 * @param value
+	 *	The preference in [0, 100]
+	 * @return
+	 *	A self reference
+	 * @throws sys::sc_error<error>
+	 *	Throws if the driver rejects the value, e.g. with the
+	 *	performance governor
+	 */
+	Epp & operator =(epp_t const value) {
+		char buf[16];
+		utility::sprintf_safe(buf, "%u", (value * 255 + 50) / 100);
+		this->file.set(buf);
+		return *this;
+	}
+
+	/**
+	 * Returns the preference.
+	 *
+	 * @return
+	 *	The preference in [0, 100]
+	 * @throws sys::sc_error<error>
+	 *	Throws EINVAL if the preference is not recognised
+	 */
+	operator epp_t() const {
+		struct { char const * name; epp_t value; } const names[]{
+			{"performance", 0}, {"balance_performance", 128},
+			{"balance_power", 192}, {"power", 255}
+		};
+		auto const str = this->file.get();
+		char * end{nullptr};
+		auto value = strtoul(str.get(), &end, 10);
+		if (end == str.get()) {
+			auto const len = std::strcspn(str.get(), "\n");
+			auto const it = std::find_if(
+			    std::begin(names), std::end(names),
+			    [&str, len](auto const & name) {
+				return std::strlen(name.name) == len &&
+				       0 == std::strncmp(str.get(), name.name, len);
+			});
+			if (it == std::end(names)) {
+				throw sys::sc_error<error>{EINVAL};
+			}
+			value = it->value;
+		}
+		return (std::min(value, 255ul) * 100 + 127) / 255;
+	}
+};
+
+/**
+ * A core temperature handle.
+ *
+ * Reads a thermal zone or hwmon temperature in m°C and converts
+ * it to dK.
+ */
+class Temp final {
+	private:
+	/**
+	 * The temperature file.
+	 */
+	File file;
+
+	public:
+	/**
+	 * Construct an unopened handle.
+	 */
+	Temp() {}
+
+	/**
+	 * Open a temperature file.
+	 *
+	 * @param name
+	 *	The path relative to the root
+	 * @throws sys::sc_error<error>
+	 *	Throws if the file cannot be opened
+	 */
+	explicit Temp(char const * const name) :
+	    file{(prefix + name).c_str()} {}
+
+	/**
+	 * Returns the temperature.
+	 *
+	 * @return
+	 *	The temperature in dK
+	 */
+	operator decikelvin_t() const {
+		return this->file.get<long>() / 100 + 2731;
+	}
+};
+
+/**
+ * Returns the number of CPU cores or threads.
+ *
+ * @return
+ *	The number of possible cores
+ */
+inline coreid_t ncpu() {
+	try {
+		std::vector<bool> possible(1024);
+		auto const list = File{path(POSSIBLE).c_str()}.get();
+		cores(list.get(), possible);
+		return std::max<coreid_t>(
+		    possible.rend() - std::find(possible.rbegin(),
+		                                possible.rend(), true), 1);
+	} catch (sys::sc_error<error>) {
+		return std::max<coreid_t>(sysconf(_SC_NPROCESSORS_CONF), 1);
+	}
+}
+
+/**
+ * Set the file system root of the platform.
+ *
+ * @param dir
+ *	The root directory
+ * @return
+ *	Always true
+ */
+inline bool root(char const * const dir) {
+	prefix = dir;
+	if (prefix.empty() || prefix.back() != '/') {
+		prefix += '/';
+	}
+	return true;
+}
+
+/**
+ * Validate a user provided temperature source name.
+ *
+ * @param str
+ *	A path relative to the root, may contain a `%d`
+ * @return
+ *	The given path
+ */
+inline char const * sourcename(char const * const str) {
+	if (!str || !*str) {
+		errors::fail(errors::Exit::ESYSCTLNAME, 0,
+		             "temperature file name missing");
+	}
+	return str;
+}
+
+/**
+ * Read the CPU topology.
+ *
+ * Creates a group for the SMT siblings, the package and the cpufreq
+ * policy of every core. Identical groups are only created once.
+ *
+ * @tparam GroupT
+ *	The topology group type, must be constructible from a core
+ *	membership vector and an SMT flag
+ * @param ncpu
+ *	The number of cores
+ * @param groups
+ *	The topology groups to fill
+ * @return
+ *	Always true
+ * @throws sys::sc_error<error>
+ *	Throws ENOENT if no topology information is available
+ */
+template <class GroupT>
+bool topology(coreid_t const ncpu, std::vector<GroupT> & groups) {
+	struct { char const * fmt; bool smt; } const sources[]{
+		{"%s/thread_siblings_list", true},
+		{"%s/core_siblings_list", false}
+	};
+	for (coreid_t core = 0; core < ncpu; ++core) {
+		auto add = [&](std::string const & name, bool const smt) {
+			std::unique_ptr<char[]> list;
+			try {
+				list = File{name.c_str()}.get();
+			} catch (sys::sc_error<error>) {
+				return;
+			}
+			GroupT group{std::vector<bool>(ncpu), smt};
+			if (cores(list.get(), group.cores) < 0) { return; }
+			if (groups.end() == std::find_if(
+			    groups.begin(), groups.end(),
+			    [&group](GroupT const & other) {
+				return other.cores == group.cores &&
+				       other.smt == group.smt;
+			})) {
+				groups.push_back(std::move(group));
+			}
+		};
+		for (auto const & source : sources) {
+			add(path(utility::Formatter<64>{source.fmt}(TOPOLOGY)
+			         .c_str(), core), source.smt);
+		}
+		add(path("%s/related_cpus"_fmt(FREQ).c_str(), core), false);
+	}
+	if (groups.empty()) {
+		throw sys::sc_error<error>{ENOENT};
+	}
+	return true;
+}
+
+/**
+ * Returns the clock frequency handle of a core.
+ *
+ * @param core
+ *	The core number
+ * @return
+ *	The cpufreq policy handle
+ * @throws sys::sc_error<error>
+ *	Throws ENOENT if the core does not own a cpufreq policy
+ */
+inline Freq freq(coreid_t const core) {
+	return Freq{core};
+}
+
+/**
+ * Read the available clock frequencies of a core.
+ *
+ * Not all drivers provide a list of frequencies, in that case only
+ * the boundaries are taken from `cpuinfo_min_freq` and
+ * `cpuinfo_max_freq`.
+ *
+ * @param core
+ *	The core number
+ * @param levels
+ *	Filled with the available frequencies
+ * @param min,max
+ *	Updated with the frequency boundaries
+ * @throws sys::sc_error<error>
+ *	Throws if neither the frequencies nor the boundaries can be read
+ */
+inline void levels(coreid_t const core, std::vector<mhz_t> & levels,
+                   Min<mhz_t> & min, Max<mhz_t> & max) {
+	try {
+		auto const str = File{path(FREQ_LEVELS, core).c_str()}.get();
+		for (char * pch = str.get(), * end{nullptr};; pch = end) {
+			mhz_t const freq = strtoul(pch, &end, 10) / 1000;
+			if (end == pch) { break; }
+			max = freq;
+			min = freq;
+			levels.push_back(freq);
+		}
+		if (!levels.empty()) { return; }
+	} catch (sys::sc_error<error>) {
+		/* fall back to the boundaries */
+	}
+	min = File{path("%s/cpuinfo_min_freq"_fmt(FREQ).c_str(), core)
+	           .c_str()}.get<unsigned long>() / 1000;
+	max = File{path("%s/cpuinfo_max_freq"_fmt(FREQ).c_str(), core)
+	           .c_str()}.get<unsigned long>() / 1000;
+}
+
+/**
+ * Returns the name of the clock frequency driver of a core.
+ *
+ * @param core
+ *	The core number
+ * @return
+ *	The contents of `scaling_driver` without the line break
+ * @throws sys::sc_error<error>
+ *	Throws if there is no driver
+ */
+inline std::unique_ptr<char[]> driver(coreid_t const core) {
+	auto str = File{path(FREQ_DRIVER, core).c_str()}.get();
+	str[std::strcspn(str.get(), "\n")] = 0;
+	return str;
+}
+
+/**
+ * Returns the energy/performance preference handle of a core.
+ *
+ * @param core
+ *	The core number
+ * @return
+ *	The cpufreq policy preference handle
+ * @throws sys::sc_error<error>
+ *	Throws if the policy does not provide a preference
+ */
+inline Epp epp(coreid_t const core) {
+	return Epp{core};
+}
+
+/**
+ * Returns the temperature handle for the given file.
+ *
+ * @param name
+ *	The path relative to the root
+ * @return
+ *	The temperature handle
+ * @throws sys::sc_error<error>
+ *	Throws if the file cannot be opened
+ */
+inline Temp temp(char const * const name) {
+	return Temp{name};
+}
+
+/**
+ * Returns the critical temperature of a core.
+ *
+ * This is the first `critical` trip point of the thermal zone of
+ * the default temperature source.
+ *
+ * @param core
+ *	The core number
+ * @return
+ *	The critical temperature in dK
+ * @throws sys::sc_error<error>
+ *	Throws ENOENT if there is no critical trip point
+ */
+inline decikelvin_t tjmax(coreid_t const) {
+	std::string const zone{TEMPERATURE,
+	                       std::strrchr(TEMPERATURE, '/') + 1};
+	for (unsigned int i = 0;; ++i) {
+		auto const type = File{path("%strip_point_%u_type"_fmt(
+		    zone.c_str(), i).c_str()).c_str()}.get();
+		if (0 == std::strncmp(type.get(), "critical", 8)) {
+			return Temp{"%strip_point_%u_temp"_fmt(
+			    zone.c_str(), i).c_str()};
+		}
+	}
+}
+
+/**
+ * The AC line state handle.
+ *
+ * A default constructed instance is unavailable.
+ */
+class AcLine final {
+	private:
+	/**
+	 * The `online` file of the mains power supply.
+	 */
+	File online;
+
+	public:
+	/**
+	 * Construct an unavailable handle.
+	 */
+	AcLine() {}
+
+	/**
+	 * Open the first mains power supply.
+	 *
+	 * @param name
+	 *	The power supply class directory relative to the root
+	 * @throws sys::sc_error<error>
+	 *	Throws ENOENT if there is no mains power supply
+	 */
+	explicit AcLine(char const * const name) {
+		auto const dir = path(name);
+		std::unique_ptr<DIR, int (*)(DIR *)> dirp{
+		    ::opendir(dir.c_str()), &::closedir};
+		if (!dirp) {
+			throw sys::sc_error<error>{errno};
+		}
+		while (auto const entry = ::readdir(dirp.get())) {
+			if (entry->d_name[0] == '.') { continue; }
+			auto const supply = dir + '/' + entry->d_name;
+			try {
+				auto const type =
+				    File{(supply + "/type").c_str()}.get();
+				if (0 != std::strncmp(type.get(), "Mains", 5)) {
+					continue;
+				}
+				this->online = File{(supply + "/online").c_str()};
+				return;
+			} catch (sys::sc_error<error>) {
+				/* try the next supply */
+			}
+		}
+		throw sys::sc_error<error>{ENOENT};
+	}
+
+	/**
+	 * Returns the AC line state.
+	 *
+	 * @tparam T
+	 *	The state type
+	 * @param fallback
+	 *	The value to return if the state cannot be read
+	 * @return
+	 *	The state, 0 on battery, 1 online
+	 */
+	template <typename T>
+	T get(T const & fallback) const noexcept {
+		try {
+			return static_cast<T>(this->online.get<unsigned int>());
+		} catch (sys::sc_error<error>) {
+			return fallback;
+		}
+	}
+};
+
+/**
+ * The per core tick counters handle.
+ *
+ * Reads the `cpuN` lines of `/proc/stat` and maps them to the
+ * FreeBSD kern.cp_times layout.
+ *
+ * A default constructed instance is unavailable.
+ */
+class Times final {
+	private:
+	/**
+	 * The statistics file.
+	 */
+	File stat;
+
+	/**
+	 * The read buffer, kept to avoid allocations.
+	 */
+	std::unique_ptr<char[]> buf;
+
+	/**
+	 * The size of the read buffer.
+	 */
+	size_t size{0};
+
+	public:
+	/**
+	 * Construct an unavailable handle.
+	 */
+	Times() {}
+
+	/**
+	 * Open the statistics file.
+	 *
+	 * @param ncpu
+	 *	The number of cores
+	 * @throws sys::sc_error<error>
+	 *	Throws if the file cannot be opened
+	 */
+	explicit Times(coreid_t const) : stat{path(CP_TIMES).c_str()} {}
+
+	/**
+	 * Read the tick counters of all cores.
+	 *
+	 * Offline cores are not listed, their counters are not updated.
+	 *
+	 * @param times
+	 *	The buffer for ncpu cores
+	 * @param ncpu
+	 *	The number of cores
+	 * @throws sys::sc_error<error>
+	 *	Throws if the file cannot be read
+	 */
+	void get(cptime_t (* const times)[CPUSTATES], coreid_t const ncpu) {
+		this->stat.read(this->buf, this->size);
+		for (char * pch = this->buf.get(); pch && *pch;
+		     (pch = std::strchr(pch, '\n')) && ++pch) {
+			/* skip the cpu total and everything else */
+			if (0 != std::strncmp(pch, "cpu", 3) ||
+			    pch[3] < '0' || pch[3] > '9') {
+				continue;
+			}
+			auto const core = strtol(pch + 3, &pch, 10);
+			if (core < 0 || core >= ncpu) { continue; }
+			/* user nice system idle iowait irq softirq steal */
+			cptime_t ticks[8]{};
+			for (auto & tick : ticks) {
+				tick = strtoull(pch, &pch, 10);
+			}
+			auto & dst = times[core];
+			dst[CP_USER] = ticks[0];
+			dst[CP_NICE] = ticks[1];
+			dst[CP_SYS]  = ticks[2];
+			dst[CP_INTR] = ticks[5] + ticks[6] + ticks[7];
+			dst[CP_IDLE] = ticks[3] + ticks[4];
+		}
+	}
+};
+
+/**
+ * The sleep cycle of the control loop.
+ */
+using Cycle = timing::Cycle;
+
+/**
+ * Pins a thread to a single core.
+ *
+ * @param thread
+ *	The native thread handle
+ * @param core
+ *	The core to pin the thread to
+ * @return
+ *	An errno value, 0 on success
+ */
+inline int pin(pthread_t const thread, coreid_t const core) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core, &set);
+	return pthread_setaffinity_np(thread, sizeof(set), &set);
+}
+
+} /* namespace platform */
+
+#endif /* __linux__ */
+
+#endif /* _POWERDXX_PLATFORM_LINUX_HPP_ */
@@ -0,0 +1,1003 @@
+/**
+ * Implements the mock platform of powerd++, which replays a load
+ * record in process.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_PLATFORM_MOCK_HPP_
+#define _POWERDXX_PLATFORM_MOCK_HPP_
+
+#ifdef PLATFORM_MOCK
+
+#include "../types.hpp"
+#include "../constants.hpp"
+#include "../version.hpp"
+#include "../utility.hpp"
+#include "../errors.hpp"
+#include "../clas.hpp"
+
+#include "../sys/error.hpp"
+#include "../sys/io.hpp"
+
+#include "formats.hpp"
+#include "emulate.hpp"
+
+#include <memory>          /* std::unique_ptr */
+#include <vector>          /* std::vector */
+#include <string>          /* std::string */
+#include <map>             /* std::map */
+#include <algorithm>       /* std::copy(), std::max(), std::min() */
+#include <chrono>          /* std::chrono::steady_clock */
+#include <charconv>        /* std::from_chars() */
+
+#include <cstdint>         /* uint64_t */
+#include <cstring>         /* std::strchr(), std::strlen(), std::memcpy() */
+
+#include <pthread.h>       /* pthread_t */
+
+/**
+ * The platform specific access to CPU loads, clock frequencies,
+ * temperatures and the AC line state.
+ *
+ * The mock platform emulates the sysctls of a load record, the load
+ * is emulated from the recorded frames. Time is virtual, the sleep
+ * cycle advances it by the polling interval and returns immediately,
+ * so a record is replayed as fast as the control loop runs and the
+ * outcome only depends on the record and the configuration.
+ *
+ * This is intended for benchmarking and regression testing the
+ * control loop, it is selected at compile time by defining
+ * PLATFORM_MOCK.
+ */
+namespace platform {
+
+using types::cptime_t;
+using types::mhz_t;
+using types::coreid_t;
+using types::decikelvin_t;
+using types::epp_t;
+using types::ms;
+using types::us;
+
+using utility::sprintf_safe;
+using utility::Min;
+using utility::Max;
+using namespace utility::literals;
+using namespace version::literals;
+
+using errors::Exit;
+using errors::fail;
+
+/**
+ * The domain error type.
+ */
+struct error {};
+
+/**
+ * The kind of source the platform reads from, used in messages.
+ */
+char const * const SOURCE = "record";
+
+using constants::TOPOLOGY;
+using constants::ACLINE;
+using constants::FREQ;
+using constants::FREQ_LEVELS;
+using constants::FREQ_DRIVER;
+using constants::FREQ_DRIVER_BLACKLIST;
+using constants::EPP;
+using constants::EPP_BALANCED;
+using constants::TEMPERATURE;
+using constants::CP_TIMES;
+
+using version::LOADREC_FEATURES;
+
+/**
+ * The load record emulation state.
+ */
+class Record final {
+	public:
+	/**
+	 * The type to count clock cycles in.
+	 */
+	using cycles_t = platform::emulate::cycles_t;
+
+	/**
+	 * Per core emulation state.
+	 */
+	struct Core {
+		/**
+		 * The core controlling the clock frequency of this core.
+		 */
+		coreid_t owner{0};
+
+		/**
+		 * The emulated clock frequency, only maintained by the
+		 * owner.
+		 */
+		mhz_t freq{0};
+
+		/**
+		 * The available clock frequencies, only maintained by
+		 * the owner.
+		 */
+		std::vector<mhz_t> levels{};
+
+		/**
+		 * The energy/performance preference, only maintained by
+		 * the owner, negative if the clock frequency driver does
+		 * not provide one.
+		 */
+		int epp{-1};
+
+		/**
+		 * The highest clock frequency the emulated hardware
+		 * selects.
+		 */
+		mhz_t maxFreq{0};
+
+		/**
+		 * The recorded clock frequency of the current frame.
+		 */
+		mhz_t recFreq{0};
+
+		/**
+		 * The recorded ticks of the current frame.
+		 */
+		cptime_t recTicks[CPUSTATES]{};
+
+		/**
+		 * The cycles carried over to the next frame.
+		 */
+		cycles_t carry[CPUSTATES]{};
+
+		/**
+		 * The emulated tick counters.
+		 */
+		cptime_t sum[CPUSTATES]{};
+	};
+
+	private:
+	/**
+	 * The recorded sysctls.
+	 */
+	std::map<std::string, std::string> sysctls;
+
+	/**
+	 * The load record feature flags.
+	 */
+	version::flag_t features{0};
+
+	/**
+	 * The recorded frames.
+	 */
+	std::string frames;
+
+	/**
+	 * The parsing position in the recorded frames.
+	 */
+	char const * pos{nullptr};
+
+	/**
+	 * The virtual time.
+	 */
+	ms time{0};
+
+	/**
+	 * The virtual start time of the next frame.
+	 */
+	ms next{0};
+
+	/**
+	 * Fetch the next value from the recorded frames.
+	 *
+	 * @tparam T
+	 *	The value type
+	 * @param value
+	 *	The value to set
+	 * @return
+	 *	Whether a value could be read
+	 */
+	template <typename T>
+	bool fetch(T & value) {
+		auto const end = this->frames.data() + this->frames.size();
+		for (; this->pos != end && (*this->pos == ' ' ||
+		                            *this->pos == '\n'); ++this->pos);
+		auto const [ptr, ec] = std::from_chars(this->pos, end, value);
+		this->pos = ptr;
+		return ec == std::errc{};
+	}
+
+	/**
+	 * Emulate a frame.
+	 *
+	 * Provides the recorded cycles at the emulated clock frequency
+	 * using the same model as libloadplay.
+	 *
+	 * @param duration
+	 *	The frame duration in ms
+	 */
+	void emulate(uint64_t const duration) {
+		for (coreid_t i = 0; i < this->ncpu; ++i) {
+			auto & core = this->cores[i];
+
+			/* select the hardware P-state */
+			if (core.epp >= 0) {
+				core.freq = platform::emulate::select(
+				    core.epp, core.recFreq, core.maxFreq);
+			}
+
+			/* provide the cycles at the clock of the owner */
+			cycles_t cycles[CPUSTATES]{};
+			platform::emulate::frame(
+			    duration, core.recFreq, core.recTicks,
+			    this->cores[core.owner].freq, core.carry, cycles);
+			for (size_t state = 0; state < CPUSTATES; ++state) {
+				core.sum[state] += platform::emulate::ticks(cycles[state]);
+			}
+		}
+	}
+
+	public:
+	/**
+	 * The number of cores in the recorded frames.
+	 */
+	coreid_t ncpu{0};
+
+	/**
+	 * The per core emulation state.
+	 */
+	std::unique_ptr<Core[]> cores;
+
+	/**
+	 * The number of completed sleep cycles.
+	 */
+	unsigned long polls{0};
+
+	/**
+	 * Returns whether a record was loaded.
+	 *
+	 * @return
+	 *	Whether the record is open
+	 */
+	explicit operator bool() const {
+		return this->ncpu > 0;
+	}
+
+	/**
+	 * Returns the virtual time.
+	 *
+	 * @return
+	 *	The time since the start of the record
+	 */
+	ms now() const {
+		return this->time;
+	}
+
+	/**
+	 * Returns a recorded sysctl value.
+	 *
+	 * @param name
+	 *	The sysctl name, may be a format with a `%d`
+	 * @param core
+	 *	The core number to format the name with
+	 * @return
+	 *	The value
+	 * @throws sys::sc_error<error>
+	 *	Throws ENOENT if the sysctl was not recorded
+	 */
+	char const * get(char const * const name, coreid_t const core = 0) const {
+		char buf[128];
+		sprintf_safe(buf, name, core);
+		auto const it = this->sysctls.find(buf);
+		if (it == this->sysctls.end()) {
+			throw sys::sc_error<error>{ENOENT};
+		}
+		return it->second.c_str();
+	}
+
+	/**
+	 * Returns a recorded integer sysctl value.
+	 *
+	 * @tparam T
+	 *	The value type
+	 * @param name
+	 *	The sysctl name, may be a format with a `%d`
+	 * @param core
+	 *	The core number to format the name with
+	 * @return
+	 *	The value
+	 * @throws sys::sc_error<error>
+	 *	Throws ENOENT if the sysctl was not recorded, EINVAL if
+	 *	the value is not a number
+	 */
+	template <typename T>
+	T get(char const * const name, coreid_t const core = 0) const {
+		auto const str = this->get(name, core);
+		T value{};
+		if (std::from_chars(str, str + std::strlen(str), value).ec !=
+		    std::errc{}) {
+			throw sys::sc_error<error>{EINVAL};
+		}
+		return value;
+	}
+
+	/**
+	 * Read a load record.
+	 *
+	 * The record is read completely, so file access does not
+	 * interfere with the emulation.
+	 *
+	 * @param filename
+	 *	The load record file name
+	 */
+	void open(char const * const filename) {
+		sys::io::file<sys::io::own, sys::io::read> fin{filename, "rb"};
+		if (!fin) {
+			fail(Exit::EROPEN, errno,
+			     "cannot open load record: %s"_fmt(filename));
+		}
+
+		/* read the complete record */
+		char buf[16384];
+		for (size_t len; (len = fin.read(buf, sizeof(buf)));) {
+			this->frames.append(buf, len);
+		}
+
+		/* get static sysctls, i.e. "name=value\n" lines */
+		auto const data = this->frames.c_str();
+		auto bol = data;
+		for (char const * sep{nullptr}, * eol{nullptr};
+		     (eol = std::strchr(bol, '\n')) &&
+		     (sep = std::strchr(bol, '=')) && sep < eol; bol = eol + 1) {
+			this->sysctls[std::string(bol, sep - bol)] =
+			    std::string(sep + 1, eol - sep - 1);
+		}
+
+		/* check supported feature flags */
+		try {
+			this->features = this->get<version::flag_t>(LOADREC_FEATURES);
+		} catch (sys::sc_error<error>) {
+			/* legacy record */
+		}
+		if (this->features & 1_BINARY) {
+			fail(Exit::ERECORD, 0,
+			     "binary load records are not supported, use loadconv(1) to convert: %s"_fmt
+			     (filename));
+		}
+		if (this->features & ~(1_FREQ_TRACKING)) {
+			fail(Exit::ERECORD, 0,
+			     "%s contains unsupported feature flags: %#lx"_fmt
+			     (LOADREC_FEATURES, this->features));
+		}
+
+		/* determine the number of cores from the first frame */
+		this->pos = bol;
+		bool const tracking = this->features & 1_FREQ_TRACKING;
+		uint64_t duration{1};
+		if (!this->fetch(duration) || duration != 0) {
+			fail(Exit::ERECORD, 0,
+			     "first frame time must be 0: %.8s"_fmt(bol));
+		}
+		auto eol = std::strchr(this->pos, '\n');
+		eol = eol ? eol : data + this->frames.size();
+		size_t columns = 0;
+		for (; this->pos < eol; ++columns) {
+			cptime_t value;
+			if (!this->fetch(value)) { break; }
+		}
+		this->ncpu = columns / (CPUSTATES + tracking);
+		if (this->ncpu < 1) {
+			fail(Exit::ERECORD, 0,
+			     "load record must contain at least one core");
+		}
+		this->cores = std::unique_ptr<Core[]>{new Core[this->ncpu]};
+
+		/* set up the clock frequencies */
+		for (coreid_t i = 0; i < this->ncpu; ++i) {
+			auto & core = this->cores[i];
+			try {
+				core.freq = this->get<mhz_t>(FREQ, i);
+				core.owner = i;
+			} catch (sys::sc_error<error>) {
+				if (i == 0) {
+					char name[40];
+					sprintf_safe(name, FREQ, i);
+					fail(Exit::ERECORD, 0,
+					     "%s is not set, please check your load record"_fmt
+					     (name));
+				}
+				core.owner = this->cores[i - 1].owner;
+			}
+			core.recFreq = this->cores[core.owner].freq;
+			if (core.owner != i) { continue; }
+			Min<mhz_t> min{0};
+			Max<mhz_t> max{core.freq};
+			try {
+				formats::levels(this->get(FREQ_LEVELS, i),
+				                core.levels, min, max);
+			} catch (sys::sc_error<error>) {
+				/* accept any clock frequency */
+			}
+
+			/*
+			 * Emulate the energy/performance preference of
+			 * hardware P-state drivers.
+			 */
+			try {
+				auto const driver = this->get(FREQ_DRIVER, i);
+				auto const name = formats::device(EPP, driver);
+				if (this->sysctls.count(name)) {
+					core.epp = this->get<epp_t>(name.c_str());
+				}
+				for (auto const prefix : constants::EPP_DRIVERS) {
+					if (core.epp < 0 &&
+					    0 == std::strncmp(driver, prefix,
+					                      std::strlen(prefix))) {
+						core.epp = constants::EPP_BALANCED;
+					}
+				}
+			} catch (sys::sc_error<error>) {
+				/* no driver, no preference */
+			}
+			core.maxFreq = max;
+		}
+
+		/* initialise the tick counters from the first frame */
+		this->pos = bol;
+		this->fetch(duration);
+		for (coreid_t i = 0; tracking && i < this->ncpu; ++i) {
+			this->fetch(this->cores[i].recFreq);
+		}
+		for (coreid_t i = 0; i < this->ncpu; ++i) {
+			for (auto & ticks : this->cores[i].sum) {
+				this->fetch(ticks);
+			}
+		}
+	}
+
+	/**
+	 * Advance the virtual time.
+	 *
+	 * Emulates all frames that start within the given time. Like
+	 * with libloadplay the load of a frame becomes visible at the
+	 * beginning of the frame.
+	 *
+	 * @param duration
+	 *	The time to advance
+	 * @return
+	 *	Whether the record still covers the new virtual time
+	 */
+	bool advance(ms const duration) {
+		this->time += duration;
+		bool const tracking = this->features & 1_FREQ_TRACKING;
+		while (this->next <= this->time) {
+			uint64_t frame{0};
+			bool complete = this->fetch(frame);
+			for (coreid_t i = 0; complete && tracking &&
+			     i < this->ncpu; ++i) {
+				complete = this->fetch(this->cores[i].recFreq);
+			}
+			for (coreid_t i = 0; complete && i < this->ncpu; ++i) {
+				for (auto & ticks : this->cores[i].recTicks) {
+					complete = complete && this->fetch(ticks);
+				}
+			}
+			/* drop truncated frames */
+			if (!complete) {
+				return false;
+			}
+			this->emulate(frame);
+			this->next += ms{frame};
+		}
+		++this->polls;
+		return true;
+	}
+};
+
+/**
+ * The replayed load record.
+ */
+inline Record record;
+
+/**
+ * A core clock frequency handle.
+ *
+ * Writes are snapped to the closest recorded frequency level.
+ */
+class Freq final {
+	private:
+	/**
+	 * The emulated core.
+	 */
+	Record::Core * core{nullptr};
+
+	public:
+	/**
+	 * Construct an unavailable handle.
+	 */
+	Freq() {}
+
+	/**
+	 * Construct the handle of a core.
+	 *
+	 * @param core
+	 *	The core number
+	 * @throws sys::sc_error<error>
+	 *	Throws ENOENT if the core does not control its clock
+	 *	frequency
+	 */
+	explicit Freq(coreid_t const core) {
+		if (core < 0 || core >= record.ncpu ||
+		    record.cores[core].owner != core) {
+			throw sys::sc_error<error>{ENOENT};
+		}
+		this->core = &record.cores[core];
+	}
+
+	/**
+	 * Set the clock frequency.
+	 *
+	 * @param value
+	 *	The clock frequency in MHz
+	 * @return
+	 *	A self reference
+	 */
+	Freq & operator =(mhz_t const value) {
+		auto freq = value;
+		auto diff = value + 1000000;
+		for (auto const level : this->core->levels) {
+			auto const leveldiff = (level > value ?
+			                        level - value : value - level);
+			if (leveldiff < diff) {
+				diff = leveldiff;
+				freq = level;
+			}
+		}
+		this->core->freq = freq;
+		return *this;
+	}
+
+	/**
+	 * Returns the current clock frequency.
+	 *
+	 * @return
+	 *	The clock frequency in MHz
+	 */
+	operator mhz_t() const {
+		return this->core->freq;
+	}
+};
+
+/**
+ * An energy/performance preference handle.
+ *
+ * The preference biases the recorded clock frequencies from the
+ * next frame on.
+ */
+class Epp final {
+	private:
+	/**
+	 * The emulated core.
+	 */
+	Record::Core * core{nullptr};
+
+	public:
+	/**
+	 * Construct an unavailable handle.
+	 */
+	Epp() {}
+
+	/**
+	 * Construct the handle of a core.
+	 *
+	 * @param core
+	 *	The core number
+	 * @throws sys::sc_error<error>
+	 *	Throws ENOENT if the core does not provide a preference
+	 */
+	explicit Epp(coreid_t const core) {
+		if (core < 0 || core >= record.ncpu ||
+		    record.cores[core].owner != core ||
+		    record.cores[core].epp < 0) {
+			throw sys::sc_error<error>{ENOENT};
+		}
+		this->core = &record.cores[core];
+	}
+
+	/**
+	 * Set the preference.
+	 *
+	 * @param value
+	 *	The preference in [0, 100]
+	 * @return
+	 *	A self reference
+	 */
+	Epp & operator =(epp_t const value) {
+		this->core->epp = std::min<epp_t>(value, 100);
+		return *this;
+	}
+
+	/**
+	 * Returns the preference.
+	 *
+	 * @return
+	 *	The preference in [0, 100]
+	 */
+	operator epp_t() const {
+		return this->core->epp;
+	}
+};
+
+/**
+ * A core temperature handle.
+ *
+ * Recorded temperatures are constant.
+ */
+class Temp final {
+	private:
+	/**
+	 * The recorded temperature.
+	 */
+	decikelvin_t value{0};
+
+	public:
+	/**
+	 * Construct an unavailable handle.
+	 */
+	Temp() {}
+
+	/**
+	 * Read a recorded temperature.
+	 *
+	 * @param name
+	 *	The sysctl name
+	 * @throws sys::sc_error<error>
+	 *	Throws if the sysctl was not recorded
+	 */
+	explicit Temp(char const * const name) :
+	    value{record.get<decikelvin_t>(name)} {}
+
+	/**
+	 * Returns the temperature.
+	 *
+	 * @return
+	 *	The temperature in dK
+	 */
+	operator decikelvin_t() const {
+		return this->value;
+	}
+};
+
+/**
+ * Returns the number of CPU cores or threads.
+ *
+ * @return
+ *	The recorded hw.ncpu, the number of recorded cores if it is
+ *	missing
+ */
+inline coreid_t ncpu() {
+	if (!record) {
+		fail(Exit::ECLARG, 0, "a load record is required, use --root");
+	}
+	try {
+		return std::max(record.get<coreid_t>("hw.ncpu"), coreid_t{1});
+	} catch (sys::sc_error<error>) {
+		return record.ncpu;
+	}
+}
+
+/**
+ * Read the load record to replay.
+ *
+ * @param filename
+ *	The load record file name
+ * @return
+ *	Always true
+ */
+inline bool root(char const * const filename) {
+	record.open(filename);
+	return true;
+}
+
+/**
+ * Validate a user provided temperature source name.
+ *
+ * @param str
+ *	A sysctl name, may contain a `%d`
+ * @return
+ *	The given name
+ */
+inline char const * sourcename(char const * const str) {
+	return clas::sysctlname(str);
+}
+
+/**
+ * Read the CPU topology from the recorded kern.sched.topology_spec.
+ *
+ * @tparam GroupT
+ *	The topology group type, must be constructible from a core
+ *	membership vector and an SMT flag
+ * @param ncpu
+ *	The number of cores
+ * @param groups
+ *	The topology groups to fill
+ * @return
+ *	Whether the topology could be parsed, groups are left empty
+ *	otherwise
+ * @throws sys::sc_error<error>
+ *	Throws if the topology was not recorded
+ */
+template <class GroupT>
+bool topology(coreid_t const ncpu, std::vector<GroupT> & groups) {
+	return formats::topology(record.get(TOPOLOGY), ncpu, groups);
+}
+
+/**
+ * Returns the clock frequency handle of a core.
+ *
+ * @param core
+ *	The core number
+ * @return
+ *	The emulated clock frequency handle
+ * @throws sys::sc_error<error>
+ *	Throws ENOENT if the core does not control its clock frequency
+ */
+inline Freq freq(coreid_t const core) {
+	return Freq{core};
+}
+
+/**
+ * Read the available clock frequencies of a core.
+ *
+ * @param core
+ *	The core number
+ * @param levels
+ *	Filled with the recorded dev.cpu.%d.freq_levels
+ * @param min,max
+ *	Updated with the frequency levels
+ * @throws sys::sc_error<error>
+ *	Throws if the frequency levels were not recorded
+ */
+inline void levels(coreid_t const core, std::vector<mhz_t> & levels,
+                   Min<mhz_t> & min, Max<mhz_t> & max) {
+	formats::levels(record.get(FREQ_LEVELS, core), levels, min, max);
+}
+
+/**
+ * Returns the name of the clock frequency driver of a core.
+ *
+ * @param core
+ *	The core number
+ * @return
+ *	The recorded dev.cpufreq.%d.freq_driver
+ * @throws sys::sc_error<error>
+ *	Throws if the driver was not recorded
+ */
+inline std::unique_ptr<char[]> driver(coreid_t const core) {
+	auto const value = record.get(FREQ_DRIVER, core);
+	auto const len = std::strlen(value) + 1;
+	std::unique_ptr<char[]> result{new char[len]};
+	std::memcpy(result.get(), value, len);
+	return result;
+}
+
+/**
+ * Returns the energy/performance preference handle of a core.
+ *
+ * @param core
+ *	The core number
+ * @return
+ *	The emulated preference handle
+ * @throws sys::sc_error<error>
+ *	Throws ENOENT if the core does not provide a preference
+ */
+inline Epp epp(coreid_t const core) {
+	return Epp{core};
+}
+
+/**
+ * Returns the temperature handle for the given sysctl.
+ *
+ * @param name
+ *	The sysctl name
+ * @return
+ *	The temperature handle
+ * @throws sys::sc_error<error>
+ *	Throws if the sysctl was not recorded
+ */
+inline Temp temp(char const * const name) {
+	return Temp{name};
+}
+
+/**
+ * Returns the critical temperature of a core.
+ *
+ * @param core
+ *	The core number
+ * @return
+ *	The first recorded temperature from constants::TJMAX_SOURCES
+ * @throws sys::sc_error<error>
+ *	Throws ENOENT if no source was recorded
+ */
+inline decikelvin_t tjmax(coreid_t const core) {
+	for (auto const source : constants::TJMAX_SOURCES) {
+		try {
+			return record.get<decikelvin_t>(source, core);
+		} catch (sys::sc_error<error>) {
+			/* do nada */
+		}
+	}
+	throw sys::sc_error<error>{ENOENT};
+}
+
+/**
+ * The AC line state handle.
+ *
+ * A default constructed instance is unavailable.
+ */
+class AcLine final {
+	private:
+	/**
+	 * The recorded state, negative if unavailable.
+	 */
+	int state{-1};
+
+	public:
+	/**
+	 * Construct an unavailable handle.
+	 */
+	AcLine() {}
+
+	/**
+	 * Read the recorded AC line state.
+	 *
+	 * @param name
+	 *	The sysctl name
+	 * @throws sys::sc_error<error>
+	 *	Throws if the sysctl was not recorded
+	 */
+	explicit AcLine(char const * const name) :
+	    state{record.get<int>(name)} {}
+
+	/**
+	 * Returns the AC line state.
+	 *
+	 * @tparam T
+	 *	The state type
+	 * @param fallback
+	 *	The value to return if the state is unavailable
+	 * @return
+	 *	The state, 0 on battery, 1 online
+	 */
+	template <typename T>
+	T get(T const & fallback) const noexcept {
+		return this->state < 0 ? fallback : static_cast<T>(this->state);
+	}
+};
+
+/**
+ * The per core tick counters handle.
+ *
+ * A default constructed instance is unavailable.
+ */
+class Times final {
+	public:
+	/**
+	 * Construct a handle.
+	 */
+	Times() {}
+
+	/**
+	 * Construct a handle.
+	 *
+	 * @param ncpu
+	 *	The number of cores
+	 */
+	explicit Times(coreid_t const) {}
+
+	/**
+	 * Read the emulated tick counters of all cores.
+	 *
+	 * Cores missing from the record never report any load.
+	 *
+	 * @param buf
+	 *	The buffer for ncpu cores
+	 * @param ncpu
+	 *	The number of cores
+	 */
+	void get(cptime_t (* const buf)[CPUSTATES], coreid_t const ncpu) {
+		for (coreid_t i = 0; i < ncpu && i < record.ncpu; ++i) {
+			std::copy(std::begin(record.cores[i].sum),
+			          std::end(record.cores[i].sum),
+			          std::begin(buf[i]));
+		}
+	}
+};
+
+/**
+ * Pins a thread to a single core.
+ *
+ * The emulated cores do not exist, so threads are not pinned.
+ *
+ * @return
+ *	Always 0
+ */
+inline int pin(pthread_t const, coreid_t const) {
+	return 0;
+}
+
+/**
+ * Implements the sleep cycle on the virtual time.
+ *
+ * Each sleep cycle advances the virtual time and emulates the
+ * recorded frames within it. The cycle is interrupted when the
+ * end of the record is reached, at which point the replay
+ * throughput is reported.
+ */
+class Cycle final {
+	private:
+	/**
+	 * Use steady_clock, avoid time jumps.
+	 */
+	using clock = std::chrono::steady_clock;
+
+	/**
+	 * The time the replay started.
+	 */
+	std::chrono::time_point<clock> const start = clock::now();
+
+	public:
+	/**
+	 * Completes an interrupted sleep cycle.
+	 *
+	 * @return
+	 *	Always true
+	 */
+	bool operator ()() const {
+		return true;
+	}
+
+	/**
+	 * Advance the virtual time by the given cycle time.
+	 *
+	 * @tparam DurTraits
+	 *	The traits of the duration type
+	 * @param cycleTime
+	 *	The duration of the cycle to complete
+	 * @retval true
+	 *	The cycle completed
+	 * @retval false
+	 *	The end of the record was reached
+	 */
+	template <class... DurTraits>
+	bool operator ()(std::chrono::duration<DurTraits...> const & cycleTime) {
+		if (record.advance(std::chrono::duration_cast<ms>(cycleTime))) {
+			return true;
+		}
+		auto const wall = std::chrono::duration_cast<us>(
+		    clock::now() - this->start).count();
+		sys::io::ferr.printf("powerd++: replayed %lu polls, "
+		                "%.3f s virtual time in %.3f s, %.0f polls/s\n",
+		                record.polls, record.now().count() / 1000.,
+		                wall / 1000000., wall ?
+		                record.polls * 1000000. / wall : 0.);
+		return false;
+	}
+
+	/**
+	 * Returns the time passed since the end of the current cycle.
+	 *
+	 * @return
+	 *	Always 0, the virtual time is never late
+	 */
+	us late() const {
+		return us{0};
+	}
+};
+
+} /* namespace platform */
+
+#endif /* PLATFORM_MOCK */
+
+#endif /* _POWERDXX_PLATFORM_MOCK_HPP_ */
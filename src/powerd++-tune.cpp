@@ -0,0 +1,684 @@
+/**
+ * Implements powerd++-tune, a tool searching the parameter space of
+ * powerd++ against a corpus of load recordings.
+ *
+ * @file
+ */
+
+#include "Options.hpp"
+
+#include "errors.hpp"
+#include "utility.hpp"
+
+#include "sys/env.hpp"
+#include "sys/io.hpp"
+
+#include <algorithm> /* std::sort() */
+#include <limits>    /* std::numeric_limits */
+#include <string>
+#include <vector>
+
+#include <cstdlib>   /* strtod(), mkdtemp() */
+#include <cstring>   /* strlen(), strcmp(), strrchr() */
+
+#include <fcntl.h>     /* open() */
+#include <unistd.h>    /* execvp(), fork(), dup2(), unlink(), rmdir() */
+#include <sys/wait.h>  /* waitpid() */
+
+/**
+ * File local scope.
+ */
+namespace {
+
+using nih::Parameter;
+using nih::Options;
+
+using errors::Exit;
+using errors::Exception;
+using errors::fail;
+
+namespace io = sys::io;
+
+using utility::to_value;
+using namespace utility::literals;
+
+using namespace std::literals::string_literals;
+
+/**
+ * A list of values for a single daemon parameter.
+ */
+using Values = std::vector<std::string>;
+
+/**
+ * The global state.
+ */
+struct {
+	bool verbose{false};   /**< Print all configurations. */
+
+	/**
+	 * The number of concurrent replays.
+	 */
+	size_t jobs{1};
+
+	/**
+	 * The path prefix for the loadplay and powerd++ commands.
+	 */
+	std::string prefix{};
+
+	/**
+	 * The daemon to tune.
+	 */
+	std::string daemon{};
+
+	/**
+	 * The load targets to try.
+	 */
+	Values modes{"0.25", "0.375", "0.5", "0.625", "0.75"};
+
+	/**
+	 * The polling intervals to try.
+	 */
+	Values polls{"250ms", "500ms", "1s"};
+
+	/**
+	 * The sample counts to try.
+	 */
+	Values samples{"2", "4", "8"};
+
+	/**
+	 * The frequency ranges to try, an empty string means the daemon
+	 * default.
+	 */
+	Values ranges{""};
+
+	/**
+	 * The load recordings to replay.
+	 */
+	std::vector<char const *> recordings{};
+
+	/**
+	 * Set if configurations are ranked by the energy estimate
+	 * instead of the clock frequency proxy.
+	 */
+	bool energy{false};
+} g;
+
+/**
+ * An enum for command line parsing.
+ */
+enum class OE {
+	USAGE,            /**< Print help */
+	FLAG_VERBOSE,     /**< Print all configurations */
+	CNT_JOBS,         /**< Set number of concurrent replays */
+	CMD_DAEMON,       /**< Set the daemon to tune */
+	MODES,            /**< Set the load targets to try */
+	IVALS_POLL,       /**< Set the polling intervals to try */
+	CNTS_SAMPLES,     /**< Set the sample counts to try */
+	FREQ_RANGES,      /**< Set the frequency ranges to try */
+	FILE_LOAD,        /**< A load recording */
+	OPT_NOOPT = FILE_LOAD, /**< Obligatory */
+	OPT_UNKNOWN,      /**< Obligatory */
+	OPT_DASH,         /**< Obligatory */
+	OPT_LDASH,        /**< Obligatory */
+	OPT_DONE          /**< Obligatory */
+};
+
+/**
+ * The short usage string.
+ */
+char const * const USAGE = "[-hv] [-j cnt] [-x command] [-a modes] [-p ivals] [-s cnts] [-F ranges] file ...";
+
+/**
+ * Definitions of command line parameters.
+ */
+Parameter<OE> const PARAMETERS[]{
+	{OE::USAGE,        'h', "help",        "",        "Show usage and exit"},
+	{OE::FLAG_VERBOSE, 'v', "verbose",     "",        "Print all configurations"},
+	{OE::CNT_JOBS,     'j', "jobs",        "cnt",     "Replay up to cnt configurations concurrently"},
+	{OE::CMD_DAEMON,   'x', "daemon",      "command", "The daemon to tune"},
+	{OE::MODES,        'a', "modes",       "modes",   "Comma separated load targets to try"},
+	{OE::IVALS_POLL,   'p', "poll",        "ivals",   "Comma separated polling intervals to try"},
+	{OE::CNTS_SAMPLES, 's', "samples",     "cnts",    "Comma separated sample counts to try"},
+	{OE::FREQ_RANGES,  'F', "freq-ranges", "ranges",  "Comma separated CPU frequency ranges to try"},
+	{OE::FILE_LOAD,     0 , "",            "file",    "A load recording"},
+};
+
+/**
+ * Split a comma separated list of values.
+ *
+ * @param str
+ *	The list of values
+ * @return
+ *	The values
+ */
+Values values(char const * const str) {
+	if (!str || !str[0]) {
+		fail(Exit::ECLARG, 0, "empty or missing list of values");
+	}
+	Values result;
+	for (auto it = str;; ++it) {
+		auto const sep = std::strchr(it, ',');
+		result.emplace_back(it, sep ? sep : it + std::strlen(it));
+		if (result.back().empty()) {
+			fail(Exit::ECLARG, 0, "empty value in list: "s + str);
+		}
+		if (!sep) {
+			return result;
+		}
+		it = sep;
+	}
+}
+
+/**
+ * Performs very rudimentary job count argument checks.
+ *
+ * @param str
+ *	The job count argument
+ * @return
+ *	The number of concurrent jobs
+ */
+size_t jobs(char const * const str) {
+	size_t value{0};
+	if (!str || !utility::FromChars{str, str + std::strlen(str)}(value) ||
+	    value < 1 || value > 1024) {
+		fail(Exit::EOUTOFRANGE, 0,
+		     "job count must be an integer in the range [1, 1024]");
+	}
+	return value;
+}
+
+/**
+ * Parse command line arguments.
+ *
+ * @param argc,argv
+ *	The command line arguments
+ */
+void read_args(int const argc, char const * const argv[]) {
+	auto getopt = Options{argc, argv, USAGE, PARAMETERS};
+
+	try {
+		while (true) switch (getopt()) {
+		case OE::USAGE:
+			io::ferr.printf("%s", getopt.usage().c_str());
+			throw Exception{Exit::OK, 0, ""};
+		case OE::FLAG_VERBOSE:
+			g.verbose = true;
+			break;
+		case OE::CNT_JOBS:
+			g.jobs = jobs(getopt[1]);
+			break;
+		case OE::CMD_DAEMON:
+			g.daemon = getopt[1];
+			break;
+		case OE::MODES:
+			g.modes = values(getopt[1]);
+			break;
+		case OE::IVALS_POLL:
+			g.polls = values(getopt[1]);
+			break;
+		case OE::CNTS_SAMPLES:
+			g.samples = values(getopt[1]);
+			break;
+		case OE::FREQ_RANGES:
+			g.ranges = values(getopt[1]);
+			break;
+		case OE::FILE_LOAD:
+			g.recordings.push_back(getopt[0]);
+			break;
+		case OE::OPT_UNKNOWN:
+		case OE::OPT_DASH:
+		case OE::OPT_LDASH:
+			fail(Exit::ECLARG, 0,
+			     "unexpected command line argument: "s + getopt[0]);
+		case OE::OPT_DONE:
+			if (g.recordings.empty()) {
+				fail(Exit::ECLARG, 0, "no load recordings given");
+			}
+			return;
+		}
+	} catch (Exception & e) {
+		switch (getopt) {
+		case OE::USAGE:
+			break;
+		case OE::FLAG_VERBOSE:
+		case OE::FILE_LOAD:
+		case OE::OPT_UNKNOWN:
+		case OE::OPT_DASH:
+		case OE::OPT_LDASH:
+			e.msg += "\n\n";
+			e.msg += getopt.show(0);
+			break;
+		case OE::CNT_JOBS:
+		case OE::CMD_DAEMON:
+		case OE::MODES:
+		case OE::IVALS_POLL:
+		case OE::CNTS_SAMPLES:
+		case OE::FREQ_RANGES:
+			e.msg += "\n\n";
+			e.msg += getopt.show(1);
+			break;
+		case OE::OPT_DONE:
+			break;
+		}
+		throw;
+	}
+}
+
+/**
+ * Locate the loadplay and powerd++ commands.
+ *
+ * If running from an explicit path, the commands are taken from the
+ * same path. This facilitates calling `powerd++-tune` directly from
+ * the build directory.
+ *
+ * @param argv0
+ *	The command powerd++-tune was called through
+ */
+void init(char const * const argv0) {
+	auto const sep = std::strrchr(argv0, '/');
+	if (sep) {
+		g.prefix.assign(argv0, sep + 1);
+	}
+	if (g.daemon.empty()) {
+		g.daemon = g.prefix + "powerd++";
+	}
+}
+
+/**
+ * A daemon configuration and its performance over the corpus.
+ */
+struct Config {
+	/**
+	 * The daemon command line arguments.
+	 */
+	Values args;
+
+	/**
+	 * The number of successful replays.
+	 */
+	size_t replays{0};
+
+	/**
+	 * The sum of the mean clock frequencies of all cores in [MHz],
+	 * the fallback energy proxy.
+	 */
+	double freq{0};
+
+	/**
+	 * The estimated energy consumed by all cores in [J].
+	 */
+	double energy{0};
+
+	/**
+	 * The number of replays of recordings providing power values.
+	 */
+	size_t powered{0};
+
+	/**
+	 * The mean time to process the work backlog in [ms], the
+	 * latency proxy.
+	 */
+	double backlog{0};
+
+	/**
+	 * Set if no other configuration is better in both objectives.
+	 */
+	bool pareto{false};
+};
+
+/**
+ * Create the parameter matrix.
+ *
+ * @return
+ *	One configuration for each combination of parameters
+ */
+std::vector<Config> configs() {
+	std::vector<Config> result;
+	for (auto const & mode : g.modes) {
+		for (auto const & poll : g.polls) {
+			for (auto const & samples : g.samples) {
+				for (auto const & range : g.ranges) {
+					Config cfg{{"-a", mode, "-b", mode, "-n", mode,
+					            "-p", poll, "-s", samples}};
+					if (!range.empty()) {
+						cfg.args.push_back("-F");
+						cfg.args.push_back(range);
+					}
+					result.push_back(std::move(cfg));
+				}
+			}
+		}
+	}
+	return result;
+}
+
+/**
+ * Start a command in the background.
+ *
+ * The standard output of the command is discarded, the standard
+ * error output is written to a file.
+ *
+ * @param args
+ *	The command line
+ * @param errfile
+ *	The file to write the error output to
+ * @return
+ *	The process ID of the command
+ */
+pid_t spawn(Values const & args, std::string const & errfile) {
+	std::vector<char *> argv;
+	for (auto const & arg : args) {
+		argv.push_back(const_cast<char *>(arg.c_str()));
+	}
+	argv.push_back(nullptr);
+
+	io::ferr.flush();
+	auto const pid = fork();
+	if (pid == -1) {
+		fail(Exit::EEXEC, errno, "failed to fork: "s + strerror(errno));
+	}
+	if (!pid) {
+		auto const devnull = open("/dev/null", O_WRONLY);
+		auto const err = open(errfile.c_str(),
+		                      O_WRONLY | O_CREAT | O_TRUNC, 0600);
+		if (devnull == -1 || dup2(devnull, 1) == -1 ||
+		    err == -1 || dup2(err, 2) == -1) {
+			_exit(to_value(Exit::EEXEC));
+		}
+		execvp(argv[0], argv.data());
+		io::ferr.printf("powerd++-tune: failed to execute %s: %s\n",
+		                argv[0], strerror(errno));
+		_exit(to_value(Exit::EEXEC));
+	}
+	return pid;
+}
+
+/**
+ * Add the performance of a single replay to its configuration.
+ *
+ * The energy objective is the total run energy estimated by
+ * loadplay. It is only available if the recording provides power
+ * values for its clock frequency levels, i.e. if the recorded energy
+ * is non-zero, the sum of the mean clock frequencies is collected
+ * as a fallback.
+ *
+ * The latency proxy is the backlog delay reported by loadplay, i.e.
+ * the time it takes to process the cycles the emulator carries over
+ * to the next frame at the current clock frequency.
+ *
+ * @param cfg
+ *	The configuration to update
+ * @param filename
+ *	The loadplay output of the replay
+ * @retval true
+ *	The replay output was evaluated
+ * @retval false
+ *	The replay output is missing or incomplete
+ */
+bool evaluate(Config & cfg, char const * const filename) {
+	io::file<io::own, io::read> fin{filename, "rb"};
+	if (!fin) {
+		return false;
+	}
+
+	/* locate the columns of each core */
+	char inbuf[16384];
+	if (!fin.gets(inbuf)) {
+		return false;
+	}
+	struct Core {
+		size_t runFreq, runDelay;
+	};
+	std::vector<Core> cores;
+	size_t columns = 0, recEnergy = 0, runEnergy = 0;
+	for (auto it = inbuf; *it && *it != '\n'; ++columns) {
+		auto const len = std::strcspn(it, " \n");
+		auto const suffix = std::string{it, len};
+		auto const dot = suffix.find('.', 4);
+		if (suffix == "rec.energy[J]") {
+			recEnergy = columns;
+		} else if (suffix == "run.energy[J]") {
+			runEnergy = columns;
+		} else if (suffix.compare(0, 4, "cpu.") == 0 && dot != std::string::npos) {
+			auto const field = suffix.substr(dot);
+			if (field == ".run.freq[MHz]") {
+				cores.push_back({columns, 0});
+			} else if (field == ".run.delay[ms]" && !cores.empty()) {
+				cores.back().runDelay = columns;
+			}
+		}
+		it += len + (it[len] == ' ');
+	}
+	if (cores.empty() || !cores.back().runDelay ||
+	    !recEnergy || !runEnergy) {
+		return false;
+	}
+
+	/* integrate over the frames */
+	std::vector<double> row(columns);
+	double time{0}, freq{0}, backlog{0};
+	while (fin.gets(inbuf)) {
+		char * it = inbuf;
+		for (auto & value : row) {
+			char * end{nullptr};
+			value = strtod(it, &end);
+			if (end == it) {
+				return false;
+			}
+			it = end;
+		}
+		auto const dt = row[0] - time;
+		time = row[0];
+		for (auto const & core : cores) {
+			freq += row[core.runFreq] * dt;
+			backlog += row[core.runDelay] * dt;
+		}
+	}
+	if (time <= 0) {
+		return false;
+	}
+
+	/* the energy columns hold the totals since the start */
+	if (row[recEnergy] > 0) {
+		cfg.energy += row[runEnergy];
+		++cfg.powered;
+	}
+	cfg.freq += freq / time;
+	cfg.backlog += backlog / time / cores.size();
+	++cfg.replays;
+	return true;
+}
+
+/**
+ * Replay the corpus with every configuration.
+ *
+ * Each replay runs loadplay in time warp mode, so the results are
+ * reproducible.
+ *
+ * @param cfgs
+ *	The configurations to evaluate
+ */
+void sweep(std::vector<Config> & cfgs) {
+	auto & env = sys::env::vars;
+	std::string tmpdir = (env["TMPDIR"] ? env["TMPDIR"].c_str() : "/tmp");
+	tmpdir += "/powerd++-tune.XXXXXX";
+	if (!mkdtemp(&tmpdir[0])) {
+		fail(Exit::EWOPEN, errno,
+		     "could not create temporary directory: "s + tmpdir);
+	}
+
+	/* a replay of a recording with a configuration */
+	struct Job {
+		pid_t pid;
+		char const * recording;
+		Config * cfg;
+		std::string outfile;
+		std::string errfile;
+	};
+	std::vector<Job> running;
+
+	/* wait for a replay to complete and evaluate it */
+	auto const wait = [&running]() {
+		int status{0};
+		auto const pid = waitpid(-1, &status, 0);
+		if (pid == -1) {
+			fail(Exit::EEXEC, errno,
+			     "failed to wait for replay: "s + strerror(errno));
+		}
+		auto const job = std::find_if(running.begin(), running.end(),
+		                              [pid](Job const & job) {
+			return job.pid == pid;
+		});
+		if (job == running.end()) {
+			return;
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status) ||
+		    !evaluate(*job->cfg, job->outfile.c_str())) {
+			io::ferr.printf("powerd++-tune: replay of %s failed:",
+			                job->recording);
+			for (auto const & arg : job->cfg->args) {
+				io::ferr.printf(" %s", arg.c_str());
+			}
+			io::ferr.putc('\n');
+
+			/* forward the error output of the replay */
+			io::file<io::own, io::read> errs{job->errfile.c_str(), "rb"};
+			char buf[4096];
+			for (size_t count; errs && (count = errs.read(buf, sizeof(buf)));) {
+				io::ferr.write(buf, count);
+			}
+		}
+		unlink(job->outfile.c_str());
+		unlink(job->errfile.c_str());
+		running.erase(job);
+	};
+
+	try {
+		size_t replay = 0;
+		for (auto const recording : g.recordings) {
+			for (auto & cfg : cfgs) {
+				while (running.size() >= g.jobs) {
+					wait();
+				}
+				auto const file = tmpdir + "/play." + std::to_string(replay++);
+				Values args{g.prefix + "loadplay", "-t", "-i", recording,
+				            "-o", file, g.daemon, "-f"};
+				args.insert(args.end(), cfg.args.begin(), cfg.args.end());
+				running.push_back({spawn(args, file + ".err"), recording,
+				                   &cfg, file, file + ".err"});
+			}
+		}
+		while (!running.empty()) {
+			wait();
+		}
+	} catch (Exception &) {
+		for (auto const & job : running) {
+			waitpid(job.pid, nullptr, 0);
+			unlink(job.outfile.c_str());
+			unlink(job.errfile.c_str());
+		}
+		rmdir(tmpdir.c_str());
+		throw;
+	}
+	rmdir(tmpdir.c_str());
+}
+
+/**
+ * Determine the Pareto front of the configurations.
+ *
+ * Only configurations that were successfully replayed with every
+ * recording are considered. The configurations are sorted by
+ * the energy estimate, if every recording provides power values,
+ * or by the clock frequency proxy otherwise.
+ *
+ * @param cfgs
+ *	The configurations to sort and mark
+ */
+void pareto(std::vector<Config> & cfgs) {
+	auto const replays = g.recordings.size();
+	cfgs.erase(std::remove_if(cfgs.begin(), cfgs.end(),
+	                          [replays](Config const & cfg) {
+		return cfg.replays != replays;
+	}), cfgs.end());
+	g.energy = !cfgs.empty();
+	for (auto & cfg : cfgs) {
+		cfg.freq /= replays;
+		cfg.energy /= replays;
+		cfg.backlog /= replays;
+		g.energy &= cfg.powered == replays;
+	}
+	auto const cost = [](Config const & cfg) {
+		return g.energy ? cfg.energy : cfg.freq;
+	};
+	std::sort(cfgs.begin(), cfgs.end(),
+	          [cost](Config const & lhs, Config const & rhs) {
+		return cost(lhs) < cost(rhs) ||
+		       (cost(lhs) == cost(rhs) && lhs.backlog < rhs.backlog);
+	});
+	auto best = std::numeric_limits<double>::infinity();
+	for (auto & cfg : cfgs) {
+		cfg.pareto = cfg.backlog < best;
+		best = std::min(best, cfg.backlog);
+	}
+}
+
+/**
+ * Print the Pareto front.
+ *
+ * In verbose mode all configurations are printed and the Pareto
+ * front is marked with an asterisk.
+ *
+ * @param cfgs
+ *	The evaluated configurations
+ */
+void print(std::vector<Config> const & cfgs) {
+	io::fout.printf("%s%12.12s  %12.12s  %s\n", g.verbose ? "  " : "",
+	                g.energy ? "energy[J]" : "freq[MHz]",
+	                "backlog[ms]", "parameters");
+	for (auto const & cfg : cfgs) {
+		if (!cfg.pareto && !g.verbose) {
+			continue;
+		}
+		if (g.verbose) {
+			io::fout.print(cfg.pareto ? "* " : "  ");
+		}
+		if (g.energy) {
+			io::fout.printf("%12.3f  %12.3f ", cfg.energy, cfg.backlog);
+		} else {
+			io::fout.printf("%12.1f  %12.3f ", cfg.freq, cfg.backlog);
+		}
+		for (auto const & arg : cfg.args) {
+			io::fout.printf(" %s", arg.c_str());
+		}
+		io::fout.putc('\n');
+	}
+}
+
+} /* namespace */
+
+/**
+ * Main routine, search the parameter space, print errors.
+ *
+ * @param argc,argv
+ *	The command line arguments
+ * @return
+ *	An exit code
+ * @see Exit
+ */
+int main(int argc, char * argv[]) try {
+	read_args(argc, argv);
+	init(argv[0]);
+	auto cfgs = configs();
+	sweep(cfgs);
+	pareto(cfgs);
+	print(cfgs);
+	return to_value(Exit::OK);
+} catch (Exception & e) {
+	if (e.msg != "") {
+		io::ferr.printf("powerd++-tune: %s\n", e.msg.c_str());
+	}
+	return to_value(e.exitcode);
+} catch (...) {
+	io::ferr.print("powerd++-tune: untreated failure\n");
+	return to_value(Exit::EEXCEPT);
+}
@@ -5,28 +5,40 @@
  */
 
 #include "Options.hpp"
-#include "Cycle.hpp"
 
 #include "types.hpp"
 #include "constants.hpp"
 #include "errors.hpp"
 #include "clas.hpp"
 #include "utility.hpp"
+#include "stats.hpp"
+
+#include "platform.hpp"
 
-#include "sys/sysctl.hpp"
 #include "sys/pidfile.hpp"
 #include "sys/signal.hpp"
+#include "sys/shm.hpp"
 #include "sys/io.hpp"
 
 #include <locale>    /* std::tolower() */
 #include <memory>    /* std::unique_ptr */
 #include <algorithm> /* std::min(), std::max() */
 #include <limits>    /* std::numeric_limits */
+#include <vector>    /* std::vector */
+#include <thread>    /* std::thread */
+#include <mutex>     /* std::mutex */
+#include <condition_variable> /* std::condition_variable */
+#include <exception> /* std::exception_ptr */
+#include <optional>  /* std::optional */
+#include <new>       /* placement new */
 
 #include <cstdlib>   /* strtol() */
+#include <cstring>   /* std::strchr(), std::strncmp(), std::strerror() */
 #include <cstdint>   /* uint64_t */
+#include <cctype>    /* std::isspace() */
 
-#include <sys/resource.h>  /* CPUSTATES */
+#include <csignal>         /* sigfillset(), pthread_sigmask() */
+#include <unistd.h>        /* getpid() */
 
 /**
  * File local scope.
@@ -40,7 +52,9 @@ using types::cptime_t;
 using types::mhz_t;
 using types::coreid_t;
 using types::ms;
+using types::us;
 using types::decikelvin_t;
+using types::epp_t;
 
 using errors::Exit;
 using errors::Exception;
@@ -50,11 +64,13 @@ using clas::load;
 using clas::freq;
 using clas::ival;
 using clas::samples;
+using clas::threads;
 using clas::temperature;
+using clas::gain;
+using clas::epp;
 using clas::celsius;
 using clas::range;
 using clas::formatfields;
-using clas::sysctlname;
 
 using utility::countof;
 using utility::sprintf_safe;
@@ -64,27 +80,30 @@ using utility::Min;
 using utility::Max;
 using utility::sanitise;
 
-using constants::CP_TIMES;
-using constants::ACLINE;
-using constants::FREQ;
-using constants::FREQ_LEVELS;
-using constants::FREQ_DRIVER;
-using constants::FREQ_DRIVER_BLACKLIST;
-using constants::TEMPERATURE;
-using constants::TJMAX_SOURCES;
+using platform::TOPOLOGY;
+using platform::ACLINE;
+using platform::FREQ;
+using platform::FREQ_LEVELS;
+using platform::FREQ_DRIVER;
+using platform::FREQ_DRIVER_BLACKLIST;
+using platform::TEMPERATURE;
 
 using constants::FREQ_DEFAULT_MAX;
 using constants::FREQ_DEFAULT_MIN;
 using constants::FREQ_UNSET;
+using constants::GAIN_UNSET;
+using constants::EPP_DEFAULT_MIN;
+using constants::EPP_DEFAULT_MAX;
+using constants::EPP_UNSET;
 using constants::POWERD_PIDFILE;
 using constants::ADP;
 using constants::HADP;
 using constants::HITEMP_OFFSET;
+using constants::POLL_SHRINK_LOAD;
+using constants::POLL_STRETCH_LOAD;
+using constants::EFFICIENCY_FREQ;
 
-using sys::ctl::Sysctl;
-using sys::ctl::Once;
-using sys::ctl::SysctlSync;
-using sys::ctl::SysctlOnce;
+using stats::Profile;
 
 namespace io = sys::io;
 
@@ -100,21 +119,81 @@ enum class AcLineState : unsigned int {
 	LENGTH   /**< Enum length */
 };
 
+/**
+ * The available load filters.
+ */
+enum class Filter : unsigned int {
+	MEAN,       /**< Time weighted moving average */
+	EWMA,       /**< Exponentially weighted moving average */
+	MAX,        /**< Moving maximum */
+	PERCENTILE, /**< Moving percentile */
+	HOLT,       /**< Double exponential smoothing with trend projection */
+	LENGTH      /**< Enum length */
+};
+
+/**
+ * Printable strings for load filters.
+ */
+char const * const FilterStr[]{"mean", "ewma", "max", "percentile", "holt"};
+
+static_assert(countof(FilterStr) == to_value(Filter::LENGTH),
+              "Every Filter must have a string representation");
+
+/**
+ * The available core classes.
+ */
+enum class CoreClass : unsigned int {
+	PERFORMANCE, /**< Cores with the highest maximum clock frequency */
+	EFFICIENCY,  /**< Cores with a lower maximum clock frequency */
+	LENGTH       /**< Enum length */
+};
+
 /**
  * Contains the management information for a group of cores with
  * a common clock frequency.
  */
 struct CoreGroup {
 	/**
-	 * The sysctl dev.cpu.%d.freq.
+	 * The clock frequency handle, e.g. dev.cpu.%d.freq.
+	 */
+	platform::Freq freq{};
+
+	/**
+	 * The energy/performance preference handle of hardware P-state
+	 * drivers, e.g. dev.hwpstate_intel.%d.epp.
+	 *
+	 * Only available if eppctl is set.
+	 */
+	platform::Epp epp{};
+
+	/**
+	 * Set if the group is controlled through the energy/performance
+	 * preference instead of the clock frequency.
+	 */
+	bool eppctl{false};
+
+	/**
+	 * The last energy/performance preference set.
+	 *
+	 * This is updated by update_freq().
 	 */
-	SysctlSync<mhz_t> freq{{}};
+	epp_t eppval{0};
 
 	/**
 	 * The number of the core owning dev.cpu.%d.freq.
 	 */
 	coreid_t corei{0};
 
+	/**
+	 * The index of the first core of the group in Global::members.
+	 */
+	coreid_t membersi{0};
+
+	/**
+	 * The number of cores in the group.
+	 */
+	coreid_t coren{0};
+
 	/**
 	 * The dev.cpu.%d.freq value for the current load sample.
 	 *
@@ -122,6 +201,13 @@ struct CoreGroup {
 	 */
 	mhz_t sample_freq{0};
 
+	/**
+	 * The wanted clock frequency before clamping and throttling.
+	 *
+	 * This is updated by update_freq().
+	 */
+	mhz_t wanted{0};
+
 	/**
 	 * The minimum group clock rate.
 	 *
@@ -136,6 +222,36 @@ struct CoreGroup {
 	 */
 	Min<mhz_t> max{FREQ_DEFAULT_MAX};
 
+	/**
+	 * The core class of the group.
+	 */
+	CoreClass cls{CoreClass::PERFORMANCE};
+
+	/**
+	 * The available clock frequencies from dev.cpu.%d.freq_levels.
+	 *
+	 * The frequencies are in ascending order.
+	 */
+	std::vector<mhz_t> levels;
+
+	/**
+	 * The time since the last frequency update.
+	 *
+	 * This is updated by update_freq().
+	 */
+	ms dwelt{0};
+
+	/**
+	 * The number of frequency updates.
+	 */
+	unsigned long writes{0};
+
+	/**
+	 * The number of frequency updates suppressed by the hysteresis,
+	 * dwell time or frequency level snapping.
+	 */
+	unsigned long suppressed{0};
+
 	/**
 	 * The maximum load reported by all cores in the group.
 	 *
@@ -143,22 +259,64 @@ struct CoreGroup {
 	 */
 	Max<mhz_t> load{0};
 
+	/**
+	 * The filtered load, the clock frequency is selected for this load.
+	 *
+	 * This is updated by update_filter().
+	 */
+	mhz_t filtered{0};
+
 	/**
 	 * A ring buffer of maximum load samples for this core group.
 	 *
 	 * Each maximum load sample is weighted with the core frequency at
 	 * which it was taken.
 	 *
-	 * This is updated by update_loads().
+	 * This is not allocated for the Filter::EWMA and Filter::HOLT
+	 * filters.
+	 *
+	 * This is updated by update_filter().
 	 */
 	std::unique_ptr<mhz_t[]> loads;
 
 	/**
-	 * The maximum load sum of all controlled cores.
+	 * The time weighted maximum load sum of all controlled cores.
 	 *
-	 * This is updated by update_loads().
+	 * Each sample is weighted with the time it covers in ms, see
+	 * Global::weights.
+	 *
+	 * This is updated by update_filter<Filter::MEAN>().
+	 */
+	ms::rep loadsum{0};
+
+	/**
+	 * The exponentially weighted moving average load in 1/1024 MHz.
+	 *
+	 * This is updated by update_filter<Filter::EWMA>() and
+	 * update_filter<Filter::HOLT>(), which uses it as the load level.
+	 */
+	ms::rep ewma{0};
+
+	/**
+	 * The load trend in 1/1024 MHz per ms.
+	 *
+	 * This is updated by update_filter<Filter::HOLT>().
+	 */
+	ms::rep trend{0};
+
+	/**
+	 * The mean absolute load prediction error in 1/1024 MHz.
+	 *
+	 * This is updated by update_filter<Filter::HOLT>().
+	 */
+	ms::rep error{0};
+
+	/**
+	 * The integral term of the PI controller in 1/1024 MHz.
+	 *
+	 * This is updated by pi_freq().
 	 */
-	mhz_t loadsum{0};
+	ms::rep integral{0};
 
 	/**
 	 * Critical core temperature in dK.
@@ -174,6 +332,11 @@ struct CoreGroup {
 	 * The maximum temperature measurement taken in the group.
 	 */
 	Max<decikelvin_t> temp{0};
+
+	/**
+	 * The temperature sensor representing the group.
+	 */
+	coreid_t sensori{0};
 };
 
 /**
@@ -181,29 +344,82 @@ struct CoreGroup {
  */
 struct Core {
 	/**
-	 * A pointer to the kern.cp_times section for this core.
+	 * The core that controls the frequency for this core.
+	 */
+	CoreGroup * group{nullptr};
+
+	/**
+	 * The temperature handle, e.g. dev.cpu.%d.temperature, if present.
 	 */
-	cptime_t const * cp_time;
+	platform::Temp temp{};
+};
 
+/**
+ * A temperature sensor shared by the core groups of a package.
+ */
+struct Sensor {
 	/**
-	 * The core that controls the frequency for this core.
+	 * The core representing the package.
 	 */
-	CoreGroup * group{nullptr};
+	coreid_t core{0};
+
+	/**
+	 * The last temperature measurement in dK.
+	 */
+	decikelvin_t temp{0};
+};
+
+/**
+ * A contiguous range of core groups updated by a single thread.
+ *
+ * Shards are aligned to cache lines, so threads updating different
+ * shards do not write to a common cache line.
+ */
+struct alignas(64) Shard {
+	/**
+	 * The first core group of the shard.
+	 */
+	coreid_t first{0};
+
+	/**
+	 * The end of the core group range.
+	 */
+	coreid_t last{0};
+
+	/**
+	 * The greatest load change of a core group in the shard.
+	 *
+	 * This is updated by update_filter().
+	 */
+	Max<cptime_t> change{0};
+
+	/**
+	 * The number of sysctl reads during the last update.
+	 */
+	unsigned long reads{0};
 
 	/**
-	 * The idle ticks count.
+	 * The number of sysctl writes during the last update.
 	 */
-	cptime_t idle{0};
+	unsigned long writes{0};
 
 	/**
-	 * Count of all ticks.
+	 * The time spent in update_loads() during the last update.
 	 */
-	cptime_t all{0};
+	us loadtime{0};
 
 	/**
-	 * The dev.cpu.%d.temperature sysctl, if present.
+	 * The time spent in update_freq() during the last update.
+	 */
+	us updatetime{0};
+
+	/**
+	 * A buffer of loads for the Filter::PERCENTILE filter.
+	 *
+	 * Provides room for the largest number of load samples of all
+	 * core classes.
 	 */
-	SysctlSync<decikelvin_t> temp{{}};
+	std::unique_ptr<mhz_t[]> scratch;
 };
 
 /**
@@ -217,6 +433,28 @@ struct Global {
 	 */
 	volatile sig_atomic_t signal{0};
 
+	/**
+	 * Set when a configuration reload was requested.
+	 */
+	volatile sig_atomic_t reload{0};
+
+	/**
+	 * The number of command line arguments.
+	 */
+	int argc{0};
+
+	/**
+	 * The command line arguments, kept for reloading the configuration.
+	 */
+	char const * const * argv{nullptr};
+
+	/**
+	 * Name of the configuration file.
+	 *
+	 * If set the configuration is reloaded on SIGHUP.
+	 */
+	char const * configfile{nullptr};
+
 	/**
 	 * The number of load samples to take.
 	 */
@@ -224,18 +462,57 @@ struct Global {
 
 	/**
 	 * The polling interval.
+	 *
+	 * This is updated by update_interval() in adaptive polling mode.
 	 */
 	ms interval{500};
 
 	/**
-	 * The current sample.
+	 * The minimum adaptive polling interval.
+	 *
+	 * Adaptive polling is active if this is less than interval_max.
+	 */
+	ms interval_min{0};
+
+	/**
+	 * The maximum adaptive polling interval.
+	 */
+	ms interval_max{0};
+
+	/**
+	 * The load filter.
+	 */
+	Filter filter{Filter::MEAN};
+
+	/**
+	 * The percentile selected by the Filter::PERCENTILE filter.
+	 */
+	unsigned int percentile{50};
+
+	/**
+	 * The hysteresis band [0, 1024].
+	 *
+	 * Frequency changes smaller than this fraction of the current
+	 * clock frequency are suppressed.
+	 */
+	cptime_t hysteresis{0};
+
+	/**
+	 * The minimum time between frequency updates of a core group.
+	 */
+	ms dwell{0};
+
+	/**
+	 * Snap target frequencies to the available frequency levels.
 	 */
-	size_t sample{0};
+	bool snap{false};
 
 	/**
 	 * The number of CPU cores or threads.
+	 *
+	 * This is set by init().
 	 */
-	SysctlOnce<coreid_t, 2> const ncpu{1, {CTL_HW, HW_NCPU}};
+	coreid_t ncpu{0};
 
 	/**
 	 * Per AC line state settings.
@@ -264,6 +541,28 @@ struct Global {
 		 */
 		mhz_t target_freq;
 
+		/**
+		 * The proportional gain of the PI controller in 1/1024.
+		 */
+		unsigned int kp;
+
+		/**
+		 * The integral gain of the PI controller in 1/1024 per second.
+		 *
+		 * The PI controller is only used if this is not 0.
+		 */
+		unsigned int ki;
+
+		/**
+		 * Energy/performance preference at the highest frequency.
+		 */
+		epp_t epp_min;
+
+		/**
+		 * Energy/performance preference at the lowest frequency.
+		 */
+		epp_t epp_max;
+
 		/**
 		 * The string representation of this state.
 		 */
@@ -274,15 +573,82 @@ struct Global {
 	 * The power states.
 	 */
 	ACSet acstates[3]{
-		{FREQ_UNSET,       FREQ_UNSET,       ADP,  0, "battery"},
-		{FREQ_UNSET,       FREQ_UNSET,       HADP, 0, "online"},
-		{FREQ_DEFAULT_MIN, FREQ_DEFAULT_MAX, HADP, 0, "unknown"}
+		{FREQ_UNSET,       FREQ_UNSET,       ADP,  0, GAIN_UNSET, GAIN_UNSET, EPP_UNSET,       EPP_UNSET,       "battery"},
+		{FREQ_UNSET,       FREQ_UNSET,       HADP, 0, GAIN_UNSET, GAIN_UNSET, EPP_UNSET,       EPP_UNSET,       "online"},
+		{FREQ_DEFAULT_MIN, FREQ_DEFAULT_MAX, HADP, 0, 1024,       0,          EPP_DEFAULT_MIN, EPP_DEFAULT_MAX, "unknown"}
+	};
+
+	/**
+	 * Per core class settings and load sample windows.
+	 */
+	struct ClassSet {
+		/**
+		 * Lowest frequency to set in MHz.
+		 */
+		mhz_t freq_min;
+
+		/**
+		 * Highest frequency to set in MHz.
+		 */
+		mhz_t freq_max;
+
+		/**
+		 * Target load times [0, 1024].
+		 *
+		 * The value 0 indicates the target of the AC line state
+		 * should be used.
+		 */
+		cptime_t target_load;
+
+		/**
+		 * The number of load samples, 0 indicates g.samples
+		 * should be used.
+		 */
+		size_t samples;
+
+		/**
+		 * A ring buffer of the time covered by each load sample in ms.
+		 *
+		 * This is updated by update_filter().
+		 */
+		std::unique_ptr<ms::rep[]> weights;
+
+		/**
+		 * The sum of all weights.
+		 */
+		ms::rep weightsum;
+
+		/**
+		 * The sum of all weights after the current sample
+		 * replaces the oldest one.
+		 *
+		 * This is updated by prepare_filter().
+		 */
+		ms::rep nextsum;
+
+		/**
+		 * The current sample.
+		 */
+		size_t sample;
+
+		/**
+		 * The string representation of this class.
+		 */
+		char const * const name;
 	};
 
 	/**
-	 * The hw.acpi.acline ctl.
+	 * The core classes.
 	 */
-	Sysctl<0> acline_ctl;
+	ClassSet classes[2]{
+		{FREQ_DEFAULT_MIN, FREQ_DEFAULT_MAX, 0, 0, nullptr, 0, 0, 0, "performance"},
+		{FREQ_DEFAULT_MIN, FREQ_DEFAULT_MAX, 0, 0, nullptr, 0, 0, 0, "efficiency"}
+	};
+
+	/**
+	 * The AC line state handle, e.g. hw.acpi.acline.
+	 */
+	platform::AcLine acline;
 
 	/**
 	 * Verbose mode.
@@ -295,9 +661,11 @@ struct Global {
 	bool foreground{false};
 
 	/**
-	 * The list of states considered idle.
+	 * The mask of states considered idle.
+	 *
+	 * Idle states have all bits set, all other states are 0.
 	 */
-	bool idleStates[CPUSTATES]{};
+	cptime_t idleMask[CPUSTATES]{};
 
 	/**
 	 * Temperature throttling mode.
@@ -314,6 +682,26 @@ struct Global {
 	 */
 	decikelvin_t temp_high{0};
 
+	/**
+	 * The temperature sampling interval.
+	 */
+	ms temp_interval{1000};
+
+	/**
+	 * The time remaining until the next temperature sample.
+	 */
+	ms temp_wait{0};
+
+	/**
+	 * The number of temperature sensors.
+	 */
+	coreid_t nsensors{0};
+
+	/**
+	 * The temperature sensors, one per package.
+	 */
+	std::unique_ptr<Sensor[]> sensors;
+
 	/**
 	 * Name of an alternative pidfile.
 	 *
@@ -322,28 +710,62 @@ struct Global {
 	char const * pidfilename{POWERD_PIDFILE};
 
 	/**
-	 * The kern.cp_times sysctl.
+	 * The per core tick counters handle, e.g. kern.cp_times.
 	 */
-	Sysctl<0> cp_times_ctl;
+	platform::Times times;
 
 	/**
-	 * The sysctl name pattern for the temperature sysctl.
+	 * The name pattern of the temperature source.
 	 *
 	 * May contain a single `%d`.
 	 */
 	char const * tempctl_name{TEMPERATURE};
 
+	/**
+	 * The file system root of the platform, if set.
+	 */
+	char const * rootdir{nullptr};
+
 	/**
 	 * The kern.cp_times buffer for all cores.
 	 */
 	std::unique_ptr<cptime_t[][CPUSTATES]> cp_times;
 
+	/**
+	 * The per core tick state in structure of arrays layout.
+	 *
+	 * Each array holds ncpu values in the order of Global::members,
+	 * so the cores of a core group occupy the contiguous range
+	 * starting at CoreGroup::membersi.
+	 */
+	struct Ticks {
+		/**
+		 * Count of all ticks at the previous sample.
+		 */
+		std::unique_ptr<cptime_t[]> all;
+
+		/**
+		 * The idle ticks count at the previous sample.
+		 */
+		std::unique_ptr<cptime_t[]> idle;
+
+		/**
+		 * Count of all ticks since the previous sample.
+		 */
+		std::unique_ptr<cptime_t[]> dall;
+
+		/**
+		 * The idle ticks count since the previous sample.
+		 */
+		std::unique_ptr<cptime_t[]> didle;
+	} ticks;
+
 	/**
 	 * This buffer is to be allocated with ncpu instances of the
 	 * Core struct to store the management information of every
 	 * core.
 	 */
-	std::unique_ptr<Core[]> cores{new Core[this->ncpu]};
+	std::unique_ptr<Core[]> cores{nullptr};
 
 	/**
 	 * The number of frequency controlling core groups.
@@ -358,107 +780,334 @@ struct Global {
 	std::unique_ptr<CoreGroup[]> groups{nullptr};
 
 	/**
-	 * Perform initialisations that cannot fail/throw.
+	 * The numbers of all cores ordered by core group.
+	 *
+	 * The cores of a group are listed in ascending order, starting
+	 * at CoreGroup::membersi.
 	 */
-	Global() {
-		/* idleStates */
-		for (size_t i = 0; i < CPUSTATES; ++i) {
-			this->idleStates[i] = (i == CP_IDLE);
-		}
-	}
-} g; /**< The gobal state. */
+	std::unique_ptr<coreid_t[]> members{nullptr};
 
-static_assert(countof(g.acstates) == to_value(AcLineState::LENGTH),
-              "There must be a configuration tuple for each state");
+	/**
+	 * Publish statistics in shared memory.
+	 */
+	bool stats{false};
 
-/**
- * Outputs the given printf style message on stderr if g.verbose is set.
- *
- * @tparam MsgTs
- *	The message argument types
- * @param msg
- *	The message to output
- */
-template <typename... MsgTs>
-inline void verbose(MsgTs &&... msg) {
+	/**
+	 * The shared memory statistics region if published.
+	 */
+	stats::Header * shm{nullptr};
+
+	/**
+	 * The number of threads updating core groups.
+	 */
+	coreid_t threads{1};
+
+	/**
+	 * The number of core group shards, one per thread.
+	 */
+	coreid_t nshards{0};
+
+	/**
+	 * This buffer is to be allocated with nshards instances.
+	 */
+	std::unique_ptr<Shard[]> shards{nullptr};
+
+	/**
+	 * The self-profiling histograms, indexed by stats::Profile.
+	 */
+	stats::Histogram profile[to_value(stats::Profile::LENGTH)]{};
+
+	/**
+	 * Perform initialisations that cannot fail/throw.
+	 */
+	Global() {
+		/* idleMask */
+		for (size_t i = 0; i < CPUSTATES; ++i) {
+			this->idleMask[i] = (i == CP_IDLE) ? ~cptime_t{0} : 0;
+		}
+	}
+} g; /**< The gobal state. */
+
+static_assert(countof(g.acstates) == to_value(AcLineState::LENGTH),
+              "There must be a configuration tuple for each state");
+
+static_assert(countof(g.classes) == to_value(CoreClass::LENGTH),
+              "There must be a configuration tuple for each core class");
+
+/**
+ * The settings that can be changed by reloading the configuration.
+ *
+ * The settings are captured from the global state on construction.
+ */
+struct Settings {
+	/**
+	 * The reconfigurable part of Global::ACSet.
+	 */
+	struct ACSet {
+		mhz_t freq_min;       /**< Lowest frequency to set in MHz */
+		mhz_t freq_max;       /**< Highest frequency to set in MHz */
+		cptime_t target_load; /**< Target load times [0, 1024] */
+		mhz_t target_freq;    /**< Fixed clock frequency */
+		unsigned int kp;      /**< PI controller proportional gain */
+		unsigned int ki;      /**< PI controller integral gain */
+		epp_t epp_min;        /**< Preference at the highest frequency */
+		epp_t epp_max;        /**< Preference at the lowest frequency */
+	} acstates[countof(g.acstates)]; /**< The power states */
+
+	/**
+	 * The reconfigurable part of Global::ClassSet.
+	 */
+	struct ClassSet {
+		mhz_t freq_min;       /**< Lowest frequency to set in MHz */
+		mhz_t freq_max;       /**< Highest frequency to set in MHz */
+		cptime_t target_load; /**< Target load times [0, 1024] */
+		size_t samples;       /**< The number of load samples */
+	} classes[countof(g.classes)]; /**< The core classes */
+
+	size_t samples;           /**< The number of load samples */
+	ms interval;              /**< The polling interval */
+	ms interval_min;          /**< The minimum adaptive polling interval */
+	ms interval_max;          /**< The maximum adaptive polling interval */
+	cptime_t hysteresis;      /**< The hysteresis band */
+	ms dwell;                 /**< The minimum time between updates */
+	bool snap;                /**< Snap to the frequency levels */
+	cptime_t nice;            /**< The idle mask of nice time */
+	bool temp_throttling;     /**< Temperature throttling mode */
+	decikelvin_t temp_high;   /**< User set high core temperature */
+	decikelvin_t temp_crit;   /**< User set critical core temperature */
+	ms temp_interval;         /**< The temperature sampling interval */
+
+	/**
+	 * Capture the current settings.
+	 */
+	Settings() :
+	    samples{g.samples}, interval{g.interval},
+	    interval_min{g.interval_min}, interval_max{g.interval_max},
+	    hysteresis{g.hysteresis}, dwell{g.dwell}, snap{g.snap},
+	    nice{g.idleMask[CP_NICE]}, temp_throttling{g.temp_throttling},
+	    temp_high{g.temp_high}, temp_crit{g.temp_crit},
+	    temp_interval{g.temp_interval} {
+		for (size_t i = 0; i < countof(g.acstates); ++i) {
+			auto const & src = g.acstates[i];
+			this->acstates[i] = {src.freq_min, src.freq_max,
+			                     src.target_load, src.target_freq,
+			                     src.kp, src.ki,
+			                     src.epp_min, src.epp_max};
+		}
+		for (size_t i = 0; i < countof(g.classes); ++i) {
+			auto const & src = g.classes[i];
+			this->classes[i] = {src.freq_min, src.freq_max,
+			                    src.target_load, src.samples};
+		}
+	}
+
+	/**
+	 * Write the settings to the global state.
+	 *
+	 * The load sample windows are not resized.
+	 */
+	void apply() const {
+		for (size_t i = 0; i < countof(g.acstates); ++i) {
+			auto const & src = this->acstates[i];
+			auto & dst = g.acstates[i];
+			dst.freq_min    = src.freq_min;
+			dst.freq_max    = src.freq_max;
+			dst.target_load = src.target_load;
+			dst.target_freq = src.target_freq;
+			dst.kp          = src.kp;
+			dst.ki          = src.ki;
+			dst.epp_min     = src.epp_min;
+			dst.epp_max     = src.epp_max;
+		}
+		for (size_t i = 0; i < countof(g.classes); ++i) {
+			auto const & src = this->classes[i];
+			auto & dst = g.classes[i];
+			dst.freq_min    = src.freq_min;
+			dst.freq_max    = src.freq_max;
+			dst.target_load = src.target_load;
+			dst.samples     = src.samples;
+		}
+		g.samples            = this->samples;
+		g.interval           = this->interval;
+		g.interval_min       = this->interval_min;
+		g.interval_max       = this->interval_max;
+		g.hysteresis         = this->hysteresis;
+		g.dwell              = this->dwell;
+		g.snap               = this->snap;
+		g.idleMask[CP_NICE]  = this->nice;
+		g.temp_throttling    = this->temp_throttling;
+		g.temp_high          = this->temp_high;
+		g.temp_crit          = this->temp_crit;
+		g.temp_interval      = this->temp_interval;
+	}
+};
+
+/**
+ * The default settings.
+ *
+ * Captured during static initialisation, i.e. before read_args()
+ * modifies the global state.
+ */
+Settings const defaults{};
+
+/**
+ * Outputs the given printf style message on stderr if g.verbose is set.
+ *
+ * @tparam MsgTs
+ *	The message argument types
+ * @param msg
+ *	The message to output
+ */
+template <typename... MsgTs>
+inline void verbose(MsgTs &&... msg) {
 	if (g.verbose) {
 		io::ferr.print("powerd++: ").printf(std::forward<MsgTs>(msg)...);
 	}
 }
 
 /**
- * Treat sysctl errors.
+ * Treat platform access errors.
  *
  * Fails appropriately for the given error.
  *
  * @param err
- *	The errno value after calling sysctl
+ *	The errno value after accessing the platform
  */
 [[noreturn]] inline
-void sysctl_fail(sys::sc_error<sys::ctl::error> const err) {
-	fail(Exit::ESYSCTL, err, "sysctl failed: "s + err.c_str());
+void platform_fail(sys::sc_error<platform::error> const err) {
+	fail(Exit::ESYSCTL, err, "%s failed: %s"_fmt(platform::SOURCE, err.c_str()));
 }
 
 /**
- * Perform initial tasks.
+ * The CPU topology as reported by kern.sched.topology_spec.
  *
- * - Get number of CPU cores/threads
- * - Determine the clock controlling core for each core
- * - Set the MIBs of hw.acpi.acline and kern.cp_times
+ * The topology is a tree of nested core groups, e.g. the SMT threads
+ * of a core, the cores sharing a cache and the cores of a package.
  */
-void init() {
-	/* get AC line state MIB */
-	try {
-		g.acline_ctl = {ACLINE};
-	} catch (sys::sc_error<sys::ctl::error>) {
-		verbose("cannot read %s\n", ACLINE);
-	}
+struct Topology {
+	/**
+	 * A group of cores in the topology.
+	 */
+	struct Group {
+		/**
+		 * Set for every member core.
+		 */
+		std::vector<bool> cores;
 
-	/*
-	 * Count the number of controlling cores and set up the core
-	 * group buffer.
+		/**
+		 * Set if the members are the SMT threads of a core.
+		 */
+		bool smt;
+	};
+
+	/**
+	 * All groups in the topology, empty if it is not known.
 	 */
-	for (coreid_t core = 0; core < g.ncpu; ++core) {
-		/* get the frequency handler */
-		char name[40];
-		sprintf_safe(name, FREQ, core);
+	std::vector<Group> groups;
+
+	/**
+	 * Read the topology from the platform, e.g.
+	 * kern.sched.topology_spec.
+	 *
+	 * If the topology cannot be read or parsed the topology is
+	 * left empty.
+	 *
+	 * @param ncpu
+	 *	The number of cores
+	 */
+	Topology(coreid_t const ncpu) {
 		try {
-			Sysctl{name};
-			++g.ngroups;
-		} catch (sys::sc_error<sys::ctl::error> e) {
+			if (!platform::topology(ncpu, this->groups)) {
+				verbose("cannot parse %s: %s\n",
+				        platform::SOURCE, TOPOLOGY);
+			}
+		} catch (sys::sc_error<platform::error>) {
+			verbose("cannot access %s: %s\n", platform::SOURCE, TOPOLOGY);
 		}
 	}
-	g.groups = std::unique_ptr<CoreGroup[]>{new CoreGroup[g.ngroups]{}};
 
-	/*
-	 * Get the frequency controlling core for each core.
-	 * Basically acts as if the kernel supported local frequency changes.
+	/**
+	 * Returns the number of topology groups two cores share.
+	 *
+	 * Because the groups are nested, a greater number indicates
+	 * a closer relationship.
+	 *
+	 * @param lhs,rhs
+	 *	The cores to compare
+	 * @return
+	 *	The number of groups containing both cores
 	 */
-	coreid_t groupi = -1;
-	for (coreid_t core = 0; core < g.ncpu; ++core) {
-		/* get the frequency handler and setup loads buffers */
-		char name[40];
-		sprintf_safe(name, FREQ, core);
-		try {
-			Sysctl const ctl{name};
-			auto & group = g.groups[++groupi];
-			group.freq = {ctl};
-			group.corei = core;
-			/* create loads buffer */
-			group.loads = std::unique_ptr<mhz_t[]>{new mhz_t[g.samples]{}};
-		} catch (sys::sc_error<sys::ctl::error> e) {
-			if (e == ENOENT) {
-				if (0 > groupi) {
-					fail(Exit::ENOFREQ, e, "cannot access "s + name + ", at least the first CPU core must support frequency updates");
-				}
-			} else {
-				verbose("cannot access sysctl: %s\n", name);
-				sysctl_fail(e);
+	coreid_t shared(coreid_t const lhs, coreid_t const rhs) const {
+		coreid_t count{0};
+		for (auto const & group : this->groups) {
+			count += group.cores[lhs] && group.cores[rhs];
+		}
+		return count;
+	}
+
+	/**
+	 * Returns whether two cores are SMT threads of the same core.
+	 *
+	 * @param lhs,rhs
+	 *	The cores to compare
+	 * @return
+	 *	Whether both cores are in a common SMT group
+	 */
+	bool siblings(coreid_t const lhs, coreid_t const rhs) const {
+		for (auto const & group : this->groups) {
+			if (group.smt && group.cores[lhs] && group.cores[rhs]) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Returns the package of a set of cores.
+	 *
+	 * This is the smallest topology group above the SMT level that
+	 * contains more than the given cores, i.e. the cores sharing a
+	 * cache or a package with them.
+	 *
+	 * @param cores
+	 *	The core membership vector
+	 * @return
+	 *	The core membership vector of the package, the given cores
+	 *	if the topology does not provide one
+	 */
+	std::vector<bool> const & package(std::vector<bool> const & cores) const {
+		auto result = &cores;
+		size_t size = 0;
+		for (auto const & group : this->groups) {
+			if (group.smt) { continue; }
+			size_t count{0}, overlap{0};
+			for (size_t i = 0; i < cores.size(); ++i) {
+				count += group.cores[i];
+				overlap += group.cores[i] && cores[i];
+			}
+			auto const members = static_cast<size_t>(
+			    std::count(cores.begin(), cores.end(), true));
+			if (overlap == members && count > members &&
+			    (!size || count < size)) {
+				result = &group.cores;
+				size = count;
 			}
 		}
-		g.cores[core].group = &g.groups[groupi];
+		return *result;
 	}
+};
 
+/**
+ * Resolve and check the user provided settings.
+ *
+ * Called by init() and reload(), after the arguments were parsed.
+ *
+ * - Inherit unset AC line state settings from the unknown state
+ * - Inherit unset core class sample counts
+ * - Check frequency, energy/performance preference, adaptive polling
+ *   and temperature boundaries
+ */
+void init_settings() {
 	/* set user frequency boundaries */
 	auto const & line_unknown = g.acstates[to_value(AcLineState::UNKNOWN)];
 	for (auto & state : g.acstates) {
@@ -468,6 +1117,14 @@ void init() {
 		if (state.freq_max == FREQ_UNSET) {
 			state.freq_max = line_unknown.freq_max;
 		}
+		if (state.kp == GAIN_UNSET) {
+			state.kp = line_unknown.kp;
+			state.ki = line_unknown.ki;
+		}
+		if (state.epp_min == EPP_UNSET) {
+			state.epp_min = line_unknown.epp_min;
+			state.epp_max = line_unknown.epp_max;
+		}
 		/* check user frequency boundaries */
 		if (state.freq_min >= state.freq_max) {
 			fail(Exit::EOUTOFRANGE, 0,
@@ -475,21 +1132,180 @@ void init() {
 			     "\t%s [%d MHz, %d MHz]"_fmt
 			     (state.name, state.freq_min, state.freq_max));
 		}
+		/* check user energy/performance preference boundaries */
+		if (state.epp_min > state.epp_max) {
+			fail(Exit::EOUTOFRANGE, 0,
+			     "energy/performance preference 'min <= max' violation:\n"
+			     "\t%s [%d, %d]"_fmt
+			     (state.name, state.epp_min, state.epp_max));
+		}
+	}
+	for (auto & cls : g.classes) {
+		cls.samples = cls.samples ? cls.samples : g.samples;
+		if (cls.freq_min >= cls.freq_max) {
+			fail(Exit::EOUTOFRANGE, 0,
+			     "frequency limits 'min < max' violation:\n"
+			     "\t%s [%d MHz, %d MHz]"_fmt
+			     (cls.name, cls.freq_min, cls.freq_max));
+		}
 	}
 
-	/* setup temperature throttling */
-	if (g.temp_throttling) {
-		/* user provided throttling values */
-
-		/* check temperature throttling boundaries */
-		if (g.temp_high >= g.temp_crit) {
+	/* check adaptive polling boundaries */
+	if (g.interval_min != g.interval_max) {
+		if (g.interval_min > g.interval_max) {
 			fail(Exit::EOUTOFRANGE, 0,
-			     "temperature throttling 'high < critical' violation:\n"
-			     "\t[%d C, %d C]"_fmt
-			     (celsius(g.temp_high), celsius(g.temp_crit)));
+			     "polling interval 'min < max' violation:\n"
+			     "\t[%d ms, %d ms]"_fmt
+			     (g.interval_min.count(), g.interval_max.count()));
+		}
+		g.interval = std::min(std::max(g.interval, g.interval_min),
+		                      g.interval_max);
+	}
+
+	/* check user provided temperature throttling boundaries */
+	if (g.temp_throttling && g.temp_high >= g.temp_crit) {
+		fail(Exit::EOUTOFRANGE, 0,
+		     "temperature throttling 'high < critical' violation:\n"
+		     "\t[%d C, %d C]"_fmt
+		     (celsius(g.temp_high), celsius(g.temp_crit)));
+	}
+}
+
+/**
+ * Perform initial tasks.
+ *
+ * - Get number of CPU cores/threads
+ * - Determine the clock controlling core for each core
+ * - Open the AC line state and load handles, e.g. hw.acpi.acline
+ *   and kern.cp_times
+ */
+void init() {
+	/* set the platform root */
+	if (g.rootdir && !platform::root(g.rootdir)) {
+		fail(Exit::ECLARG, 0,
+		     "%s access does not support a file system root"_fmt
+		     (platform::SOURCE));
+	}
+
+	/* get the number of cores */
+	g.ncpu = platform::ncpu();
+	g.cores = std::unique_ptr<Core[]>{new Core[g.ncpu]};
+
+	/* get AC line state handle */
+	try {
+		g.acline = platform::AcLine{ACLINE};
+	} catch (sys::sc_error<platform::error>) {
+		verbose("cannot read %s\n", ACLINE);
+	}
+
+	/* get the CPU topology */
+	Topology const topology{g.ncpu};
+
+	/*
+	 * Find the cores owning a frequency handler. SMT threads share
+	 * the clock of their core, so the handlers of all but the
+	 * first thread are ignored.
+	 */
+	std::vector<coreid_t> owners;
+	for (coreid_t core = 0; core < g.ncpu; ++core) {
+		/* get the frequency handler */
+		char name[128];
+		sprintf_safe(name, FREQ, core);
+		try {
+			platform::freq(core);
+		} catch (sys::sc_error<platform::error> e) {
+			if (e != ENOENT) {
+				verbose("cannot access %s: %s\n",
+				        platform::SOURCE, name);
+				platform_fail(e);
+			}
+			if (0 == core) {
+				fail(Exit::ENOFREQ, e, "cannot access "s + name + ", at least the first CPU core must support frequency updates");
+			}
+			continue;
+		}
+		auto const sibling =
+		    std::find_if(owners.begin(), owners.end(),
+		                 [&topology, core](coreid_t const owner) {
+			return topology.siblings(owner, core);
+		});
+		if (sibling != owners.end()) {
+			verbose("%s is controlled by SMT sibling: %d\n",
+			        name, *sibling);
+			continue;
+		}
+		owners.push_back(core);
+	}
+	g.ngroups = owners.size();
+	g.groups = std::unique_ptr<CoreGroup[]>{new CoreGroup[g.ngroups]{}};
+	g.members = std::unique_ptr<coreid_t[]>{new coreid_t[g.ncpu]{}};
+
+	/* get the frequency handlers */
+	for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
+		auto & group = g.groups[groupi];
+		group.freq = platform::freq(owners[groupi]);
+		group.corei = owners[groupi];
+	}
+
+	/*
+	 * Get the frequency controlling core for each core.
+	 * The controlling core sharing the most topology groups is
+	 * selected, i.e. an SMT sibling, then a core sharing a cache,
+	 * then a core in the same package. Ties go to the closest
+	 * preceding controlling core, so without topology information
+	 * this acts as if the kernel supported local frequency changes.
+	 */
+	for (coreid_t core = 0; core < g.ncpu; ++core) {
+		coreid_t select = 0;
+		coreid_t shared = topology.shared(owners[select], core);
+		for (coreid_t groupi = 1; groupi < g.ngroups; ++groupi) {
+			auto const cmp = topology.shared(owners[groupi], core);
+			if (cmp > shared || (cmp == shared && owners[groupi] <= core)) {
+				select = groupi;
+				shared = cmp;
+			}
+		}
+		g.cores[core].group = &g.groups[select];
+	}
+
+	/* list the cores of each group */
+	for (coreid_t groupi = 0, membersi = 0; groupi < g.ngroups; ++groupi) {
+		auto & group = g.groups[groupi];
+		group.membersi = membersi;
+		for (coreid_t core = 0; core < g.ncpu; ++core) {
+			if (g.cores[core].group == &group) {
+				g.members[membersi++] = core;
+				++group.coren;
+			}
 		}
+	}
+
+	/*
+	 * Distribute the core groups over the shards, every shard
+	 * should cover a similar number of cores.
+	 */
+	g.nshards = std::min(g.threads, g.ngroups);
+	g.shards = std::unique_ptr<Shard[]>{new Shard[g.nshards]{}};
+	for (coreid_t shardi = 0, groupi = 0, cores = 0;
+	     shardi < g.nshards; ++shardi) {
+		auto & shard = g.shards[shardi];
+		/* leave at least one group for each remaining shard */
+		coreid_t const groups = g.ngroups - (g.nshards - shardi - 1);
+		coreid_t const until = g.ncpu * (shardi + 1) / g.nshards;
+		shard.first = groupi;
+		do {
+			cores += g.groups[groupi++].coren;
+		} while (groupi < groups && cores < until);
+		shard.last = groupi;
+	}
+
+	/* resolve and check the user settings */
+	init_settings();
 
-		/* propagate limits to all core groups */
+	/* setup temperature throttling */
+	if (g.temp_throttling) {
+		/* user provided throttling values, propagate limits to
+		 * all core groups */
 		assert(g.groups);
 		for (coreid_t i = 0; i < g.ngroups; ++i) {
 			g.groups[i].temp_high = g.temp_high;
@@ -500,20 +1316,12 @@ void init() {
 		for (coreid_t core = 0; core < g.ncpu; ++core) {
 			assert(g.cores[core].group);
 			auto & group = *g.cores[core].group;
-			for (auto const source : TJMAX_SOURCES) {
-				char name[40];
-				sprintf_safe(name, source, core);
-				try {
-					group.temp_crit = SysctlOnce<decikelvin_t>{
-					    group.temp_crit, name
-					};
-					g.temp_throttling = true;
-					group.temp_high =
-					    group.temp_crit - HITEMP_OFFSET;
-					break;
-				} catch (sys::sc_error<sys::ctl::error>) {
-					/* do nada */
-				}
+			try {
+				group.temp_crit = platform::tjmax(core);
+				g.temp_throttling = true;
+				group.temp_high = group.temp_crit - HITEMP_OFFSET;
+			} catch (sys::sc_error<platform::error>) {
+				/* do nada */
 			}
 		}
 	}
@@ -521,322 +1329,1171 @@ void init() {
 		verbose("could not determine critical temperature\n"
 		        "\ttemperature throttling: off\n");
 	} else for (coreid_t i = 0; i < g.ncpu; ++i) {
-		char name[80]{};
+		char name[128]{};
 		sprintf_safe(name, g.tempctl_name, i);
 		try {
-			g.cores[i].temp = {{name}};
+			g.cores[i].temp = platform::temp(name);
 			decikelvin_t const val = g.cores[i].temp;
 			if (val < 0 || celsius(val) > 255) {
 				fail(Exit::EOUTOFRANGE, 0,
 				     "core %d temperature %s=%dC must be in range [0 K; 255 C]"_fmt
 				     (i, name, celsius(val)));
 			}
-		} catch (sys::sc_error<sys::ctl::error>) {
+		} catch (sys::sc_error<platform::error>) {
 			if (0 < i) {
-				verbose("cannot access sysctl: %s\n", name);
+				verbose("cannot access %s: %s\n",
+				        platform::SOURCE, name);
 				g.cores[i].temp = g.cores[i - 1].temp;
 				continue;
 			}
-			/* user-requested sysctls are mandatory */
+			/* user-requested sources are mandatory */
 			if (g.tempctl_name != TEMPERATURE) {
 				fail(Exit::ESYSCTLNAME, 0,
-				     "cannot access user-requested sysctl: "s +
-				     name);
+				     "cannot access user-requested %s: %s"_fmt
+				     (platform::SOURCE, name));
 			}
-			verbose("cannot access sysctl: %s\n"
+			verbose("cannot access %s: %s\n"
 			        "\ttemperature throttling: off\n",
-			        name);
+			        platform::SOURCE, name);
 			g.temp_throttling = false;
 			break;
 		}
 	}
 
+	/*
+	 * Select a temperature sensor for each package. The core groups
+	 * of a package share the heat spreader, so reading every core
+	 * adds sysctl reads, but little information. The controlling
+	 * core of the first core group represents the package.
+	 */
+	if (g.temp_throttling) {
+		std::vector<std::vector<bool>> packages;
+		std::vector<coreid_t> sensors;
+		for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
+			auto & group = g.groups[groupi];
+			std::vector<bool> members(g.ncpu);
+			for (coreid_t i = 0; i < group.coren; ++i) {
+				members[g.members[group.membersi + i]] = true;
+			}
+			auto const & package = topology.package(members);
+			auto const it = std::find(packages.begin(),
+			                          packages.end(), package);
+			group.sensori = it - packages.begin();
+			if (it == packages.end()) {
+				packages.push_back(package);
+				sensors.push_back(group.corei);
+			}
+		}
+		g.nsensors = sensors.size();
+		g.sensors = std::unique_ptr<Sensor[]>{new Sensor[g.nsensors]{}};
+		for (coreid_t i = 0; i < g.nsensors; ++i) {
+			g.sensors[i].core = sensors[i];
+		}
+	}
+
 	/* set per group settings */
-	CoreGroup * group = nullptr;
-	for (coreid_t i = 0; i < g.ncpu; ++i) {
-		auto & core = g.cores[i];
-		if (core.group == group) { continue; }
-		group = core.group;
-		char name[40];
+	for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
+		auto const group = &g.groups[groupi];
+		auto const i = group->corei;
+		char name[128];
 
 		/* set per group min/max frequency boundaries */
 		sprintf_safe(name, FREQ_LEVELS, i);
 		try {
-			Sysctl const ctl{name};
-			auto levels = ctl.get<char>();
 			/* the maximum should at least be the minimum
 			 * and vice versa */
 			Max<mhz_t> max{FREQ_DEFAULT_MIN};
 			Min<mhz_t> min{FREQ_DEFAULT_MAX};
-			for (auto pch = levels.get(); *pch; ++pch) {
-				mhz_t freq = strtol(pch, &pch, 10);
-				if (pch[0] != '/') { break; }
-				max = freq;
-				min = freq;
-				strtol(++pch, &pch, 10);
-				/* no idea what that value means */
-				if (pch[0] != ' ') { break; }
-			}
+			group->levels.clear();
+			platform::levels(i, group->levels, min, max);
 			/* there is only one level with hwpstate */
 			if (min == max) {
 				min = FREQ_DEFAULT_MIN;
+				group->levels.clear();
 			}
+			std::sort(group->levels.begin(), group->levels.end());
 			assert(min < max &&
 			       "minimum must be less than maximum");
 			group->min = min;
 			group->max = max;
-		} catch (sys::sc_error<sys::ctl::error>) {
-			verbose("cannot access sysctl: %s\n", name);
+		} catch (sys::sc_error<platform::error>) {
+			verbose("cannot access %s: %s\n", platform::SOURCE, name);
 		}
 
 		/* check freq_drivers  */
 		sprintf_safe(name, FREQ_DRIVER, i);
 		try {
-			Sysctl const ctl{name};
-			auto driver = ctl.get<char>();
+			auto const driver = platform::driver(i);
 			for (auto const prefix : FREQ_DRIVER_BLACKLIST) {
 				if (0 != std::strncmp(driver.get(), prefix,
 				                      std::strlen(prefix))) {
 					continue;
 				}
+				/* hardware P-states may take a preference */
+				try {
+					group->epp = platform::epp(i);
+					group->eppctl = true;
+					verbose("cpu.%d: %s controlled by energy/performance preference\n",
+					        i, driver.get());
+					break;
+				} catch (sys::sc_error<platform::error>) {
+					/* no preference either */
+				}
 				fail(Exit::EDRIVER, 0,
 				     "frequency control driver not supported: %s"_fmt
 				     (driver.get()));
 			}
-		} catch (sys::sc_error<sys::ctl::error>) {
+		} catch (sys::sc_error<platform::error>) {
 			/* no driver is fine */
-			verbose("cannot access sysctl: %s\n", name);
+			verbose("cannot access %s: %s\n", platform::SOURCE, name);
+		}
+	}
+
+	/*
+	 * Classify core groups by their maximum clock frequency,
+	 * groups with unknown frequency levels are performance cores.
+	 */
+	Max<mhz_t> highest{0};
+	for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
+		auto const & group = g.groups[groupi];
+		if (group.max != FREQ_DEFAULT_MAX) { highest = group.max; }
+	}
+	for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
+		auto & group = g.groups[groupi];
+		if (group.max != FREQ_DEFAULT_MAX &&
+		    group.max * 1024 < highest * EFFICIENCY_FREQ) {
+			group.cls = CoreClass::EFFICIENCY;
+		}
+	}
+
+	/* setup the load sample windows of each core class */
+	Max<size_t> maxsamples{0};
+	for (auto & cls : g.classes) {
+		cls.weights = std::unique_ptr<ms::rep[]>{
+			new ms::rep[cls.samples]{}};
+		maxsamples = cls.samples;
+	}
+	if (g.filter == Filter::PERCENTILE) {
+		for (coreid_t shardi = 0; shardi < g.nshards; ++shardi) {
+			g.shards[shardi].scratch = std::unique_ptr<mhz_t[]>{
+				new mhz_t[maxsamples]{}};
+		}
+	}
+	for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
+		auto & group = g.groups[groupi];
+		/* create loads buffer */
+		if (g.filter != Filter::EWMA && g.filter != Filter::HOLT) {
+			group.loads = std::unique_ptr<mhz_t[]>{
+				new mhz_t[g.classes[to_value(group.cls)].samples]{}};
 		}
 	}
 
-	/* MIB for kern.cp_times */
-	g.cp_times_ctl = {CP_TIMES};
+	/* handle for the load ticks, e.g. kern.cp_times */
+	g.times = platform::Times{g.ncpu};
 
-	/* create buffer for system load ticks */
+	/* create buffers for system load ticks */
 	g.cp_times = std::unique_ptr<cptime_t[][CPUSTATES]>{
 		new cptime_t[g.ncpu][CPUSTATES]{}};
-	for (coreid_t i = 0; i < g.ncpu; ++i) {
-		auto & core = g.cores[i];
-		core.cp_time = g.cp_times[i];
-	}
+	g.ticks.all   = std::unique_ptr<cptime_t[]>{new cptime_t[g.ncpu]{}};
+	g.ticks.idle  = std::unique_ptr<cptime_t[]>{new cptime_t[g.ncpu]{}};
+	g.ticks.dall  = std::unique_ptr<cptime_t[]>{new cptime_t[g.ncpu]{}};
+	g.ticks.didle = std::unique_ptr<cptime_t[]>{new cptime_t[g.ncpu]{}};
 
-	/* test kern.cp_times is readable */
+	/* test the load ticks are readable */
 	try {
-		g.cp_times_ctl.get(g.cp_times[0],
-		                   g.ncpu * sizeof(g.cp_times[0]));
-	} catch (sys::sc_error<sys::ctl::error> e) {
-		/* The kern.cp_times sysctl must be readable, ENOMEM
-		 * is  fine, see update_loads(). */
-		if (e != ENOMEM) {
-			sysctl_fail(e);
-		}
+		g.times.get(g.cp_times.get(), g.ncpu);
+	} catch (sys::sc_error<platform::error> e) {
+		platform_fail(e);
 	}
 }
 
 /**
- * Updates the cp_times ring buffer and computes the load average for
- * each core.
+ * Returns the weight of a load sample taken at the current polling
+ * interval.
  *
- * @tparam Load
- *	Determines whether CoreGroup::loadsum is updated
- * @tparam Temperature
- *	Determines whether CoreGroup::temp is updated
+ * @return
+ *	The polling interval in ms, at least 1
  */
-template <bool Load = 1, bool Temperature = 0>
-void update_loads() {
-	/* update load ticks */
-	if (Load) try {
-		g.cp_times_ctl.get(g.cp_times[0],
-		                   g.ncpu * sizeof(g.cp_times[0]));
-	} catch (sys::sc_error<sys::ctl::error> e) {
-		/*
-		 * Ignore errors assuming it's ENOMEM.
-		 *
-		 * If HT is disabled kern.cp_times reports more cores
-		 * than hw.ncpu does. It's fine to ignore, because
-		 * these excess cores never report any load.
-		 *
-		 * The init() function performs a test read to ensure
-		 * kern.cp_times does not fail for a different reason.
-		 */
+ms::rep sample_weight() {
+	return std::max<ms::rep>(g.interval.count(), 1);
+}
+
+/**
+ * Adapts the polling interval to the volatility of the load.
+ *
+ * The interval is halved when the load of any core group changed
+ * sharply against its filtered load. It is stretched by a quarter
+ * while all group loads are stable.
+ *
+ * @param change
+ *	The greatest load change of a core group relative to its clock
+ *	frequency, 1024 represents the full clock frequency
+ */
+void update_interval(cptime_t const change) {
+	if (change >= POLL_SHRINK_LOAD) {
+		g.interval = std::max(g.interval / 2, g.interval_min);
+	} else if (change <= POLL_STRETCH_LOAD) {
+		g.interval = std::min(g.interval + std::max(g.interval / 4, ms{1}),
+		                      g.interval_max);
 	}
+}
 
-	assert(g.groups);
-	for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
-		/* reset controlling core data */
-		auto & group = g.groups[groupi];
-		group.sample_freq = group.freq;
-		Temperature && (group.temp = Max<decikelvin_t>{0});
-	}
-
-	for (coreid_t corei = 0; corei < g.ncpu; ++corei) {
-		auto & core = g.cores[corei];
-		assert(core.group);
-		auto & group = *core.group;
-
-		/* update load */
-		if (Load) {
-			/* collect ticks */
-			cptime_t all_new = 0;
-			cptime_t idle_new = 0;
-			for (size_t i = 0; i < CPUSTATES; ++i) {
-				all_new += core.cp_time[i];
-				idle_new += g.idleStates[i] * core.cp_time[i];
-			}
-			cptime_t const all = all_new - core.all;
-			core.all = all_new;
-			cptime_t const idle = idle_new - core.idle;
-			core.idle = idle_new;
+/**
+ * The number of cores per block in update_ticks().
+ */
+constexpr coreid_t const TICK_LANES{4};
+
+/**
+ * Reduces a block of kern.cp_times entries to per core tick deltas.
+ *
+ * The block is accumulated in local arrays, one lane per core, so the
+ * compiler can vectorise the reduction across cores.
+ *
+ * The block covers a range of Global::members, the kern.cp_times
+ * entries of its cores are gathered.
+ *
+ * @tparam Lanes
+ *	The number of cores in the block
+ * @param membersi
+ *	The index of the first core of the block in Global::members
+ * @param mask
+ *	A local copy of Global::idleMask
+ */
+template <coreid_t Lanes>
+void update_ticks(coreid_t const membersi,
+                  cptime_t const (& mask)[CPUSTATES]) {
+	coreid_t const * const members = &g.members[membersi];
+	cptime_t all_new[Lanes]{};
+	cptime_t idle_new[Lanes]{};
+	for (size_t i = 0; i < CPUSTATES; ++i) {
+		for (coreid_t lane = 0; lane < Lanes; ++lane) {
+			auto const ticks = g.cp_times[members[lane]][i];
+			all_new[lane] += ticks;
+			idle_new[lane] += ticks & mask[i];
+		}
+	}
+
+	auto const all = &g.ticks.all[membersi];
+	auto const idle = &g.ticks.idle[membersi];
+	auto const dall = &g.ticks.dall[membersi];
+	auto const didle = &g.ticks.didle[membersi];
+	for (coreid_t lane = 0; lane < Lanes; ++lane) {
+		dall[lane] = all_new[lane] - all[lane];
+		all[lane] = all_new[lane];
+		didle[lane] = idle_new[lane] - idle[lane];
+		idle[lane] = idle_new[lane];
+	}
+}
+
+/**
+ * Reduces the kern.cp_times buffer to per core tick deltas.
+ *
+ * Updates the Global::Ticks arrays for all cores. Cores are processed
+ * in the order of Global::members in blocks of TICK_LANES, the
+ * remaining cores one by one.
+ */
+void update_ticks() {
+	cptime_t mask[CPUSTATES];
+	for (size_t i = 0; i < CPUSTATES; ++i) {
+		mask[i] = g.idleMask[i];
+	}
+	coreid_t const ncpu = g.ncpu;
+	coreid_t membersi = 0;
+	for (; membersi + TICK_LANES <= ncpu; membersi += TICK_LANES) {
+		update_ticks<TICK_LANES>(membersi, mask);
+	}
+	for (; membersi < ncpu; ++membersi) {
+		update_ticks<1>(membersi, mask);
+	}
+}
+
+/**
+ * Updates the cp_times buffer and the per core tick deltas.
+ */
+void update_times() {
+	/* update load ticks */
+	try {
+		g.times.get(g.cp_times.get(), g.ncpu);
+	} catch (sys::sc_error<platform::error> e) {
+		/*
+		 * Ignore errors, the previous ticks are kept.
+		 *
+		 * The init() function performs a test read to ensure
+		 * reading the ticks does not fail in general.
+		 */
+	}
+
+	/* collect ticks */
+	update_ticks();
+}
+
+/**
+ * Computes the maximum load of each core group in a shard.
+ *
+ * The load is computed from the tick deltas of update_times().
+ *
+ * @tparam Load
+ *	Determines whether CoreGroup::load is updated
+ * @param shard
+ *	The shard of core groups to update
+ */
+template <bool Load = 1>
+void update_loads(Shard & shard) {
+	assert(g.groups);
+	for (coreid_t groupi = shard.first; groupi < shard.last; ++groupi) {
+		/* reset controlling core data */
+		auto & group = g.groups[groupi];
+		group.sample_freq = group.freq;
+		++shard.reads;
+
+		/* update current sample */
+		mhz_t const freq = group.sample_freq;
+		auto const dall = &g.ticks.dall[group.membersi];
+		auto const didle = &g.ticks.didle[group.membersi];
+		for (coreid_t i = 0; Load && i < group.coren; ++i) {
+			cptime_t const all = dall[i];
+			cptime_t const idle = didle[i];
+			if (all) {
+				/* measurement succeeded */
+				group.load = freq - (freq * idle) / all;
+			} else {
+				/*
+				 * just hope another core in the group
+				 * reports something
+				 */
+			}
+		}
+	}
+}
+
+/**
+ * Sample the temperature sensors and update the core group
+ * temperatures.
+ *
+ * Temperatures change on a scale of seconds, so they are sampled
+ * at their own interval instead of every polling interval.
+ *
+ * @return
+ *	The number of sysctl reads
+ */
+unsigned long update_temps() {
+	if ((g.temp_wait -= g.interval) > ms{0}) {
+		return 0;
+	}
+	g.temp_wait = g.temp_interval;
+	for (coreid_t i = 0; i < g.nsensors; ++i) {
+		auto & sensor = g.sensors[i];
+		try {
+			sensor.temp = g.cores[sensor.core].temp;
+		} catch (sys::sc_error<platform::error>) {
+			verbose("access to core %d temperature failed\n"
+			        "turn off temperature based throttling\n",
+			        sensor.core);
+			g.temp_throttling = false;
+			return i + 1;
+		}
+	}
+	for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
+		auto & group = g.groups[groupi];
+		group.temp = Max<decikelvin_t>{g.sensors[group.sensori].temp};
+	}
+	return g.nsensors;
+}
+
+/**
+ * Computes the sum of the sample weights of each core class after
+ * the current sample replaces the oldest one.
+ *
+ * This must be called before update_filter().
+ */
+void prepare_filter() {
+	ms::rep const weight = sample_weight();
+	for (auto & cls : g.classes) {
+		cls.nextsum = cls.weightsum - cls.weights[cls.sample] + weight;
+	}
+}
+
+/**
+ * Feeds the current load sample of each core group in a shard into
+ * the load filter.
+ *
+ * @tparam FilterT
+ *	The load filter to apply
+ * @param shard
+ *	The shard of core groups to update
+ */
+template <Filter FilterT>
+void update_filter(Shard & shard) {
+	/* the time covered by the current sample */
+	ms::rep const weight = sample_weight();
+	for (coreid_t groupi = shard.first; groupi < shard.last; ++groupi) {
+		auto & group = g.groups[groupi];
+		auto const & cls = g.classes[to_value(group.cls)];
+		ms::rep const weightsum = cls.nextsum;
+		mhz_t const load = group.load;
+		/* reset current group load for next cycle */
+		group.load = Max<mhz_t>{0};
+
+		/* track the load change relative to the group clock */
+		mhz_t const prev = group.filtered;
+		mhz_t const freq = std::max<mhz_t>(group.sample_freq, 1);
+		shard.change = cptime_t{load > prev ? load - prev : prev - load} *
+		               1024 / freq;
+
+		switch (FilterT) {
+		case Filter::MEAN:
+			/* subtract oldest sample */
+			group.loadsum -= group.loads[cls.sample] * cls.weights[cls.sample];
+			/* update current sample */
+			group.loads[cls.sample] = load;
+			/* add current sample */
+			group.loadsum += group.loads[cls.sample] * weight;
+			group.filtered = group.loadsum / weightsum;
+			break;
+		case Filter::EWMA:
+			/* the smoothing factor is 2 / (samples + 1) for
+			 * samples of equal duration */
+			group.ewma += (ms::rep{load} * 1024 - group.ewma) *
+			              2 * weight / (weightsum + weight);
+			group.filtered = group.ewma / 1024;
+			break;
+		case Filter::MAX:
+			group.loads[cls.sample] = load;
+			group.filtered = *std::max_element(&group.loads[0],
+			                                   &group.loads[cls.samples]);
+			break;
+		case Filter::PERCENTILE: {
+			group.loads[cls.sample] = load;
+			auto const first = &shard.scratch[0];
+			auto const last = &shard.scratch[cls.samples];
+			auto const nth = first +
+			                 ((cls.samples - 1) * g.percentile + 50) / 100;
+			std::copy(&group.loads[0], &group.loads[cls.samples], first);
+			std::nth_element(first, nth, last);
+			group.filtered = *nth;
+		}	break;
+		case Filter::HOLT: {
+			/* the smoothing factor of the EWMA filter is
+			 * used for the level and the trend */
+			ms::rep const alpha_n = 2 * weight;
+			ms::rep const alpha_d = weightsum + weight;
+			ms::rep const level = group.ewma;
+			ms::rep const expected = level + group.trend * weight;
+			group.ewma = expected + (ms::rep{load} * 1024 - expected) *
+			                        alpha_n / alpha_d;
+			group.trend += ((group.ewma - level) / weight - group.trend) *
+			               alpha_n / alpha_d;
+			/* track the mean absolute prediction error */
+			ms::rep const error = std::abs(ms::rep{load} * 1024 - expected);
+			group.error += (error - group.error) * alpha_n / alpha_d;
+			/* project the load to the next sample, only the part
+			 * of the projection exceeding the prediction error
+			 * is applied, so noise does not cause oscillation */
+			ms::rep const step = group.trend * weight;
+			ms::rep const gated = step > 0 ?
+			                      std::max<ms::rep>(step - group.error, 0) :
+			                      std::min<ms::rep>(step + group.error, 0);
+			ms::rep const projected = group.ewma + gated;
+			group.filtered = std::max<ms::rep>(projected, 0) / 1024;
+		}	break;
+		case Filter::LENGTH:
+			assert(false && "update_filter<>() requires a filter");
+		}
+	}
+}
+
+/**
+ * Advances the sample windows of all core classes and adapts the
+ * polling interval.
+ *
+ * This must be called after update_filter() was called for every
+ * shard.
+ *
+ * @param change
+ *	The greatest load change of a core group relative to its clock
+ *	frequency, 1024 represents the full clock frequency
+ */
+void commit_filter(cptime_t const change) {
+	/* update sample time */
+	ms::rep const weight = sample_weight();
+	for (auto & cls : g.classes) {
+		cls.weightsum = cls.nextsum;
+		cls.weights[cls.sample] = weight;
+		cls.sample = (cls.sample + 1) % cls.samples;
+	}
+
+	/* adapt the polling interval */
+	if (g.interval_min < g.interval_max) {
+		update_interval(change);
+	}
+}
+
+/**
+ * Returns the load target of a core group.
+ *
+ * The load target of the core class overrides the load target of
+ * the AC line state, unless the AC line state selects a fixed clock
+ * frequency.
+ *
+ * @param group
+ *	The core group
+ * @param acstate
+ *	The set of acline dependent variables
+ * @return
+ *	The load target [0, 1024]
+ */
+cptime_t target_load(CoreGroup const & group,
+                     Global::ACSet const & acstate) {
+	auto const & cls = g.classes[to_value(group.cls)];
+	return acstate.target_load && cls.target_load ?
+	       cls.target_load : acstate.target_load;
+}
+
+/**
+ * Applies the PI controller to the open loop target frequency.
+ *
+ * The open loop target frequency is the clock frequency that would
+ * meet the load target at the current load. The proportional term
+ * scales it, the integral term accumulates its difference to the
+ * current clock frequency. This compensates persistent errors, e.g.
+ * caused by the driver rounding to the available frequency levels.
+ *
+ * The integral term is limited so the controller output stays within
+ * the frequency limits (anti-windup).
+ *
+ * @param group
+ *	The core group
+ * @param acstate
+ *	The set of acline dependent variables
+ * @param want
+ *	The open loop target frequency
+ * @param min,max
+ *	The clock frequency limits
+ * @return
+ *	The controller output frequency
+ */
+mhz_t pi_freq(CoreGroup & group, Global::ACSet const & acstate,
+              mhz_t const want, mhz_t const min, mhz_t const max) {
+	ms::rep const prop = ms::rep{want} * acstate.kp;
+	ms::rep const error = ms::rep{want} - ms::rep{group.sample_freq};
+	group.integral += error * acstate.ki * g.interval.count() / 1000;
+	group.integral = std::min(group.integral, ms::rep{max} * 1024 - prop);
+	group.integral = std::max(group.integral, ms::rep{min} * 1024 - prop);
+	return std::max<ms::rep>(prop + group.integral, 0) / 1024;
+}
+
+/**
+ * Snaps a clock frequency to the frequency levels of a core group.
+ *
+ * Selects the lowest level that is not below the given frequency,
+ * so the load target is still met. If there is no such level within
+ * the limits, the highest level within the limits is selected.
+ *
+ * @param group
+ *	The core group
+ * @param freq
+ *	The clock frequency within the limits
+ * @param min,max
+ *	The clock frequency limits
+ * @return
+ *	The frequency level or freq if no level is within the limits
+ */
+mhz_t snap_freq(CoreGroup const & group, mhz_t const freq,
+                mhz_t const min, mhz_t const max) {
+	auto const & levels = group.levels;
+	auto const end = std::upper_bound(levels.begin(), levels.end(), max);
+	auto const it = std::lower_bound(levels.begin(), end, freq);
+	if (it != end) {
+		return *it;
+	}
+	if (it != levels.begin() && *(it - 1) >= min) {
+		return *(it - 1);
+	}
+	return freq;
+}
+
+/**
+ * Decides whether a clock frequency update passes the hysteresis
+ * band and the dwell time.
+ *
+ * @param group
+ *	The core group
+ * @param freq
+ *	The new clock frequency
+ * @retval true
+ *	The update is permitted
+ * @retval false
+ *	The update should be suppressed
+ */
+bool permit_freq(CoreGroup const & group, mhz_t const freq) {
+	mhz_t const cur = group.sample_freq;
+	mhz_t const diff = freq > cur ? freq - cur : cur - freq;
+	return group.dwelt >= g.dwell &&
+	       cptime_t{diff} * 1024 >= g.hysteresis * cur;
+}
+
+/**
+ * Map a clock frequency to an energy/performance preference.
+ *
+ * The frequency range is mapped linearly onto the preference range
+ * of the AC line state, the maximum frequency onto the lowest
+ * preference, i.e. the strongest performance bias.
+ *
+ * @param freq
+ *	The target clock frequency
+ * @param min,max
+ *	The clock frequency range
+ * @param acstate
+ *	The set of acline dependent variables
+ * @return
+ *	The energy/performance preference
+ */
+epp_t freq_epp(mhz_t const freq, mhz_t const min, mhz_t const max,
+               Global::ACSet const & acstate) {
+	if (freq >= max) { return acstate.epp_min; }
+	if (freq <= min) { return acstate.epp_max; }
+	epp_t const range = acstate.epp_max - acstate.epp_min;
+	return acstate.epp_max -
+	       (range * (freq - min) + (max - min) / 2) / (max - min);
+}
+
+/**
+ * Decides whether an energy/performance preference update passes
+ * the hysteresis band and the dwell time.
+ *
+ * The hysteresis band is relative to the complete preference range
+ * [0, 100].
+ *
+ * @param group
+ *	The core group
+ * @param epp
+ *	The new energy/performance preference
+ * @retval true
+ *	The update is permitted
+ * @retval false
+ *	The update should be suppressed
+ */
+bool permit_epp(CoreGroup const & group, epp_t const epp) {
+	epp_t const cur = group.eppval;
+	epp_t const diff = epp > cur ? epp - cur : cur - epp;
+	return group.dwelt >= g.dwell &&
+	       cptime_t{diff} * 1024 >= g.hysteresis * 100;
+}
+
+/**
+ * Update the CPU clocks of a shard of core groups depending on the
+ * AC line state and targets.
+ *
+ * Only state owned by the core groups of the shard and the shard
+ * itself is modified, so shards can be updated concurrently.
+ *
+ * @tparam Foreground
+ *	Set for foreground operation (reporting on std::cout)
+ * @tparam Temperature
+ *	Set for temperature based throttling
+ * @tparam Fixed
+ *	Set for fixed frequency mode
+ * @tparam FilterT
+ *	The load filter
+ * @param shard
+ *	The shard of core groups to update
+ * @param acstate
+ *	The set of acline dependent variables
+ */
+template <bool Foreground, bool Temperature, bool Fixed, Filter FilterT>
+void update_freq(Shard & shard, Global::ACSet const & acstate) {
+	using std::chrono::steady_clock;
+	auto const start = steady_clock::now();
+	shard.change = Max<cptime_t>{0};
+	shard.reads = 0;
+	shard.writes = 0;
+	update_loads<(!Fixed || Foreground)>(shard);
+	shard.loadtime = std::chrono::duration_cast<us>(steady_clock::now() -
+	                                                start);
+	if (!Fixed || Foreground) { update_filter<FilterT>(shard); }
+
+	assert(g.groups);
+	for (coreid_t groupi = shard.first; groupi < shard.last; ++groupi) {
+		auto & group = g.groups[groupi];
+
+		/* determine target frequency */
+		auto const & cls = g.classes[to_value(group.cls)];
+		auto const max = std::min<mhz_t>({group.max, acstate.freq_max,
+		                                  cls.freq_max});
+		auto const min = std::max<mhz_t>({group.min, acstate.freq_min,
+		                                  cls.freq_min});
+		mhz_t wantfreq{0};
+		if (!Fixed) {
+			/* adaptive frequency mode */
+			wantfreq = group.filtered * 1024 /
+			           target_load(group, acstate);
+			/* closed loop control */
+			if (acstate.ki) {
+				wantfreq = pi_freq(group, acstate, wantfreq,
+				                   min, max);
+			} else {
+				group.integral = 0;
+			}
+		} else {
+			/* fixed frequency mode */
+			/*
+			 * Do not distinguish between newfreq and
+			 * wantfreq in this mode, because users might
+			 * be disturbed by seeing a 1THz target.
+			 */
+			wantfreq = acstate.target_freq;
+		}
+		Min<mhz_t> newfreq{max};
+		newfreq = std::max(min, wantfreq);
+		/* snap to the available frequency levels */
+		mhz_t const rawfreq = newfreq;
+		if (!Fixed && g.snap) {
+			newfreq = snap_freq(group, newfreq, min, max);
+		}
+		/* apply temperature throttling */
+		bool throttled = false;
+		if (Temperature) {
+			if (group.temp >= group.temp_crit) {
+				newfreq = group.min;
+				throttled = true;
+			} else if (group.temp > group.temp_high) {
+				auto const tempdiff  = group.temp_crit - group.temp;
+				auto const temprange = group.temp_crit - group.temp_high;
+				mhz_t const tempfreq = group.max * tempdiff / temprange;
+				newfreq = std::max<mhz_t>(tempfreq, group.min);
+				throttled = true;
+			}
+		}
+		/* update CPU frequency, throttling and fixed frequency
+		 * updates are never suppressed */
+		group.dwelt += g.interval;
+		if (group.eppctl) {
+			/* bias the hardware P-state selection */
+			auto const newepp = freq_epp(newfreq, min, max, acstate);
+			if (group.eppval != newepp) {
+				if (Fixed || throttled ||
+				    permit_epp(group, newepp)) {
+					group.epp = newepp;
+					group.eppval = newepp;
+					group.dwelt = ms{0};
+					++group.writes;
+					++shard.writes;
+				} else {
+					++group.suppressed;
+				}
+			}
+		} else if (group.sample_freq != newfreq) {
+			if (Fixed || throttled || permit_freq(group, newfreq)) {
+				group.freq = newfreq;
+				group.dwelt = ms{0};
+				++group.writes;
+				++shard.writes;
+			} else {
+				++group.suppressed;
+			}
+		} else if (group.sample_freq != rawfreq) {
+			/* suppressed by snapping */
+			++group.suppressed;
+		}
+		group.wanted = wantfreq;
+		/* foreground output */
+		char eppstr[16]{};
+		if (Foreground && group.eppctl) {
+			sprintf_safe(eppstr, ", epp: %3d", group.eppval);
+		}
+		if (Foreground && Temperature) {
+			io::fout.printf("power: %7s, load: %4d MHz, %3d C, cpu.%d.freq: %4d MHz, wanted: %4d MHz%s\n",
+			                acstate.name,
+			                group.filtered,
+			                celsius(group.temp), group.corei,
+			                group.sample_freq, wantfreq, eppstr);
+		} else if (Foreground) {
+			io::fout.printf("power: %7s, load: %4d MHz, cpu.%d.freq: %4d MHz, wanted: %4d MHz%s\n",
+			                acstate.name,
+			                group.filtered, group.corei,
+			                group.sample_freq, wantfreq, eppstr);
+		}
+	}
+	shard.updatetime = std::chrono::duration_cast<us>(steady_clock::now() -
+	                                                  start);
+}
+
+/**
+ * A function updating the clock frequencies of a shard of core groups.
+ */
+using ShardUpdate = void (*)(Shard &, Global::ACSet const &);
+
+/**
+ * Select the update_freq<>() instance for the given load filter.
+ *
+ * @tparam FilterT
+ *	The load filter
+ * @param acstate
+ *	The set of acline dependent variables
+ * @return
+ *	The shard update function
+ */
+template <Filter FilterT>
+ShardUpdate select_update(Global::ACSet const & acstate) {
+	switch ((g.foreground << 2) | (g.temp_throttling << 1) |
+	        (acstate.target_load == 0)) {
+	case 0b000:
+		return update_freq<0, 0, 0, FilterT>;
+	case 0b001:
+		return update_freq<0, 0, 1, FilterT>;
+	case 0b010:
+		return update_freq<0, 1, 0, FilterT>;
+	case 0b011:
+		return update_freq<0, 1, 1, FilterT>;
+	case 0b100:
+		return update_freq<1, 0, 0, FilterT>;
+	case 0b101:
+		return update_freq<1, 0, 1, FilterT>;
+	case 0b110:
+		return update_freq<1, 1, 0, FilterT>;
+	case 0b111:
+		return update_freq<1, 1, 1, FilterT>;
+	}
+
+	assert(false && "update_freq<>() was not dispatched");
+	return nullptr;
+}
+
+/**
+ * Select the update_freq<>() instance.
+ *
+ * @param acstate
+ *	The set of acline dependent variables
+ * @return
+ *	The shard update function
+ */
+ShardUpdate select_update(Global::ACSet const & acstate) {
+	switch (g.filter) {
+	case Filter::MEAN:
+		return select_update<Filter::MEAN>(acstate);
+	case Filter::EWMA:
+		return select_update<Filter::EWMA>(acstate);
+	case Filter::MAX:
+		return select_update<Filter::MAX>(acstate);
+	case Filter::PERCENTILE:
+		return select_update<Filter::PERCENTILE>(acstate);
+	case Filter::HOLT:
+		return select_update<Filter::HOLT>(acstate);
+	case Filter::LENGTH:
+		break;
+	}
+
+	assert(false && "update_freq<>() was not dispatched");
+	return nullptr;
+}
+
+/**
+ * Pins a thread to a single core.
+ *
+ * Failure is not fatal, it is only reported in verbose mode.
+ *
+ * @param thread
+ *	The thread to pin
+ * @param core
+ *	The core to pin the thread to
+ */
+void pin(std::thread & thread, coreid_t const core) {
+	if (int const err = platform::pin(thread.native_handle(), core)) {
+		verbose("cannot pin thread to core %d: %s\n",
+		        core, std::strerror(err));
+	}
+}
+
+/**
+ * Manages the worker threads updating the core group shards.
+ *
+ * The calling thread updates the first shard, each worker thread
+ * one of the remaining shards. Each worker is pinned to the core
+ * controlling the first core group of its shard.
+ *
+ * Without additional shards no threads are created and the calling
+ * thread updates all core groups.
+ */
+class Workers final {
+	private:
+	/**
+	 * Protects the following members.
+	 */
+	std::mutex mtx;
+
+	/**
+	 * Wakes up the worker threads.
+	 */
+	std::condition_variable start;
+
+	/**
+	 * Wakes up the calling thread once all workers are done.
+	 */
+	std::condition_variable done;
+
+	/**
+	 * The poll counter, incremented to start the workers.
+	 */
+	unsigned long poll{0};
+
+	/**
+	 * The number of workers still updating their shard.
+	 */
+	size_t busy{0};
+
+	/**
+	 * Set to terminate the worker threads.
+	 */
+	bool stop{false};
+
+	/**
+	 * The shard update function of the current poll.
+	 */
+	ShardUpdate update{nullptr};
+
+	/**
+	 * The set of acline dependent variables of the current poll.
+	 */
+	Global::ACSet const * acstate{nullptr};
+
+	/**
+	 * The first exception thrown by a worker during the current poll.
+	 */
+	std::exception_ptr error{nullptr};
+
+	/**
+	 * The worker threads.
+	 */
+	std::vector<std::thread> threads;
+
+	/**
+	 * The worker thread main loop.
+	 *
+	 * @param shardi
+	 *	The index of the shard to update
+	 */
+	void work(coreid_t const shardi) {
+		for (unsigned long poll = 0;;) {
+			std::unique_lock<std::mutex> lock{this->mtx};
+			this->start.wait(lock, [this, poll]() {
+				return this->stop || this->poll != poll;
+			});
+			if (this->stop) { return; }
+			poll = this->poll;
+			lock.unlock();
+
+			std::exception_ptr error{nullptr};
+			try {
+				this->update(g.shards[shardi], *this->acstate);
+			} catch (...) {
+				error = std::current_exception();
+			}
+
+			lock.lock();
+			if (error && !this->error) { this->error = error; }
+			if (0 == --this->busy) { this->done.notify_one(); }
+		}
+	}
+
+	public:
+	/**
+	 * Start a worker thread for every shard but the first.
+	 *
+	 * Signals are blocked in the worker threads, so they are
+	 * delivered to the calling thread.
+	 */
+	Workers() {
+		sigset_t all, mask;
+		sigfillset(&all);
+		pthread_sigmask(SIG_SETMASK, &all, &mask);
+		for (coreid_t shardi = 1; shardi < g.nshards; ++shardi) {
+			this->threads.emplace_back(&Workers::work, this, shardi);
+			pin(this->threads.back(),
+			    g.groups[g.shards[shardi].first].corei);
+		}
+		pthread_sigmask(SIG_SETMASK, &mask, nullptr);
+	}
+
+	/**
+	 * Terminate the worker threads.
+	 */
+	~Workers() {
+		{
+			std::scoped_lock const lock{this->mtx};
+			this->stop = true;
+		}
+		this->start.notify_all();
+		for (auto & thread : this->threads) {
+			thread.join();
+		}
+	}
+
+	/**
+	 * Update all shards.
+	 *
+	 * Returns once all shards are updated, exceptions thrown
+	 * during the update are rethrown.
+	 *
+	 * @param update
+	 *	The shard update function
+	 * @param acstate
+	 *	The set of acline dependent variables
+	 */
+	void operator ()(ShardUpdate const update,
+	                 Global::ACSet const & acstate) {
+		if (this->threads.empty()) {
+			return update(g.shards[0], acstate);
+		}
 
-			/* update current sample */
-			mhz_t const freq = group.sample_freq;
-			if (all) {
-				/* measurement succeeded */
-				group.load = freq - (freq * idle) / all;
-			} else {
-				/*
-				 * just hope another core in the group
-				 * reports something
-				 */
-			}
+		/* start the workers */
+		{
+			std::scoped_lock const lock{this->mtx};
+			this->update = update;
+			this->acstate = &acstate;
+			this->busy = this->threads.size();
+			++this->poll;
 		}
+		this->start.notify_all();
 
-		/* update group temperature */
-		if (Temperature) try {
-			group.temp = core.temp;
-		} catch (sys::sc_error<sys::ctl::error> e) {
-			verbose("access to core %d temperature failed\n", corei);
-			if (g.temp_throttling) {
-				verbose("turn off temperature based throttling\n");
-				g.temp_throttling = false;
-			}
+		/* update the first shard */
+		std::exception_ptr error{nullptr};
+		try {
+			update(g.shards[0], acstate);
+		} catch (...) {
+			error = std::current_exception();
 		}
-	}
 
-	for (coreid_t groupi = 0; Load && groupi < g.ngroups; ++groupi) {
-		auto & group = g.groups[groupi];
-		/* subtract oldest sample */
-		group.loadsum -= group.loads[g.sample];
-		/* update current sample */
-		group.loads[g.sample] = group.load;
-		/* add current sample */
-		group.loadsum += group.loads[g.sample];
-		/* reset current group load for next cycle */
-		group.load = Max<mhz_t>{0};
+		/* wait for the workers */
+		std::unique_lock<std::mutex> lock{this->mtx};
+		this->done.wait(lock, [this]() { return !this->busy; });
+		if (!error) { error = this->error; }
+		this->error = nullptr;
+		if (error) { std::rethrow_exception(error); }
 	}
-
-	Load && (g.sample = (g.sample + 1) % g.samples);
-}
+};
 
 /**
- * Do nada if neither load nor temperature are to be updated.
+ * Initialise the statistics region.
+ *
+ * The magic number is set last, so readers only accept the region
+ * after all static fields were set.
+ *
+ * @param shm
+ *	The zero filled shared memory to initialise
  */
-template <> void update_loads<0, 0>() {}
+void init_stats(sys::shm::Mapping const & shm) {
+	assert(shm.size() >= stats::size(g.ngroups));
+	auto & header = *new (shm.get<void>()) stats::Header;
+	stats::put(header.version, stats::VERSION);
+	stats::put(header.gsize, sizeof(stats::Group));
+	stats::put(header.ngroups, g.ngroups);
+	stats::put(header.pid, getpid());
+	for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
+		auto const & group = g.groups[groupi];
+		auto & entry = *new (&stats::group(header, sizeof(stats::Group),
+		                                   groupi)) stats::Group;
+		stats::put(entry.corei, group.corei);
+		stats::put(entry.coren, group.coren);
+		stats::put(entry.cls, to_value(group.cls));
+	}
+	header.magic.store(stats::MAGIC, std::memory_order_release);
+	g.shm = &header;
+}
 
 /**
- * Update the CPU clocks depending on the AC line state and targets.
+ * Publish the state of all core groups in the statistics region.
  *
- * @tparam Foreground
- *	Set for foreground operation (reporting on std::cout)
- * @tparam Temperature
- *	Set for temperature based throttling
- * @tparam Fixed
- *	Set for fixed frequency mode
+ * Only performs memory writes, so readers cannot slow down the
+ * control loop.
+ *
+ * @param acline
+ *	The AC line state index of the current poll
  * @param acstate
  *	The set of acline dependent variables
  */
-template <bool Foreground, bool Temperature, bool Fixed>
-void update_freq(Global::ACSet const & acstate) {
-	update_loads<(!Fixed || Foreground), Temperature>();
-
-	assert(g.groups);
+void publish(unsigned int const acline, Global::ACSet const & acstate) {
+	assert(g.shm);
+	auto & header = *g.shm;
+	stats::Writer const lock{header};
+	stats::put(header.polls,
+	           header.polls.load(std::memory_order_relaxed) + 1);
+	stats::put(header.acline, acline);
+	stats::put(header.target, acstate.target_load);
+	stats::put(header.interval, g.interval.count());
+	stats::put(header.throttling, g.temp_throttling);
+	for (size_t i = 0; i < countof(g.profile); ++i) {
+		stats::put(header.profile[i], g.profile[i]);
+	}
 	for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
-		auto & group = g.groups[groupi];
-
-		/* determine target frequency */
-		auto const max = std::min<mhz_t>(group.max, acstate.freq_max);
-		auto const min = std::max<mhz_t>(group.min, acstate.freq_min);
-		mhz_t wantfreq{0};
-		if (!Fixed) {
-			/* adaptive frequency mode */
-			wantfreq = group.loadsum / g.samples *
-			           1024 / acstate.target_load;
-		} else {
-			/* fixed frequency mode */
-			/*
-			 * Do not distinguish between newfreq and
-			 * wantfreq in this mode, because users might
-			 * be disturbed by seeing a 1THz target.
-			 */
-			wantfreq = acstate.target_freq;
-		}
-		Min<mhz_t> newfreq{max};
-		newfreq = std::max(min, wantfreq);
-		/* apply temperature throttling */
-		if (Temperature) {
-			if (group.temp >= group.temp_crit) {
-				newfreq = group.min;
-			} else if (group.temp > group.temp_high) {
-				auto const tempdiff  = group.temp_crit - group.temp;
-				auto const temprange = group.temp_crit - group.temp_high;
-				mhz_t const tempfreq = group.max * tempdiff / temprange;
-				newfreq = std::max<mhz_t>(tempfreq, group.min);
-			}
-		}
-		/* update CPU frequency */
-		if (group.sample_freq != newfreq) {
-			group.freq = newfreq;
-		}
-		/* foreground output */
-		if (Foreground && Temperature) {
-			io::fout.printf("power: %7s, load: %4d MHz, %3d C, cpu.%d.freq: %4d MHz, wanted: %4d MHz\n",
-			                acstate.name,
-			                (group.loadsum / g.samples),
-			                celsius(group.temp), group.corei,
-			                group.sample_freq, wantfreq);
-		} else if (Foreground) {
-			io::fout.printf("power: %7s, load: %4d MHz, cpu.%d.freq: %4d MHz, wanted: %4d MHz\n",
-			                acstate.name,
-			                (group.loadsum / g.samples), group.corei,
-			                group.sample_freq, wantfreq);
-		}
+		auto const & group = g.groups[groupi];
+		auto & entry = stats::group(header, sizeof(stats::Group), groupi);
+		stats::put(entry.load, group.filtered);
+		stats::put(entry.loadsum, group.loadsum);
+		stats::put(entry.wanted, group.wanted);
+		stats::put(entry.freq, group.sample_freq);
+		stats::put(entry.temp, g.temp_throttling ? group.temp : 0);
+		stats::put(entry.writes, group.writes);
+		stats::put(entry.suppressed, group.suppressed);
 	}
-	if (Foreground) { io::fout.flush(); }
 }
 
 /**
- * Dispatch update_freq<>().
+ * Update the clock frequencies of all core groups.
+ *
+ * @param workers
+ *	The worker threads to update the core group shards with
  */
-void update_freq() {
+void update_freq(Workers & workers) {
+	using std::chrono::duration_cast;
+	using std::chrono::steady_clock;
+	auto const start = steady_clock::now();
+
 	/* get AC line status */
 	auto const acline = to_value<AcLineState>(
-	    Once{AcLineState::UNKNOWN, g.acline_ctl});
+	    g.acline.get(AcLineState::UNKNOWN));
 	auto const & acstate = g.acstates[acline];
 
 	assert(acstate.target_load <= 1024 &&
 	       "load target must be in the range [0, 1024]");
 
-	switch ((g.foreground << 2) | (g.temp_throttling << 1) |
-	        (acstate.target_load == 0)) {
-	case 0b000:
-		return update_freq<0, 0, 0>(acstate);
-	case 0b001:
-		return update_freq<0, 0, 1>(acstate);
-	case 0b010:
-		return update_freq<0, 1, 0>(acstate);
-	case 0b011:
-		return update_freq<0, 1, 1>(acstate);
-	case 0b100:
-		return update_freq<1, 0, 0>(acstate);
-	case 0b101:
-		return update_freq<1, 0, 1>(acstate);
-	case 0b110:
-		return update_freq<1, 1, 0>(acstate);
-	case 0b111:
-		return update_freq<1, 1, 1>(acstate);
+	/* loads are only sampled in adaptive or foreground mode */
+	bool const load = acstate.target_load || g.foreground;
+	if (load) {
+		update_times();
+		prepare_filter();
 	}
-
-	assert(false && "update_freq<>() was not dispatched");
+	unsigned long reads{1u + load}, writes{0};
+	if (g.temp_throttling) { reads += update_temps(); }
+	auto const sampled = steady_clock::now();
+
+	workers(select_update(acstate), acstate);
+
+	/* collect shard results */
+	Max<cptime_t> change{0};
+	Max<us> loadtime{us{0}}, updatetime{us{0}};
+	for (coreid_t shardi = 0; shardi < g.nshards; ++shardi) {
+		auto const & shard = g.shards[shardi];
+		change = shard.change;
+		reads += shard.reads;
+		writes += shard.writes;
+		loadtime = shard.loadtime;
+		updatetime = shard.updatetime;
+	}
+	if (load) { commit_filter(change); }
+
+	/* self-profiling, shards are updated concurrently, so only
+	 * the slowest shard counts */
+	auto & profile = g.profile;
+	loadtime = us{loadtime} + duration_cast<us>(sampled - start);
+	stats::add(profile[to_value(Profile::LOADS)], us{loadtime}.count());
+	stats::add(profile[to_value(Profile::UPDATE)], us{updatetime}.count());
+	stats::add(profile[to_value(Profile::READS)], reads);
+	stats::add(profile[to_value(Profile::WRITES)], writes);
+	stats::add(profile[to_value(Profile::CYCLE)],
+	           duration_cast<us>(steady_clock::now() - start).count());
+
+	if (g.shm) { publish(acline, acstate); }
+	if (g.foreground) { io::fout.flush(); }
 }
 
 /**
@@ -848,11 +2505,23 @@ void update_freq() {
  */
 void init_loads() {
 	/* call it once to initialise its internal state */
-	update_loads();
+	update_times();
+	for (coreid_t shardi = 0; shardi < g.nshards; ++shardi) {
+		update_loads(g.shards[shardi]);
+	}
+
+	/* fill the sample time buffers */
+	for (auto & cls : g.classes) {
+		cls.weightsum = 0;
+		for (size_t i = 0; i < cls.samples; ++i) {
+			cls.weights[i] = sample_weight();
+			cls.weightsum += cls.weights[i];
+		}
+	}
 
 	/* get AC line status */
 	auto const acline = to_value<AcLineState>(
-	    Once{AcLineState::UNKNOWN, g.acline_ctl});
+	    g.acline.get(AcLineState::UNKNOWN));
 	auto const & acstate = g.acstates[acline];
 
 	/* fill the load buffer for each core */
@@ -860,15 +2529,21 @@ void init_loads() {
 	assert(g.groups);
 	for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
 		auto & group = g.groups[groupi];
+		auto const & cls = g.classes[to_value(group.cls)];
 
 		/* recalculate target load for controlling groups */
-		load = group.sample_freq * acstate.target_load / 1024;
+		load = group.sample_freq * target_load(group, acstate) / 1024;
+
+		/* discard the first sample, it covers the time since boot */
+		group.load = Max<mhz_t>{0};
 
-		/* apply target load to the whole sample buffer */
-		for (size_t i = 0; i < g.samples; ++i) {
-			group.loadsum -= group.loads[i];
-			group.loadsum += load;
+		/* apply target load to the filter state */
+		group.filtered = load;
+		group.ewma = ms::rep{load} * 1024;
+		group.loadsum = 0;
+		for (size_t i = 0; group.loads && i < cls.samples; ++i) {
 			group.loads[i] = load;
+			group.loadsum += group.loads[i] * cls.weights[i];
 		}
 	}
 }
@@ -951,6 +2626,54 @@ void set_mode(AcLineState const line, char const * const str) {
 	fail(Exit::EMODE, 0, "mode not recognised: "s + str);
 }
 
+/**
+ * Selects the load filter.
+ *
+ * The string must be in the following format:
+ *
+ * \verbatim
+ * filter = "mean" | "ewma" | "max" | "median" | "p", percentile | "holt";
+ * \endverbatim
+ *
+ * The percentile must be an integer in the range [0, 100], the
+ * median is the 50th percentile.
+ *
+ * @param str
+ *	A filter string
+ */
+void set_filter(char const * const str) {
+	std::string filter{str};
+	for (char & ch : filter) { ch = std::tolower(ch); }
+
+	if (filter == "median") {
+		g.filter = Filter::PERCENTILE;
+		g.percentile = 50;
+		return;
+	}
+	for (size_t i = 0; i < countof(FilterStr); ++i) {
+		if (filter == FilterStr[i] && i != to_value(Filter::PERCENTILE)) {
+			g.filter = static_cast<Filter>(i);
+			return;
+		}
+	}
+
+	if (filter.size() > 1 && filter[0] == 'p') {
+		char * end = nullptr;
+		auto const percentile = strtol(filter.c_str() + 1, &end, 10);
+		if (!*end) {
+			if (percentile < 0 || percentile > 100) {
+				fail(Exit::EOUTOFRANGE, 0,
+				     "percentile must be in the range [0, 100]");
+			}
+			g.filter = Filter::PERCENTILE;
+			g.percentile = percentile;
+			return;
+		}
+	}
+
+	fail(Exit::EFILTER, 0, "load filter not recognised: "s + str);
+}
+
 /**
  * An enum for command line parsing.
  */
@@ -970,12 +2693,34 @@ enum class OE {
 	HITEMP_RANGE,    /**< Set a high temperature range */
 	MODE_UNKNOWN,    /**< Set unknown power source mode */
 	TEMP_CTL,        /**< Override temperature sysctl */
+	IVAL_TEMP,       /**< Set temperature sampling interval */
 	IVAL_POLL,       /**< Set polling interval */
+	IVAL_POLL_RANGE, /**< Set adaptive polling interval range */
 	FILE_PID,        /**< Set pidfile */
+	FILE_CONFIG,     /**< Set configuration file */
+	FILE_ROOT,       /**< Set the platform file system root */
 	FLAG_VERBOSE,    /**< Activate verbose output on stderr */
 	FLAG_FOREGROUND, /**< Stay in foreground, log events to stdout */
 	FLAG_NICE,       /**< Treat nice time as idle */
 	CNT_SAMPLES,     /**< Set number of load samples */
+	LOAD_HYSTERESIS, /**< Set hysteresis band */
+	IVAL_DWELL,      /**< Set minimum time between frequency updates */
+	FLAG_SNAP,       /**< Snap to frequency levels */
+	FILTER,          /**< Set load filter */
+	CNT_THREADS,     /**< Set number of update threads */
+	FLAG_STATS,      /**< Publish statistics in shared memory */
+	GAINS,           /**< Set PI controller gains */
+	GAINS_AC,        /**< Set PI controller gains on AC power */
+	GAINS_BATT,      /**< Set PI controller gains on battery power */
+	EPP_RANGE,       /**< Set energy/performance preference range */
+	EPP_RANGE_AC,    /**< Set preference range on AC power */
+	EPP_RANGE_BATT,  /**< Set preference range on battery power */
+	LOAD_PERF,       /**< Set performance core load target */
+	LOAD_EFF,        /**< Set efficiency core load target */
+	FREQ_RANGE_PERF, /**< Set performance core clock frequency range */
+	FREQ_RANGE_EFF,  /**< Set efficiency core clock frequency range */
+	SAMPLES_PERF,    /**< Set number of performance core load samples */
+	SAMPLES_EFF,     /**< Set number of efficiency core load samples */
 	IGNORE,          /**< Legacy settings */
 	OPT_UNKNOWN,     /**< Obligatory */
 	OPT_NOOPT,       /**< Obligatory */
@@ -987,7 +2732,7 @@ enum class OE {
 /**
  * The short usage string.
  */
-char const * const USAGE = "[-hvfN] [-abn mode] [-mM freq] [-FAB freq:freq] [-H temp:temp] [-t sysctl] [-p ival] [-s cnt] [-P file]";
+char const * const USAGE = "[-hvfN] [-abn mode] [-mM freq] [-FAB freq:freq] [-H temp:temp] [-t sysctl] [--temp-interval ival] [-p ival] [--poll-range ival:ival] [-s cnt] [--filter filter] [--pi gain:gain] [--epp-range epp:epp] [--perf-load load] [--eff-load load] [--perf-freq-range freq:freq] [--eff-freq-range freq:freq] [--perf-samples cnt] [--eff-samples cnt] [--hysteresis load] [--dwell ival] [--snap] [--threads cnt] [--stats] [--config file] [--root dir] [-P file]";
 
 /**
  * Definitions of command line parameters.
@@ -1011,8 +2756,30 @@ Parameter<OE> const PARAMETERS[]{
 	{OE::FREQ_RANGE_BATT, 'B', "freq-range-batt", "freq:freq", "CPU frequency range on battery power"},
 	{OE::HITEMP_RANGE,    'H', "hitemp-range",    "temp:temp", "High temperature range (high:critical)"},
 	{OE::TEMP_CTL,        't', "temperature",     "sysctl",    "Override temperature source sysctl"},
+	{OE::IVAL_TEMP,        0 , "temp-interval",   "ival",      "The temperature sampling interval"},
 	{OE::IVAL_POLL,       'p', "poll",            "ival",      "The polling interval"},
+	{OE::IVAL_POLL_RANGE,  0 , "poll-range",      "ival:ival", "Adaptive polling interval range (min:max)"},
 	{OE::CNT_SAMPLES,     's', "samples",         "cnt",       "The number of samples to use"},
+	{OE::FILTER,           0 , "filter",          "filter",    "The load filter (mean|ewma|max|median|p<n>|holt)"},
+	{OE::GAINS,            0 , "pi",              "gain:gain", "PI controller gains (kp:ki)"},
+	{OE::GAINS_AC,         0 , "pi-ac",           "gain:gain", "PI controller gains on AC power"},
+	{OE::GAINS_BATT,       0 , "pi-batt",         "gain:gain", "PI controller gains on battery power"},
+	{OE::EPP_RANGE,        0 , "epp-range",       "epp:epp",   "Energy/performance preference range (min:max)"},
+	{OE::EPP_RANGE_AC,     0 , "epp-range-ac",    "epp:epp",   "Energy/performance preference range on AC power"},
+	{OE::EPP_RANGE_BATT,   0 , "epp-range-batt",  "epp:epp",   "Energy/performance preference range on battery power"},
+	{OE::LOAD_PERF,        0 , "perf-load",       "load",      "Load target of performance cores"},
+	{OE::LOAD_EFF,         0 , "eff-load",        "load",      "Load target of efficiency cores"},
+	{OE::FREQ_RANGE_PERF,  0 , "perf-freq-range", "freq:freq", "CPU frequency range of performance cores"},
+	{OE::FREQ_RANGE_EFF,   0 , "eff-freq-range",  "freq:freq", "CPU frequency range of efficiency cores"},
+	{OE::SAMPLES_PERF,     0 , "perf-samples",    "cnt",       "The number of samples for performance cores"},
+	{OE::SAMPLES_EFF,      0 , "eff-samples",     "cnt",       "The number of samples for efficiency cores"},
+	{OE::LOAD_HYSTERESIS,  0 , "hysteresis",      "load",      "Suppress smaller relative frequency changes"},
+	{OE::IVAL_DWELL,       0 , "dwell",           "ival",      "Minimum time between frequency changes"},
+	{OE::FLAG_SNAP,        0 , "snap",            "",          "Snap to the available frequency levels"},
+	{OE::CNT_THREADS,      0 , "threads",         "cnt",       "The number of threads updating core groups"},
+	{OE::FLAG_STATS,       0 , "stats",           "",          "Publish statistics in shared memory"},
+	{OE::FILE_CONFIG,      0 , "config",          "file",      "Read additional arguments from file"},
+	{OE::FILE_ROOT,        0 , "root",            "dir",       "The platform file system root"},
 	{OE::FILE_PID,        'P', "pid",             "file",      "Alternative PID file"},
 	{OE::IGNORE,          'i', "",                "load",      "Ignored"},
 	{OE::IGNORE,          'r', "",                "load",      "Ignored"}
@@ -1030,6 +2797,8 @@ void read_args(int const argc, char const * const argv[]) {
 	auto & ac_on = g.acstates[to_value(AcLineState::ONLINE)];
 	auto & ac_batt = g.acstates[to_value(AcLineState::BATTERY)];
 	auto & ac_unknown = g.acstates[to_value(AcLineState::UNKNOWN)];
+	auto & perf = g.classes[to_value(CoreClass::PERFORMANCE)];
+	auto & eff = g.classes[to_value(CoreClass::EFFICIENCY)];
 
 	try {
 		while (true) switch (getopt()) {
@@ -1043,7 +2812,7 @@ void read_args(int const argc, char const * const argv[]) {
 			g.foreground = true;
 			break;
 		case OE::FLAG_NICE:
-			g.idleStates[CP_NICE] = true;
+			g.idleMask[CP_NICE] = ~cptime_t{0};
 			break;
 		case OE::MODE_AC:
 			set_mode(AcLineState::ONLINE, getopt[1]);
@@ -1090,17 +2859,90 @@ void read_args(int const argc, char const * const argv[]) {
 			    range(temperature, getopt[1]);
 			break;
 		case OE::TEMP_CTL:
-			g.tempctl_name = formatfields(sysctlname(getopt[1]), 'd');
+			g.tempctl_name = formatfields(platform::sourcename(getopt[1]), 'd');
+			break;
+		case OE::IVAL_TEMP:
+			g.temp_interval = ival(getopt[1]);
 			break;
 		case OE::IVAL_POLL:
 			g.interval = ival(getopt[1]);
 			break;
+		case OE::IVAL_POLL_RANGE:
+			std::tie(g.interval_min, g.interval_max) =
+			    range(ival, getopt[1]);
+			break;
 		case OE::CNT_SAMPLES:
 			g.samples = samples(getopt[1]);
 			break;
+		case OE::FILTER:
+			set_filter(getopt[1]);
+			break;
+		case OE::GAINS:
+			std::tie(ac_unknown.kp, ac_unknown.ki) =
+			    range(gain, getopt[1]);
+			break;
+		case OE::GAINS_AC:
+			std::tie(ac_on.kp, ac_on.ki) = range(gain, getopt[1]);
+			break;
+		case OE::GAINS_BATT:
+			std::tie(ac_batt.kp, ac_batt.ki) = range(gain, getopt[1]);
+			break;
+		case OE::EPP_RANGE:
+			std::tie(ac_unknown.epp_min, ac_unknown.epp_max) =
+			    range(epp, getopt[1]);
+			break;
+		case OE::EPP_RANGE_AC:
+			std::tie(ac_on.epp_min, ac_on.epp_max) =
+			    range(epp, getopt[1]);
+			break;
+		case OE::EPP_RANGE_BATT:
+			std::tie(ac_batt.epp_min, ac_batt.epp_max) =
+			    range(epp, getopt[1]);
+			break;
+		case OE::LOAD_PERF:
+			perf.target_load = load(getopt[1]);
+			break;
+		case OE::LOAD_EFF:
+			eff.target_load = load(getopt[1]);
+			break;
+		case OE::FREQ_RANGE_PERF:
+			std::tie(perf.freq_min, perf.freq_max) =
+			    range(freq, getopt[1]);
+			break;
+		case OE::FREQ_RANGE_EFF:
+			std::tie(eff.freq_min, eff.freq_max) =
+			    range(freq, getopt[1]);
+			break;
+		case OE::SAMPLES_PERF:
+			perf.samples = samples(getopt[1]);
+			break;
+		case OE::SAMPLES_EFF:
+			eff.samples = samples(getopt[1]);
+			break;
+		case OE::LOAD_HYSTERESIS:
+			g.hysteresis = load(getopt[1]);
+			break;
+		case OE::IVAL_DWELL:
+			g.dwell = ival(getopt[1]);
+			break;
+		case OE::FLAG_SNAP:
+			g.snap = true;
+			break;
+		case OE::CNT_THREADS:
+			g.threads = threads(getopt[1]);
+			break;
+		case OE::FLAG_STATS:
+			g.stats = true;
+			break;
+		case OE::FILE_ROOT:
+			g.rootdir = getopt[1];
+			break;
 		case OE::FILE_PID:
 			g.pidfilename = getopt[1];
 			break;
+		case OE::FILE_CONFIG:
+			g.configfile = getopt[1];
+			break;
 		case OE::IGNORE:
 			/* for compatibility with powerd, ignore */
 			break;
@@ -1122,6 +2964,66 @@ void read_args(int const argc, char const * const argv[]) {
 	}
 }
 
+/**
+ * Parse the arguments in the configuration file.
+ *
+ * The file contains command line arguments separated by white space,
+ * a `#` starts a comment that lasts until the end of the line.
+ *
+ * @return
+ *	The buffer holding the arguments, it must outlive all references
+ *	to argument strings, nullptr if there is no configuration file
+ */
+std::unique_ptr<char[]> read_config() {
+	if (!g.configfile) {
+		return nullptr;
+	}
+
+	/* read the file */
+	std::string content;
+	{
+		io::file<io::own, io::read> file{g.configfile, "r"};
+		if (!file) {
+			fail(Exit::EROPEN, errno,
+			     "could not open file for reading: "s + g.configfile);
+		}
+		char chunk[4096];
+		for (size_t count; (count = file.read(chunk, sizeof(chunk)));) {
+			content.append(chunk, count);
+		}
+		if (file.error()) {
+			fail(Exit::EROPEN, errno,
+			     "could not read file: "s + g.configfile);
+		}
+	}
+
+	/* split into arguments in place */
+	std::unique_ptr<char[]> buf{new char[content.size() + 1]{}};
+	std::copy(content.begin(), content.end(), buf.get());
+	std::vector<char const *> args{g.argv[0]};
+	bool comment{false};
+	for (size_t i = 0; i < content.size(); ++i) {
+		char & ch = buf[i];
+		comment = (comment && ch != '\n') || ch == '#';
+		if (comment || std::isspace(static_cast<unsigned char>(ch))) {
+			ch = 0;
+		} else if (i == 0 || buf[i - 1] == 0) {
+			args.push_back(&ch);
+		}
+	}
+	args.push_back(nullptr);
+
+	try {
+		read_args(args.size() - 1, args.data());
+	} catch (Exception & e) {
+		if (e.msg != "") {
+			e.msg = g.configfile + ": "s + e.msg;
+		}
+		throw;
+	}
+	return buf;
+}
+
 /**
  * Prints the configuration on stderr in verbose mode.
  */
@@ -1132,14 +3034,31 @@ void show_settings() {
 	io::ferr.printf("Terminal Output\n"
 	                "\tverbose:               yes\n"
 	                "\tforeground:            %s\n"
+	                "\tstatistics:            %s\n"
 	                "Load Sampling\n"
-	                "\tload samples:          %d\n"
-	                "\tpolling interval:      %d ms\n"
-	                "\tload average over:     %d ms\n"
-	                "Frequency Limits\n",
+	                "\tload samples:          %d\n",
 	                g.foreground ? "yes" : "no",
-	                g.samples, g.interval.count(),
-	                g.samples * g.interval.count());
+	                g.stats ? stats::NAME : "no", g.samples);
+	if (g.filter == Filter::PERCENTILE) {
+		io::ferr.printf("\tload filter:           %s %d %%\n",
+		                FilterStr[to_value(g.filter)], g.percentile);
+	} else {
+		io::ferr.printf("\tload filter:           %s\n",
+		                FilterStr[to_value(g.filter)]);
+	}
+	if (g.interval_min < g.interval_max) {
+		io::ferr.printf("\tpolling interval:      [%d ms, %d ms]\n"
+		                "\tload average over:     [%d ms, %d ms]\n",
+		                g.interval_min.count(), g.interval_max.count(),
+		                g.samples * g.interval_min.count(),
+		                g.samples * g.interval_max.count());
+	} else {
+		io::ferr.printf("\tpolling interval:      %d ms\n"
+		                "\tload average over:     %d ms\n",
+		                g.interval.count(),
+		                g.samples * g.interval.count());
+	}
+	io::ferr.print("Frequency Limits\n");
 	for (auto const & acstate : g.acstates) {
 		io::ferr.printf("\t%-22s [%d MHz, %d MHz]\n",
 		                (""s + acstate.name + ':').c_str(),
@@ -1149,11 +3068,25 @@ void show_settings() {
 	                "\tCPU cores:             %d\n"
 	                "Core Groups\n", g.ncpu);
 	assert(g.groups && g.ngroups);
-	for (coreid_t gid = 0, b = 0, e = 1; e <= g.ncpu; ++e) {
-		if (e == g.ncpu || g.cores[b].group != g.cores[e].group) {
-			io::ferr.printf("\t%3d:                   [%d, %d]\n", gid++, b, e - 1);
-			b = e;
+	for (coreid_t i = 0; i < g.ngroups; ++i) {
+		auto const & group = g.groups[i];
+		io::ferr.printf("\t%3d: cpu.%-3d           ", i, group.corei);
+		/* print contiguous ranges of cores */
+		coreid_t const * const members = &g.members[group.membersi];
+		for (coreid_t first = 0, last = 0; first < group.coren;
+		     first = ++last) {
+			for (; last + 1 < group.coren &&
+			       members[last + 1] == members[last] + 1; ++last);
+			io::ferr.printf(" [%d, %d]", members[first], members[last]);
 		}
+		io::ferr.printf(" %s%s\n", g.classes[to_value(group.cls)].name,
+		                group.eppctl ? ", epp" : "");
+	}
+	io::ferr.print("Core Group Shards\n");
+	for (coreid_t i = 0; i < g.nshards; ++i) {
+		auto const & shard = g.shards[i];
+		io::ferr.printf("\t%3d:                   [%d, %d]\n", i,
+		                shard.first, shard.last - 1);
 	}
 	io::ferr.print("Core Group Frequency Limits\n");
 	for (coreid_t i = 0; i < g.ngroups; ++i) {
@@ -1170,15 +3103,52 @@ void show_settings() {
 			io::ferr.printf(" %4d MHz\n", acstate.target_freq);
 		}
 	}
+	io::ferr.print("Core Classes\n");
+	for (auto const & cls : g.classes) {
+		io::ferr.printf("\t%-22s %d samples, [%d MHz, %d MHz],",
+		                (""s + cls.name + ':').c_str(), cls.samples,
+		                cls.freq_min, cls.freq_max);
+		if (cls.target_load) {
+			io::ferr.printf(" %2d %% load\n", (cls.target_load * 100 + 512) / 1024);
+		} else {
+			io::ferr.print(" power target\n");
+		}
+	}
+	io::ferr.print("Energy/Performance Preferences\n");
+	for (auto const & acstate : g.acstates) {
+		io::ferr.printf("\t%-22s [%d, %d]\n",
+		                (""s + acstate.name + ':').c_str(),
+		                acstate.epp_min, acstate.epp_max);
+	}
+	io::ferr.print("PI Controller Gains\n");
+	for (auto const & acstate : g.acstates) {
+		io::ferr.printf("\t%-22s",
+		                (""s + acstate.name + " power gains:").c_str());
+		if (acstate.ki) {
+			io::ferr.printf(" [%.3f, %.3f]\n",
+			                acstate.kp / 1024., acstate.ki / 1024.);
+		} else {
+			io::ferr.print(" off\n");
+		}
+	}
+	io::ferr.printf("Frequency Updates\n"
+	                "\thysteresis:            %d %%\n"
+	                "\tdwell time:            %d ms\n"
+	                "\tsnap to levels:        %s\n",
+	                (g.hysteresis * 100 + 512) / 1024, g.dwell.count(),
+	                g.snap ? "yes" : "no");
 	io::ferr.print("Temperature Throttling\n");
 	if (g.temp_throttling) {
 		io::ferr.printf("\tactive:                yes\n"
-		                "\tsource:                %s\n", g.tempctl_name);
+		                "\tsource:                %s\n"
+		                "\tsampling interval:     %d ms\n",
+		                g.tempctl_name, g.temp_interval.count());
 		for (coreid_t i = 0; i < g.ngroups; ++i) {
 			auto const & group = g.groups[i];
-			io::ferr.printf("\t%3d:                   [%d C, %d C]\n",
+			io::ferr.printf("\t%3d:                   [%d C, %d C], sensor core %d\n",
 			                i, celsius(group.temp_high),
-			                celsius(group.temp_crit));
+			                celsius(group.temp_crit),
+			                g.sensors[group.sensori].core);
 		}
 	} else {
 		io::ferr.print("\tactive:                no\n");
@@ -1192,6 +3162,9 @@ void show_settings() {
  *
  * - Upon creation it reads and writes all controlling cores
  * - Upon destruction it sets all cores to the maximum frequencies
+ *
+ * Groups in energy/performance preference mode have their preference
+ * guarded instead of the clock frequency.
  */
 class FreqGuard final {
 	private:
@@ -1200,25 +3173,38 @@ class FreqGuard final {
 	 */
 	std::unique_ptr<mhz_t[]> freqs;
 
+	/**
+	 * The list of initial energy/performance preferences.
+	 */
+	std::unique_ptr<epp_t[]> epps;
+
 	public:
 	/**
 	 * Read and write all core frequencies, may throw.
 	 */
-	FreqGuard() : freqs{new mhz_t[g.ngroups]} {
+	FreqGuard() : freqs{new mhz_t[g.ngroups]}, epps{new epp_t[g.ngroups]} {
 		assert(g.groups);
 		for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
 			auto & group = g.groups[groupi];
 			try {
+				if (group.eppctl) {
+					/* remember the preference */
+					this->epps[groupi] = group.epp;
+					/* attempt preference write */
+					group.epp = this->epps[groupi];
+					group.eppval = this->epps[groupi];
+					continue;
+				}
 				/* remember clock frequency */
 				this->freqs[groupi] = group.freq;
 				/* attempt clock frequency write */
 				group.freq = this->freqs[groupi];
-			} catch (sys::sc_error<sys::ctl::error> e) {
+			} catch (sys::sc_error<platform::error> e) {
 				if (EPERM == e) {
 					fail(Exit::EFORBIDDEN, e,
 					     "insufficient privileges to change core frequency");
 				} else {
-					sysctl_fail(e);
+					platform_fail(e);
 				}
 			}
 		}
@@ -1231,8 +3217,12 @@ class FreqGuard final {
 		for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
 			auto & group = g.groups[groupi];
 			try {
-				group.freq = this->freqs[groupi];
-			} catch (sys::sc_error<sys::ctl::error>) {
+				if (group.eppctl) {
+					group.epp = this->epps[groupi];
+				} else {
+					group.freq = this->freqs[groupi];
+				}
+			} catch (sys::sc_error<platform::error>) {
 				/* do nada */
 			}
 		}
@@ -1249,6 +3239,161 @@ void signal_recv(int signal) {
 	g.signal = signal;
 }
 
+/**
+ * Sets g.reload, called by signal handlers.
+ *
+ * @param signal
+ *	The signal number received
+ */
+void signal_reload(int signal) {
+	g.reload = signal;
+}
+
+/**
+ * Resize a load sample ring buffer.
+ *
+ * The most recent samples are kept, if the buffer grows the oldest
+ * sample is repeated. The oldest sample of the new buffer is at
+ * index 0.
+ *
+ * @tparam T
+ *	The sample type
+ * @param ring
+ *	The ring buffer
+ * @param size
+ *	The number of samples in the ring buffer
+ * @param next
+ *	The index of the oldest sample in the ring buffer
+ * @param samples
+ *	The number of samples in the new buffer
+ * @return
+ *	The new buffer
+ */
+template <typename T>
+std::unique_ptr<T[]> resize_samples(T const * const ring,
+                                    size_t const size, size_t const next,
+                                    size_t const samples) {
+	std::unique_ptr<T[]> result{new T[samples]{}};
+	for (size_t i = 0; i < samples; ++i) {
+		/* the age of the sample, 1 is the most recent one */
+		size_t const age = std::min(samples - i, size);
+		result[i] = ring[(next + size - age) % size];
+	}
+	return result;
+}
+
+/**
+ * Reload the configuration.
+ *
+ * The command line and configuration file arguments are parsed
+ * again, starting from the default settings. Only the settings
+ * captured by Settings are changed, all other arguments keep
+ * their initial values.
+ *
+ * The load sample windows keep the most recent load history.
+ *
+ * If the new configuration is invalid, the current settings are
+ * kept.
+ */
+void reload() {
+	verbose("reloading configuration: %s\n", g.configfile);
+
+	/* settings that cannot change at run time */
+	auto const fixed = std::make_tuple(
+	    g.verbose, g.foreground, g.filter, g.percentile, g.threads,
+	    g.stats, g.pidfilename, g.tempctl_name, g.rootdir, g.configfile);
+
+	/* parse the new configuration */
+	Settings const current{};
+	bool hitemp{false};
+	try {
+		defaults.apply();
+		read_args(g.argc, g.argv);
+		auto const config = read_config();
+		init_settings();
+		hitemp = g.temp_throttling;
+	} catch (Exception & e) {
+		current.apply();
+		std::tie(g.verbose, g.foreground, g.filter, g.percentile,
+		         g.threads, g.stats, g.pidfilename, g.tempctl_name,
+		         g.rootdir, g.configfile) = fixed;
+		if (e.msg != "") {
+			io::ferr.printf("powerd++: %s\n", e.msg.c_str());
+		}
+		io::ferr.print("powerd++: configuration not reloaded\n");
+		return;
+	}
+	if (fixed != std::make_tuple(g.verbose, g.foreground, g.filter,
+	                             g.percentile, g.threads, g.stats,
+	                             g.pidfilename, g.tempctl_name,
+	                             g.rootdir, g.configfile)) {
+		std::tie(g.verbose, g.foreground, g.filter, g.percentile,
+		         g.threads, g.stats, g.pidfilename, g.tempctl_name,
+		         g.rootdir, g.configfile) = fixed;
+		verbose("settings that cannot change at run time are ignored\n");
+	}
+
+	/* apply user provided temperature throttling boundaries */
+	g.temp_throttling = current.temp_throttling;
+	if (hitemp && g.temp_throttling) {
+		for (coreid_t i = 0; i < g.ngroups; ++i) {
+			g.groups[i].temp_high = g.temp_high;
+			g.groups[i].temp_crit = g.temp_crit;
+		}
+	} else if (hitemp) {
+		verbose("temperature throttling cannot be activated at run time\n");
+	} else if (current.temp_crit) {
+		/* keep the user provided boundaries */
+		g.temp_high = current.temp_high;
+		g.temp_crit = current.temp_crit;
+		verbose("temperature throttling cannot be deactivated at run time\n");
+	}
+
+	/* resize the load sample windows */
+	Max<size_t> maxsamples{0};
+	for (size_t clsi = 0; clsi < countof(g.classes); ++clsi) {
+		auto & cls = g.classes[clsi];
+		auto const size = current.classes[clsi].samples;
+		maxsamples = cls.samples;
+		if (cls.samples == size) {
+			continue;
+		}
+		for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
+			auto & group = g.groups[groupi];
+			if (to_value(group.cls) != clsi || !group.loads) {
+				continue;
+			}
+			group.loads = resize_samples(group.loads.get(), size,
+			                             cls.sample, cls.samples);
+		}
+		cls.weights = resize_samples(cls.weights.get(), size,
+		                             cls.sample, cls.samples);
+		cls.sample = 0;
+		cls.weightsum = 0;
+		for (size_t i = 0; i < cls.samples; ++i) {
+			cls.weightsum += cls.weights[i];
+		}
+		for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
+			auto & group = g.groups[groupi];
+			if (to_value(group.cls) != clsi || !group.loads) {
+				continue;
+			}
+			group.loadsum = 0;
+			for (size_t i = 0; i < cls.samples; ++i) {
+				group.loadsum += group.loads[i] * cls.weights[i];
+			}
+		}
+	}
+	if (g.filter == Filter::PERCENTILE) {
+		for (coreid_t shardi = 0; shardi < g.nshards; ++shardi) {
+			g.shards[shardi].scratch = std::unique_ptr<mhz_t[]>{
+				new mhz_t[maxsamples]{}};
+		}
+	}
+
+	show_settings();
+}
+
 /**
  * Daemonise and run the main loop.
  */
@@ -1267,7 +3412,8 @@ void run_daemon() try {
 	/* setup signal handlers */
 	sys::sig::Signal sigint{SIGINT, signal_recv};
 	sys::sig::Signal sigterm{SIGTERM, signal_recv};
-	sys::sig::Signal sighup{SIGHUP, (g.foreground ? signal_recv : SIG_IGN)};
+	sys::sig::Signal sighup{SIGHUP, (g.configfile ? signal_reload :
+	                                 g.foreground ? signal_recv : SIG_IGN)};
 
 	/* write pid */
 	try {
@@ -1277,13 +3423,44 @@ void run_daemon() try {
 		     "cannot write to pidfile: "s += sanitise(g.pidfilename));
 	}
 
+	/* publish statistics */
+	std::optional<sys::shm::Mapping> shm;
+	if (g.stats) {
+		shm.emplace(stats::NAME, stats::size(g.ngroups), 0644);
+		init_stats(*shm);
+	}
+
+	/* start worker threads */
+	Workers workers;
+
 	/* the main loop */
-	timing::Cycle sleep;
-	while (!g.signal && sleep(g.interval)) {
-		update_freq();
+	platform::Cycle sleep;
+	while (!g.signal && (sleep(g.interval) || g.reload)) {
+		if (g.reload) {
+			g.reload = 0;
+			reload();
+			/* complete the interrupted cycle */
+			if (!sleep()) { continue; }
+		}
+		stats::add(g.profile[to_value(Profile::LATENESS)],
+		           std::max<us::rep>(sleep.late().count(), 0));
+		update_freq(workers);
 	}
 
 	verbose("signal %d received, exiting ...\n", g.signal);
+
+	/* report frequency update statistics */
+	unsigned long writes{0}, suppressed{0};
+	for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
+		writes += g.groups[groupi].writes;
+		suppressed += g.groups[groupi].suppressed;
+	}
+	verbose("frequency updates: %lu, suppressed: %lu\n",
+	        writes, suppressed);
+	if (g.verbose) {
+		stats::print(io::ferr, "powerd++: ", g.profile);
+	}
+	g.shm = nullptr;
 } catch (pid_t otherpid) {
 	fail(Exit::ECONFLICT, EEXIST,
 	     "a power daemon is already running under PID: %d"_fmt(otherpid));
@@ -1293,6 +3470,9 @@ void run_daemon() try {
 } catch (sys::sc_error<sys::sig::error> e) {
 	fail(Exit::ESIGNAL, e,
 	     "failed to register signal handler: "s + e.c_str());
+} catch (sys::sc_error<sys::shm::error> e) {
+	fail(Exit::ESHM, e,
+	     "cannot create statistics shared memory: "s + stats::NAME);
 }
 
 } /* namespace */
@@ -1307,7 +3487,10 @@ void run_daemon() try {
  * @see Exit
  */
 int main(int argc, char * argv[]) try {
+	g.argc = argc;
+	g.argv = argv;
 	read_args(argc, argv);
+	auto const config = read_config();
 	init();
 	show_settings();
 	init_loads();
@@ -1318,8 +3501,9 @@ int main(int argc, char * argv[]) try {
 		io::ferr.printf("powerd++: %s\n", e.msg.c_str());
 	}
 	return to_value(e.exitcode);
-} catch (sys::sc_error<sys::ctl::error> e) {
-	io::ferr.printf("powerd++: untreated sysctl failure: %s\n", e.c_str());
+} catch (sys::sc_error<platform::error> e) {
+	io::ferr.printf("powerd++: untreated %s failure: %s\n",
+	                platform::SOURCE, e.c_str());
 	return to_value(Exit::EEXCEPT);
 } catch (sys::sc_error<sys::pid::error> e) {
 	io::ferr.printf("powerd++: untreated pidfile failure: %s\n", e.c_str());
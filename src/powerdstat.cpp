@@ -0,0 +1,285 @@
+/**
+ * Implements powerdstat, a reader for the shared memory statistics
+ * published by powerd++.
+ *
+ * @file
+ */
+
+#include "Options.hpp"
+#include "Cycle.hpp"
+
+#include "types.hpp"
+#include "errors.hpp"
+#include "clas.hpp"
+#include "utility.hpp"
+#include "stats.hpp"
+
+#include "sys/shm.hpp"
+#include "sys/io.hpp"
+
+#include <memory>    /* std::unique_ptr */
+
+#include <csignal>   /* kill() */
+
+/**
+ * File local scope.
+ */
+namespace {
+
+using nih::Parameter;
+using nih::Options;
+
+using types::ms;
+
+using errors::Exit;
+using errors::Exception;
+using errors::fail;
+
+using clas::ival;
+using clas::celsius;
+
+using utility::to_value;
+using namespace utility::literals;
+using namespace std::literals::string_literals;
+
+namespace io = sys::io;
+
+/**
+ * The printable AC line states, in the order of stats::Header::acline.
+ */
+char const * const AcLineStr[]{"battery", "online", "unknown"};
+
+/**
+ * The printable core classes, in the order of stats::Group::cls.
+ */
+char const * const CoreClassStr[]{"performance", "efficiency"};
+
+/**
+ * The global state.
+ */
+struct {
+	/**
+	 * The output repetition interval, 0 for a single output.
+	 */
+	ms interval{0};
+
+	/**
+	 * Print the self-profiling histograms.
+	 */
+	bool verbose{false};
+} g;
+
+/**
+ * An enum for command line parsing.
+ */
+enum class OE {
+	USAGE,           /**< Print help */
+	FLAG_VERBOSE,    /**< Print self-profiling histograms */
+	IVAL_POLL,       /**< Set output interval */
+	OPT_UNKNOWN,     /**< Obligatory */
+	OPT_NOOPT,       /**< Obligatory */
+	OPT_DASH,        /**< Obligatory */
+	OPT_LDASH,       /**< Obligatory */
+	OPT_DONE         /**< Obligatory */
+};
+
+/**
+ * The short usage string.
+ */
+char const * const USAGE = "[-hv] [-p ival]";
+
+/**
+ * Definitions of command line parameters.
+ */
+Parameter<OE> const PARAMETERS[]{
+	{OE::USAGE,        'h', "help",    "",     "Show usage and exit"},
+	{OE::FLAG_VERBOSE, 'v', "verbose", "",     "Print the self-profiling histograms"},
+	{OE::IVAL_POLL,    'p', "poll",    "ival", "Repeat the output in this interval"},
+};
+
+/**
+ * Parse command line arguments.
+ *
+ * @param argc,argv
+ *	The command line arguments
+ */
+void read_args(int const argc, char const * const argv[]) {
+	auto getopt = Options{argc, argv, USAGE, PARAMETERS};
+
+	try {
+		while (true) switch (getopt()) {
+		case OE::USAGE:
+			io::ferr.printf("%s", getopt.usage().c_str());
+			throw Exception{Exit::OK, 0, ""};
+		case OE::FLAG_VERBOSE:
+			g.verbose = true;
+			break;
+		case OE::IVAL_POLL:
+			g.interval = ival(getopt[1]);
+			break;
+		case OE::OPT_UNKNOWN:
+		case OE::OPT_NOOPT:
+		case OE::OPT_DASH:
+		case OE::OPT_LDASH:
+			fail(Exit::ECLARG, 0,
+			     "unexpected command line argument: "s + getopt[0]);
+		case OE::OPT_DONE:
+			return;
+		}
+	} catch (Exception & e) {
+		switch (getopt) {
+		case OE::USAGE:
+			break;
+		case OE::FLAG_VERBOSE:
+			e.msg += "\n\n";
+			e.msg += getopt.show(0);
+			break;
+		case OE::IVAL_POLL:
+			e.msg += "\n\n";
+			e.msg += getopt.show(1);
+			break;
+		case OE::OPT_UNKNOWN:
+		case OE::OPT_NOOPT:
+		case OE::OPT_DASH:
+		case OE::OPT_LDASH:
+			e.msg += "\n\n";
+			e.msg += getopt.show(0);
+			break;
+		case OE::OPT_DONE:
+			return;
+		}
+		throw;
+	}
+}
+
+/**
+ * Validate the statistics region.
+ *
+ * @param shm
+ *	The mapped statistics region
+ * @return
+ *	The number of core groups in the region
+ */
+size_t validate(sys::shm::Mapping const & shm) {
+	if (shm.size() < sizeof(stats::Header)) {
+		fail(Exit::ESTATS, 0, "statistics region is truncated");
+	}
+	auto const & header = *shm.get<stats::Header const>();
+	auto const magic = header.magic.load(std::memory_order_acquire);
+	if (magic != stats::MAGIC) {
+		fail(Exit::ESTATS, 0,
+		     "statistics region is not initialised: "s + stats::NAME);
+	}
+	auto const version = header.version.load(std::memory_order_relaxed);
+	if (version != stats::VERSION) {
+		fail(Exit::ESTATS, 0,
+		     "unsupported statistics version: %u"_fmt(version));
+	}
+	size_t const gsize = header.gsize.load(std::memory_order_relaxed);
+	size_t const ngroups = header.ngroups.load(std::memory_order_relaxed);
+	if (gsize < sizeof(stats::Group) ||
+	    shm.size() < sizeof(stats::Header) + ngroups * gsize) {
+		fail(Exit::ESTATS, 0, "statistics region is truncated");
+	}
+	return ngroups;
+}
+
+/**
+ * Print a statistics snapshot.
+ *
+ * @param header
+ *	The header of the statistics region
+ * @param groups
+ *	A buffer for the core group snapshots
+ * @param ngroups
+ *	The number of core groups
+ */
+void print(stats::Header const & header, stats::GroupSample * const groups,
+           size_t const ngroups) {
+	stats::HeaderSample hs{};
+	if (!stats::snapshot(header, hs, groups, ngroups)) {
+		fail(Exit::ESTATS, 0, "no consistent statistics snapshot");
+	}
+	if (-1 == ::kill(hs.pid, 0) && errno == ESRCH) {
+		fail(Exit::ESTATS, 0,
+		     "the publishing process is gone: %d"_fmt(hs.pid));
+	}
+
+	io::fout.printf("pid: %d, polls: %ju, power: %s, interval: %u ms, ",
+	                hs.pid, uintmax_t{hs.polls},
+	                hs.acline < utility::countof(AcLineStr) ?
+	                AcLineStr[hs.acline] : "?", hs.interval);
+	if (hs.target) {
+		io::fout.printf("target load: %u%%\n", hs.target * 100 / 1024);
+	} else {
+		io::fout.print("fixed frequency\n");
+	}
+	io::fout.printf("%-9s %5s %-11s %9s %9s %9s %5s %12s %9s %10s\n",
+	                "group", "cores", "class", "load", "wanted",
+	                "freq", "temp", "loadsum", "writes", "suppressed");
+	for (size_t i = 0; i < ngroups; ++i) {
+		auto const & gs = groups[i];
+		io::fout.printf("cpu.%-5u %5u %-11s %5u MHz %5u MHz %5u MHz ",
+		                gs.corei, gs.coren,
+		                gs.cls < utility::countof(CoreClassStr) ?
+		                CoreClassStr[gs.cls] : "?",
+		                gs.load, gs.wanted, gs.freq);
+		if (hs.throttling) {
+			io::fout.printf("%3d C ", celsius(gs.temp));
+		} else {
+			io::fout.printf("%5s ", "-");
+		}
+		io::fout.printf("%12jd %9ju %10ju\n", intmax_t{gs.loadsum},
+		                uintmax_t{gs.writes}, uintmax_t{gs.suppressed});
+	}
+	if (g.verbose) {
+		stats::print(io::fout, "", hs.profile);
+	}
+	io::fout.flush();
+}
+
+/**
+ * Print the statistics once or repeatedly.
+ */
+void run() try {
+	sys::shm::Mapping const shm{stats::NAME};
+	auto const ngroups = validate(shm);
+	auto const & header = *shm.get<stats::Header const>();
+	std::unique_ptr<stats::GroupSample[]> groups{
+	    new stats::GroupSample[ngroups]};
+
+	print(header, groups.get(), ngroups);
+	timing::Cycle sleep;
+	while (g.interval.count() > 0 && sleep(g.interval)) {
+		io::fout.putc('\n');
+		print(header, groups.get(), ngroups);
+	}
+} catch (sys::sc_error<sys::shm::error> e) {
+	fail(Exit::ESHM, e,
+	     "cannot open statistics shared memory: "s + stats::NAME);
+}
+
+} /* namespace */
+
+/**
+ * Main routine, print the statistics, print errors.
+ *
+ * @param argc,argv
+ *	The command line arguments
+ * @return
+ *	An exit code
+ * @see Exit
+ */
+int main(int argc, char * argv[]) try {
+	read_args(argc, argv);
+	run();
+	return to_value(Exit::OK);
+} catch (Exception & e) {
+	if (e.msg != "") {
+		io::ferr.printf("powerdstat: %s\n", e.msg.c_str());
+	}
+	return to_value(e.exitcode);
+} catch (...) {
+	io::ferr.print("powerdstat: untreated failure\n");
+	return to_value(Exit::EEXCEPT);
+}
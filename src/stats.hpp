@@ -0,0 +1,606 @@
+/**
+ * Implements the shared memory statistics layout of powerd++.
+ *
+ * The statistics region starts with a Header, directly followed by
+ * one Group entry per core group:
+ *
+ * | Offset                     | Content                         |
+ * |----------------------------|---------------------------------|
+ * | 0                          | Header                          |
+ * | sizeof(Header)             | Group of the first core group   |
+ * | sizeof(Header) + n * gsize | Group of core group n           |
+ *
+ * The `gsize` is the Header::gsize value, so readers can skip fields
+ * appended to Group by later versions.
+ *
+ * Updates are protected by a sequence lock. The writer makes the
+ * Header::seq counter odd before it starts updating and even after
+ * it is done. A reader copies the region and retries if the counter
+ * was odd or changed while copying. Thus the writer never waits for
+ * readers and readers never block the writer.
+ *
+ * All fields are lock-free atomics, so concurrent access is well
+ * defined.
+ *
+ * The Header also carries the self-profiling histograms of the
+ * control loop, see Profile.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_STATS_HPP_
+#define _POWERDXX_STATS_HPP_
+
+#include <atomic>    /* std::atomic, std::atomic_thread_fence() */
+#include <cstdint>   /* uint32_t, uint64_t, int32_t, int64_t */
+#include <cstddef>   /* size_t */
+#include <algorithm> /* std::min() */
+
+/**
+ * Shared memory statistics.
+ */
+namespace stats {
+
+/**
+ * The name of the shared memory object.
+ */
+char const * const NAME = "/powerd++";
+
+/**
+ * The magic number identifying the statistics region, the string
+ * `powerd++` in little endian byte order.
+ */
+uint64_t const MAGIC{0x2b2b647265776f70};
+
+/**
+ * The layout version.
+ */
+uint32_t const VERSION{2};
+
+/**
+ * The template for plain, non-atomic fields.
+ *
+ * @tparam T
+ *	The field type
+ */
+template <typename T> using plain = T;
+
+/**
+ * The self-profiling metrics of the control loop.
+ */
+enum class Profile : unsigned int {
+	LOADS,    /**< Time spent sampling loads in us */
+	UPDATE,   /**< Time spent updating core group shards in us */
+	CYCLE,    /**< Time spent per poll in us */
+	LATENESS, /**< Wakeup lateness of the polling cycle in us */
+	READS,    /**< The number of sysctl reads per poll */
+	WRITES,   /**< The number of sysctl writes per poll */
+	LENGTH    /**< Enum length */
+};
+
+/**
+ * Printable strings for the self-profiling metrics.
+ */
+char const * const ProfileStr[]{
+	"load sampling", "shard update", "poll", "wakeup lateness",
+	"sysctl reads", "sysctl writes"
+};
+
+/**
+ * The units of the self-profiling metrics.
+ */
+char const * const ProfileUnit[]{" us", " us", " us", " us", "", ""};
+
+/**
+ * The number of histogram buckets.
+ *
+ * Bucket 0 counts the value 0, bucket n counts values in the range
+ * [2^(n-1), 2^n). The last bucket also counts all greater values.
+ */
+size_t const BUCKETS{24};
+
+/**
+ * A histogram with logarithmic buckets.
+ *
+ * @tparam Field
+ *	The field template, std::atomic or plain
+ */
+template <template <typename> class Field>
+struct HistogramT {
+	/**
+	 * The number of values.
+	 */
+	Field<uint64_t> count;
+
+	/**
+	 * The sum of all values.
+	 */
+	Field<uint64_t> sum;
+
+	/**
+	 * The greatest value.
+	 */
+	Field<uint64_t> max;
+
+	/**
+	 * The value counts of each bucket.
+	 */
+	Field<uint64_t> buckets[BUCKETS];
+};
+
+/**
+ * The statistics of a core group.
+ *
+ * @tparam Field
+ *	The field template, std::atomic or plain
+ */
+template <template <typename> class Field>
+struct GroupT {
+	/**
+	 * The number of the core owning dev.cpu.%d.freq.
+	 */
+	Field<uint32_t> corei;
+
+	/**
+	 * The number of cores in the group.
+	 */
+	Field<uint32_t> coren;
+
+	/**
+	 * The core class, 0 for performance and 1 for efficiency cores.
+	 */
+	Field<uint32_t> cls;
+
+	/**
+	 * The filtered load in MHz.
+	 */
+	Field<uint32_t> load;
+
+	/**
+	 * The time weighted load sum of the mean load filter.
+	 */
+	Field<int64_t> loadsum;
+
+	/**
+	 * The wanted clock frequency in MHz.
+	 */
+	Field<uint32_t> wanted;
+
+	/**
+	 * The clock frequency in MHz.
+	 */
+	Field<uint32_t> freq;
+
+	/**
+	 * The core temperature in dK, 0 if not available.
+	 */
+	Field<int32_t> temp;
+
+	/**
+	 * The number of frequency updates.
+	 */
+	Field<uint64_t> writes;
+
+	/**
+	 * The number of suppressed frequency updates.
+	 */
+	Field<uint64_t> suppressed;
+};
+
+/**
+ * The global statistics.
+ *
+ * @tparam Field
+ *	The field template, std::atomic or plain
+ */
+template <template <typename> class Field>
+struct HeaderT {
+	/**
+	 * The magic number, set after the remainder of the region
+	 * was initialised.
+	 */
+	Field<uint64_t> magic;
+
+	/**
+	 * The layout version.
+	 */
+	Field<uint32_t> version;
+
+	/**
+	 * The size of a Group entry.
+	 */
+	Field<uint32_t> gsize;
+
+	/**
+	 * The number of core groups.
+	 */
+	Field<uint32_t> ngroups;
+
+	/**
+	 * The PID of the writing process.
+	 */
+	Field<int32_t> pid;
+
+	/**
+	 * The sequence lock counter, odd during updates.
+	 */
+	Field<uint64_t> seq;
+
+	/**
+	 * The number of polls.
+	 */
+	Field<uint64_t> polls;
+
+	/**
+	 * The AC line state, 0 for battery, 1 for online and 2 for unknown.
+	 */
+	Field<uint32_t> acline;
+
+	/**
+	 * The target load of the AC line state in [0, 1024], 0 for
+	 * fixed frequency mode.
+	 */
+	Field<uint32_t> target;
+
+	/**
+	 * The polling interval in ms.
+	 */
+	Field<uint32_t> interval;
+
+	/**
+	 * Set if temperature based throttling is active.
+	 */
+	Field<uint32_t> throttling;
+
+	/**
+	 * The self-profiling histograms, indexed by Profile.
+	 */
+	HistogramT<Field> profile[static_cast<size_t>(Profile::LENGTH)];
+};
+
+/**
+ * A histogram for accumulating values in process.
+ */
+using Histogram = HistogramT<plain>;
+
+/**
+ * The shared memory layout of a histogram.
+ */
+using SharedHistogram = HistogramT<std::atomic>;
+
+/**
+ * The shared memory layout of a core group.
+ */
+using Group = GroupT<std::atomic>;
+
+/**
+ * A snapshot of a core group.
+ */
+using GroupSample = GroupT<plain>;
+
+/**
+ * The shared memory layout of the global statistics.
+ */
+using Header = HeaderT<std::atomic>;
+
+/**
+ * A snapshot of the global statistics.
+ */
+using HeaderSample = HeaderT<plain>;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+              std::atomic<int64_t>::is_always_lock_free &&
+              std::atomic<uint32_t>::is_always_lock_free &&
+              std::atomic<int32_t>::is_always_lock_free,
+              "Shared memory fields must be lock-free");
+
+static_assert(static_cast<size_t>(Profile::LENGTH) ==
+              sizeof(ProfileStr) / sizeof(ProfileStr[0]),
+              "Every profile must have a string representation");
+
+static_assert(static_cast<size_t>(Profile::LENGTH) ==
+              sizeof(ProfileUnit) / sizeof(ProfileUnit[0]),
+              "Every profile must have a unit");
+
+/**
+ * Add a value to a histogram.
+ *
+ * @param hist
+ *	The histogram to add to
+ * @param value
+ *	The value to add
+ */
+inline void add(Histogram & hist, uint64_t const value) {
+	size_t bucket = 0;
+	for (auto v = value; v && bucket < BUCKETS - 1; v >>= 1, ++bucket);
+	++hist.count;
+	hist.sum += value;
+	hist.max = std::max(hist.max, value);
+	++hist.buckets[bucket];
+}
+
+/**
+ * Returns an upper bound of the given percentile of a histogram.
+ *
+ * The bound is the greatest value of the bucket containing the
+ * percentile, but never greater than the greatest value.
+ *
+ * @param hist
+ *	The histogram
+ * @param percent
+ *	The percentile in [0, 100]
+ * @return
+ *	The upper bound of the percentile
+ */
+inline uint64_t percentile(Histogram const & hist,
+                           unsigned int const percent) {
+	uint64_t const rank = (hist.count * percent + 99) / 100;
+	uint64_t count = 0;
+	for (size_t bucket = 0; bucket < BUCKETS - 1; ++bucket) {
+		count += hist.buckets[bucket];
+		if (count && count >= rank) {
+			return std::min(hist.max, (uint64_t{1} << bucket) - 1);
+		}
+	}
+	return hist.max;
+}
+
+/**
+ * Print the self-profiling histograms.
+ *
+ * @tparam FileT
+ *	The output file type, must provide printf()
+ * @param file
+ *	The file to print to
+ * @param prefix
+ *	A prefix for every line
+ * @param profile
+ *	The histograms, indexed by Profile
+ */
+template <class FileT>
+void print(FileT & file, char const * const prefix,
+           Histogram const (& profile)[static_cast<size_t>(Profile::LENGTH)]) {
+	file.printf("%s%-16s %9s %9s %9s %9s %9s %9s\n", prefix, "profile",
+	            "count", "mean", "p50", "p90", "p99", "max");
+	for (size_t i = 0; i < static_cast<size_t>(Profile::LENGTH); ++i) {
+		auto const & hist = profile[i];
+		file.printf("%s%-16s %9ju %9ju %9ju %9ju %9ju %9ju%s\n", prefix,
+		            ProfileStr[i], uintmax_t{hist.count},
+		            uintmax_t{hist.count ? hist.sum / hist.count : 0},
+		            uintmax_t{percentile(hist, 50)},
+		            uintmax_t{percentile(hist, 90)},
+		            uintmax_t{percentile(hist, 99)},
+		            uintmax_t{hist.max}, ProfileUnit[i]);
+	}
+}
+
+/**
+ * Returns the size of a statistics region.
+ *
+ * @param ngroups
+ *	The number of core groups
+ * @return
+ *	The region size in bytes
+ */
+inline size_t size(size_t const ngroups) {
+	return sizeof(Header) + ngroups * sizeof(Group);
+}
+
+/**
+ * Returns a core group entry of the region.
+ *
+ * @param header
+ *	The header of the region
+ * @param gsize
+ *	The size of a group entry
+ * @param groupi
+ *	The index of the core group
+ * @return
+ *	A reference to the core group entry
+ */
+inline Group & group(Header & header, size_t const gsize,
+                     size_t const groupi) {
+	return *reinterpret_cast<Group *>(reinterpret_cast<char *>(&header) +
+	                                  sizeof(Header) + groupi * gsize);
+}
+
+/**
+ * Returns a read-only core group entry of the region.
+ *
+ * @param header
+ *	The header of the region
+ * @param gsize
+ *	The size of a group entry
+ * @param groupi
+ *	The index of the core group
+ * @return
+ *	A reference to the core group entry
+ */
+inline Group const & group(Header const & header, size_t const gsize,
+                           size_t const groupi) {
+	return *reinterpret_cast<Group const *>(
+	    reinterpret_cast<char const *>(&header) + sizeof(Header) +
+	    groupi * gsize);
+}
+
+/**
+ * Sequence lock guard for the writer.
+ *
+ * Makes the sequence counter odd on construction and even on
+ * destruction.
+ */
+class Writer final {
+	private:
+	/**
+	 * The header of the region.
+	 */
+	Header & header;
+
+	/**
+	 * The sequence counter value at construction.
+	 */
+	uint64_t const seq;
+
+	public:
+	/**
+	 * Begin an update.
+	 *
+	 * @param header
+	 *	The header of the region
+	 */
+	Writer(Header & header) :
+	    header{header},
+	    seq{header.seq.load(std::memory_order_relaxed)} {
+		this->header.seq.store(this->seq + 1,
+		                       std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	/**
+	 * Complete the update.
+	 */
+	~Writer() {
+		this->header.seq.store(this->seq + 2,
+		                       std::memory_order_release);
+	}
+};
+
+/**
+ * Store a value in a shared memory field.
+ *
+ * Only stores within a Writer scope are seen consistently by readers.
+ *
+ * @tparam T
+ *	The field type
+ * @param field
+ *	The field to store in
+ * @param value
+ *	The value to store
+ */
+template <typename T>
+void put(std::atomic<T> & field,
+         typename std::atomic<T>::value_type const value) {
+	field.store(value, std::memory_order_relaxed);
+}
+
+/**
+ * Store a histogram in shared memory.
+ *
+ * Only stores within a Writer scope are seen consistently by readers.
+ *
+ * @param dst
+ *	The shared memory histogram
+ * @param src
+ *	The histogram to store
+ */
+inline void put(SharedHistogram & dst, Histogram const & src) {
+	put(dst.count, src.count);
+	put(dst.sum,   src.sum);
+	put(dst.max,   src.max);
+	for (size_t i = 0; i < BUCKETS; ++i) {
+		put(dst.buckets[i], src.buckets[i]);
+	}
+}
+
+/**
+ * Load a value from a shared memory field.
+ *
+ * @tparam T
+ *	The field type
+ * @param dst
+ *	The snapshot field to assign to
+ * @param field
+ *	The field to load
+ */
+template <typename T>
+void get(T & dst, std::atomic<T> const & field) {
+	dst = field.load(std::memory_order_relaxed);
+}
+
+/**
+ * Load a histogram from shared memory.
+ *
+ * @param dst
+ *	The snapshot histogram to assign to
+ * @param src
+ *	The shared memory histogram
+ */
+inline void get(Histogram & dst, SharedHistogram const & src) {
+	get(dst.count, src.count);
+	get(dst.sum,   src.sum);
+	get(dst.max,   src.max);
+	for (size_t i = 0; i < BUCKETS; ++i) {
+		get(dst.buckets[i], src.buckets[i]);
+	}
+}
+
+/**
+ * Take a consistent snapshot of the statistics region.
+ *
+ * The caller must validate the magic, version, gsize and ngroups
+ * header fields and ensure the region holds ngroups entries, before
+ * taking a snapshot.
+ *
+ * @param header
+ *	The header of the region
+ * @param hdst
+ *	The header snapshot
+ * @param gdst
+ *	The core group snapshots, must provide room for ngroups entries
+ * @param ngroups
+ *	The number of core groups to copy
+ * @param tries
+ *	The number of attempts to take a consistent snapshot
+ * @retval true
+ *	A consistent snapshot was taken
+ * @retval false
+ *	The writer interfered with every attempt
+ */
+inline bool snapshot(Header const & header, HeaderSample & hdst,
+                     GroupSample * const gdst, size_t const ngroups,
+                     unsigned int tries = 1024) {
+	size_t const gsize = header.gsize.load(std::memory_order_relaxed);
+	for (; tries; --tries) {
+		auto const seq = header.seq.load(std::memory_order_acquire);
+		if (seq & 1) { continue; }
+
+		get(hdst.magic,      header.magic);
+		get(hdst.version,    header.version);
+		get(hdst.gsize,      header.gsize);
+		get(hdst.ngroups,    header.ngroups);
+		get(hdst.pid,        header.pid);
+		get(hdst.polls,      header.polls);
+		get(hdst.acline,     header.acline);
+		get(hdst.target,     header.target);
+		get(hdst.interval,   header.interval);
+		get(hdst.throttling, header.throttling);
+		for (size_t i = 0; i < static_cast<size_t>(Profile::LENGTH); ++i) {
+			get(hdst.profile[i], header.profile[i]);
+		}
+		for (size_t i = 0; i < ngroups; ++i) {
+			auto const & src = group(header, gsize, i);
+			auto & dst = gdst[i];
+			get(dst.corei,      src.corei);
+			get(dst.coren,      src.coren);
+			get(dst.cls,        src.cls);
+			get(dst.load,       src.load);
+			get(dst.loadsum,    src.loadsum);
+			get(dst.wanted,     src.wanted);
+			get(dst.freq,       src.freq);
+			get(dst.temp,       src.temp);
+			get(dst.writes,     src.writes);
+			get(dst.suppressed, src.suppressed);
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (header.seq.load(std::memory_order_relaxed) == seq) {
+			hdst.seq = seq;
+			return true;
+		}
+	}
+	return false;
+}
+
+} /* namespace stats */
+
+#endif /* _POWERDXX_STATS_HPP_ */
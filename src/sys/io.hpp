@@ -605,6 +605,27 @@ class file_feature<FileT, write, Tail ...> :
 		return *this;
 	}
 
+	/**
+	 * Write objects from a dynamically allocated buffer to file.
+	 *
+	 * @see fwrite()
+	 * @tparam T
+	 *	The object type, should be a POD type
+	 * @param src
+	 *	A pointer to the first object to write out to the file
+	 * @param count
+	 *	The number of objects to write
+	 * @return
+	 *	A self reference
+	 */
+	template <typename T>
+	FileT & write(T const * const src, std::size_t const count) {
+		if (this->handle) {
+			fwrite(src, sizeof(T), count, this->handle);
+		}
+		return *this;
+	}
+
 	/**
 	 * Flush file buffers.
 	 *
@@ -0,0 +1,187 @@
+/**
+ * Implements safer c++ wrappers for POSIX shared memory objects.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_SYS_SHM_HPP_
+#define _POWERDXX_SYS_SHM_HPP_
+
+#include "error.hpp"    /* sys::sc_error */
+
+#include <cstddef>      /* size_t */
+
+#include <fcntl.h>      /* O_* */
+#include <sys/mman.h>   /* shm_open(), shm_unlink(), mmap(), munmap() */
+#include <sys/stat.h>   /* fstat() */
+#include <unistd.h>     /* ftruncate(), close() */
+
+namespace sys {
+
+/**
+ * This namespace contains safer c++ wrappers for POSIX shared memory
+ * objects.
+ *
+ * The class Mapping implements the RAII pattern for a memory mapped
+ * shared memory object.
+ */
+namespace shm {
+
+/**
+ * The domain error type.
+ */
+struct error {};
+
+/**
+ * A memory mapped shared memory object implementing the RAII pattern.
+ *
+ * A mapping is either created and owned by a writer or opened
+ * read-only by a reader. The owner unlinks the shared memory object
+ * when the mapping is destroyed.
+ */
+class Mapping final {
+	private:
+	/**
+	 * The name of the shared memory object if owned.
+	 */
+	char const * owned;
+
+	/**
+	 * The size of the mapping.
+	 */
+	size_t len;
+
+	/**
+	 * The address of the mapping.
+	 */
+	void * addr;
+
+	/**
+	 * Map the given shared memory object file descriptor.
+	 *
+	 * The file descriptor is closed, the mapping remains valid.
+	 *
+	 * @param fd
+	 *	The file descriptor
+	 * @param prot
+	 *	The mmap() protection flags
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of mmap()
+	 */
+	void map(int const fd, int const prot) {
+		this->addr = ::mmap(nullptr, this->len, prot, MAP_SHARED, fd, 0);
+		auto const err = errno;
+		::close(fd);
+		if (this->addr == MAP_FAILED) {
+			this->addr = nullptr;
+			throw sc_error<error>{err};
+		}
+	}
+
+	public:
+	/**
+	 * Create a zero filled shared memory object and map it for
+	 * reading and writing.
+	 *
+	 * An existing object of the same name is replaced.
+	 *
+	 * @param name
+	 *	The name of the shared memory object, must start with `/`
+	 * @param size
+	 *	The size of the shared memory object
+	 * @param mode
+	 *	The access permissions of the shared memory object
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of shm_open(), ftruncate() or mmap()
+	 */
+	Mapping(char const * const name, size_t const size,
+	        mode_t const mode) :
+	    owned{name}, len{size}, addr{nullptr} {
+		::shm_unlink(name);
+		int const fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, mode);
+		if (fd == -1) {
+			throw sc_error<error>{errno};
+		}
+		if (::ftruncate(fd, static_cast<off_t>(size)) == -1) {
+			auto const err = errno;
+			::close(fd);
+			::shm_unlink(name);
+			throw sc_error<error>{err};
+		}
+		try {
+			this->map(fd, PROT_READ | PROT_WRITE);
+		} catch (...) {
+			::shm_unlink(name);
+			throw;
+		}
+	}
+
+	/**
+	 * Open an existing shared memory object and map it read-only.
+	 *
+	 * @param name
+	 *	The name of the shared memory object, must start with `/`
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of shm_open(), fstat() or mmap()
+	 */
+	explicit Mapping(char const * const name) :
+	    owned{nullptr}, len{0}, addr{nullptr} {
+		int const fd = ::shm_open(name, O_RDONLY, 0);
+		if (fd == -1) {
+			throw sc_error<error>{errno};
+		}
+		struct stat st{};
+		if (::fstat(fd, &st) == -1) {
+			auto const err = errno;
+			::close(fd);
+			throw sc_error<error>{err};
+		}
+		this->len = static_cast<size_t>(st.st_size);
+		this->map(fd, PROT_READ);
+	}
+
+	/**
+	 * Unmap the shared memory object and unlink it if owned.
+	 */
+	~Mapping() {
+		::munmap(this->addr, this->len);
+		if (this->owned) {
+			::shm_unlink(this->owned);
+		}
+	}
+
+	/**
+	 * Do not permit copy construction.
+	 */
+	Mapping(Mapping const &) = delete;
+
+	/**
+	 * Do not permit copy assignment.
+	 */
+	Mapping & operator =(Mapping const &) = delete;
+
+	/**
+	 * Returns the size of the mapping.
+	 *
+	 * @return
+	 *	The size in bytes
+	 */
+	size_t size() const { return this->len; }
+
+	/**
+	 * Returns the start of the mapping.
+	 *
+	 * @tparam T
+	 *	The type of the mapped data
+	 * @return
+	 *	A pointer to the mapped data
+	 */
+	template <typename T>
+	T * get() const { return static_cast<T *>(this->addr); }
+};
+
+} /* namespace shm */
+
+} /* namespace sys */
+
+#endif /* _POWERDXX_SYS_SHM_HPP_ */
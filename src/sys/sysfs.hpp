@@ -0,0 +1,237 @@
+/**
+ * Implements safer c++ wrappers for sysfs and procfs files.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_SYS_SYSFS_HPP_
+#define _POWERDXX_SYS_SYSFS_HPP_
+
+#include "error.hpp"    /* sys::sc_error */
+
+#include <memory>       /* std::unique_ptr */
+#include <utility>      /* std::swap() */
+
+#include <cstdlib>      /* strtoll() */
+#include <cstring>      /* strlen() */
+
+#include <fcntl.h>      /* open() */
+#include <unistd.h>     /* pread(), pwrite(), close(), dup() */
+
+namespace sys {
+
+/**
+ * This namespace contains safer c++ wrappers for sysfs and procfs
+ * files.
+ *
+ * Attribute files in these file systems contain a single text
+ * encoded value and are regenerated by the kernel on every read
+ * from offset 0. So a file can be kept open and read repeatedly.
+ *
+ * The class File implements the RAII pattern for such a file.
+ */
+namespace sysfs {
+
+/**
+ * The domain error type.
+ */
+struct error {};
+
+/**
+ * An open sysfs or procfs file implementing the RAII pattern.
+ *
+ * Copies share the file through a duplicated file descriptor.
+ */
+class File final {
+	private:
+	/**
+	 * The file descriptor.
+	 */
+	int fd;
+
+	public:
+	/**
+	 * Construct an unopened file.
+	 *
+	 * Accessing it fails with EBADF.
+	 */
+	File() : fd{-1} {}
+
+	/**
+	 * Open a file.
+	 *
+	 * @param path
+	 *	The path of the file
+	 * @param flags
+	 *	The open() flags
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of open()
+	 */
+	File(char const * const path, int const flags = O_RDONLY) :
+	    fd{::open(path, flags | O_CLOEXEC)} {
+		if (this->fd == -1) {
+			throw sc_error<error>{errno};
+		}
+	}
+
+	/**
+	 * Duplicate the file descriptor of another file.
+	 *
+	 * @param copy
+	 *	The file to copy
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of dup()
+	 */
+	File(File const & copy) : fd{-1} {
+		if (copy.fd != -1 && (this->fd = ::dup(copy.fd)) == -1) {
+			throw sc_error<error>{errno};
+		}
+	}
+
+	/**
+	 * Take the file descriptor of another file.
+	 *
+	 * @param move
+	 *	The file to move
+	 */
+	File(File && move) noexcept : fd{move.fd} {
+		move.fd = -1;
+	}
+
+	/**
+	 * Close the file.
+	 */
+	~File() {
+		if (this->fd != -1) {
+			::close(this->fd);
+		}
+	}
+
+	/**
+	 * Copy or move assignment.
+	 *
+	 * @param assign
+	 *	The file to copy or move
+	 * @return
+	 *	A self reference
+	 */
+	File & operator =(File assign) noexcept {
+		std::swap(this->fd, assign.fd);
+		return *this;
+	}
+
+	/**
+	 * Read the file into a buffer.
+	 *
+	 * The buffer is always NUL terminated.
+	 *
+	 * @param buf
+	 *	The buffer to read into
+	 * @param size
+	 *	The size of the buffer, must be greater than 0
+	 * @return
+	 *	The number of characters read, the file did not fit into
+	 *	the buffer if this is `size - 1`
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of pread()
+	 */
+	size_t read(char * const buf, size_t const size) const {
+		size_t len = 0;
+		while (len < size - 1) {
+			auto const count = ::pread(this->fd, buf + len,
+			                           size - 1 - len, len);
+			if (count == -1) {
+				throw sc_error<error>{errno};
+			}
+			if (count == 0) { break; }
+			len += count;
+		}
+		buf[len] = 0;
+		return len;
+	}
+
+	/**
+	 * Read the complete file into a buffer.
+	 *
+	 * The buffer is grown to fit the file contents.
+	 *
+	 * @param buf
+	 *	The buffer to read into, may be empty
+	 * @param size
+	 *	The size of the buffer, updated when the buffer grows
+	 * @return
+	 *	The number of characters read
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of pread()
+	 */
+	size_t read(std::unique_ptr<char[]> & buf, size_t & size) const {
+		if (!buf || size < 2) {
+			size = 4096;
+			buf = std::unique_ptr<char[]>{new char[size]};
+		}
+		size_t len;
+		while ((len = this->read(buf.get(), size)) == size - 1) {
+			size *= 2;
+			buf = std::unique_ptr<char[]>{new char[size]};
+		}
+		return len;
+	}
+
+	/**
+	 * Returns the complete file contents.
+	 *
+	 * @return
+	 *	The NUL terminated file contents
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of pread()
+	 */
+	std::unique_ptr<char[]> get() const {
+		std::unique_ptr<char[]> buf;
+		size_t size = 0;
+		this->read(buf, size);
+		return buf;
+	}
+
+	/**
+	 * Read an integer value from the file.
+	 *
+	 * @tparam T
+	 *	The integer type
+	 * @return
+	 *	The value
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of pread() or EINVAL if the file
+	 *	does not start with a number
+	 */
+	template <typename T>
+	T get() const {
+		char buf[32];
+		this->read(buf, sizeof(buf));
+		char * end{nullptr};
+		auto const value = strtoll(buf, &end, 10);
+		if (end == buf) {
+			throw sc_error<error>{EINVAL};
+		}
+		return static_cast<T>(value);
+	}
+
+	/**
+	 * Write a string to the file.
+	 *
+	 * @param str
+	 *	The NUL terminated string to write
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of pwrite()
+	 */
+	void set(char const * const str) {
+		if (::pwrite(this->fd, str, ::strlen(str), 0) == -1) {
+			throw sc_error<error>{errno};
+		}
+	}
+};
+
+} /* namespace sysfs */
+
+} /* namespace sys */
+
+#endif /* _POWERDXX_SYS_SYSFS_HPP_ */
@@ -4,7 +4,7 @@
  * @file
  */
 
-#include <chrono>    /* std::chrono::milliseconds */
+#include <chrono>    /* std::chrono::milliseconds, microseconds */
 
 #ifndef _POWERDXX_TYPES_HPP_
 #define _POWERDXX_TYPES_HPP_
@@ -19,6 +19,11 @@ namespace types {
  */
 typedef std::chrono::milliseconds ms;
 
+/**
+ * Microsecond type for self-profiling.
+ */
+typedef std::chrono::microseconds us;
+
 /**
  * Type for CPU core indexing.
  */
@@ -39,11 +44,25 @@ typedef unsigned long cptime_t;
  */
 typedef unsigned int mhz_t;
 
+/**
+ * Type for power consumption in mW.
+ *
+ * Negative values represent an unknown power consumption.
+ */
+typedef int mw_t;
+
 /**
  * Type for temperatures in dK.
  */
 typedef int decikelvin_t;
 
+/**
+ * Type for energy/performance preferences.
+ *
+ * The preference ranges from 0 (performance) to 100 (energy saving).
+ */
+typedef unsigned int epp_t;
+
 } /* namespace types */
 
 #endif /* _POWERDXX_TYPES_HPP_ */
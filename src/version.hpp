@@ -31,6 +31,7 @@ typedef uint64_t flag_t;
  */
 enum class LoadrecBits {
 	FREQ_TRACKING,  /**< Record clock frequencies per frame. */
+	BINARY,         /**< Frames are stored in the binary format. */
 };
 
 /**
@@ -51,6 +52,19 @@ constexpr flag_t operator ""_FREQ_TRACKING(unsigned long long int value) {
 	       utility::to_value(LoadrecBits::FREQ_TRACKING);
 }
 
+/**
+ * Set the BINARY bit.
+ *
+ * @param value
+ *	The bit value
+ * @return
+ *	The flag at the correct bit position
+ */
+constexpr flag_t operator ""_BINARY(unsigned long long int value) {
+	return static_cast<flag_t>(value > 0) <<
+	       utility::to_value(LoadrecBits::BINARY);
+}
+
 } /* namespace literals */
 
 } /* namespace version */